@@ -135,6 +135,108 @@ static inline void arm32_tlb_invalidate(void)
 		: "r0");
 }
 
+static inline void arm32_drain_write_buffer(void)
+{
+	__asm__ __volatile__(
+		"mcr p15, 0, %0, c7, c10, 4"
+		:
+		: "r" (0)
+		: "memory");
+}
+
+static inline void arm32_cache_invalidate_all(void)
+{
+	__asm__ __volatile__(
+		"mcr p15, 0, %0, c7, c7, 0"
+		:
+		: "r" (0)
+		: "memory");
+}
+
+static inline void arm32_icache_invalidate_all(void)
+{
+	__asm__ __volatile__(
+		"mcr p15, 0, %0, c7, c5, 0"
+		:
+		: "r" (0)
+		: "memory");
+}
+
+static inline void arm32_dcache_clean_invalidate_all(void)
+{
+	__asm__ __volatile__(
+		"1: mrc p15, 0, APSR_nzcv, c7, c14, 3\n"
+		"bne 1b\n"
+		"mcr p15, 0, %0, c7, c10, 4"
+		:
+		: "r" (0)
+		: "cc", "memory");
+}
+
+static inline void arm32_dcache_clean_range(uint32_t start, uint32_t end)
+{
+	start &= ~31;
+
+	for(; start < end; start += 32)
+	{
+		__asm__ __volatile__(
+			"mcr p15, 0, %0, c7, c10, 1"
+			:
+			: "r" (start)
+			: "memory");
+	}
+
+	arm32_drain_write_buffer();
+}
+
+static inline void arm32_dcache_invalidate_range(uint32_t start, uint32_t end)
+{
+	start &= ~31;
+
+	for(; start < end; start += 32)
+	{
+		__asm__ __volatile__(
+			"mcr p15, 0, %0, c7, c6, 1"
+			:
+			: "r" (start)
+			: "memory");
+	}
+}
+
+static inline void arm32_dcache_clean_invalidate_range(uint32_t start, uint32_t end)
+{
+	start &= ~31;
+
+	for(; start < end; start += 32)
+	{
+		__asm__ __volatile__(
+			"mcr p15, 0, %0, c7, c14, 1"
+			:
+			: "r" (start)
+			: "memory");
+	}
+
+	arm32_drain_write_buffer();
+}
+
+static inline uint32_t arm32_smlabb(uint32_t acc, uint32_t a, uint32_t b)
+{
+	__asm__ __volatile__(
+		"smlabb %0, %1, %2, %0"
+		: "+r" (acc)
+		: "r" (a), "r" (b));
+	return acc;
+}
+
+static inline uint32_t arm32_smlatt(uint32_t acc, uint32_t a, uint32_t b)
+{
+	__asm__ __volatile__(
+		"smlatt %0, %1, %2, %0"
+		: "+r" (acc)
+		: "r" (a), "r" (b));
+	return acc;
+}
+
 #ifdef __cplusplus
 }
 #endif
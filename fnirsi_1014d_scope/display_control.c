@@ -4,6 +4,7 @@
 #include "display_control.h"
 #include "ccu_control.h"
 #include "gpio_control.h"
+#include "interrupt.h"
 #include "variables.h"
 
 #include <string.h>
@@ -219,3 +220,152 @@ void display_bitmap(uint16 xpos, uint16 ypos, uint16 xsize, uint16 ysize, uint16
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+
+void display_layers_setup(uint16 xsize, uint16 ysize)
+{
+  //Start the trace and overlay pages fully transparent
+  memset((uint8 *)displaylayerpages, 0, sizeof(displaylayerpages));
+
+  //No flip is waiting yet and the layers are enabled with the first frame
+  displayflippending = 0;
+  displaylayersshown = 0;
+
+  //Set layer1 and layer2 to the same size as layer0
+  *DEBE_LAY1_SIZE = *DEBE_LAY0_SIZE;
+  *DEBE_LAY2_SIZE = *DEBE_LAY0_SIZE;
+
+  //They cover the whole screen so the drawing coordinates are the same for all the layers
+  *DEBE_LAY1_CODNT = 0;
+  *DEBE_LAY2_CODNT = 0;
+
+  //Set the line width in bits. (Using 16 bits per pixel)
+  *DEBE_LAY1_LINEWIDTH = xsize * 16;
+  *DEBE_LAY2_LINEWIDTH = xsize * 16;
+
+  //Set the layer attributes to 565 RGB
+  *DEBE_LAY1_ATT_CTRL1 = DEBE_LAY0_ATT_CTRL1_RGB565;
+  *DEBE_LAY2_ATT_CTRL1 = DEBE_LAY0_ATT_CTRL1_RGB565;
+
+  //Only black is matched by the color key
+  *DEBE_CKMAX = 0;
+  *DEBE_CKMIN = 0;
+  *DEBE_CKCFG = DEBE_CKCFG_MATCH_IN_RANGE;
+
+  //Stack the layers with the grid and user interface at the bottom, the traces on top of it and the cursors and pointers on top of all
+  //The black background of the trace and overlay layers is made transparent with the color key
+  *DEBE_LAY0_ATT_CTRL0 = DEBE_LAY_ATT_CTRL0_PRIORITY(0);
+  *DEBE_LAY1_ATT_CTRL0 = DEBE_LAY_ATT_CTRL0_PRIORITY(1) | DEBE_LAY_ATT_CTRL0_COLOR_KEY_EN;
+  *DEBE_LAY2_ATT_CTRL0 = DEBE_LAY_ATT_CTRL0_PRIORITY(2) | DEBE_LAY_ATT_CTRL0_COLOR_KEY_EN;
+
+  //Set the front page addresses
+  display_load_front_page();
+
+  //Setup the interrupt that signals the start of the vertical blanking
+  setup_interrupt(TCON_IRQ_NUM, display_vblank_irq_handler, 0);
+
+  //Enable the vertical blanking interrupt in the LCD timing controller
+  *TCON_INT0 = TCON_INT0_TCON0_VB_INT_EN;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_vblank_irq_handler(void)
+{
+  //Clear the interrupt flag while keeping it enabled
+  *TCON_INT0 &= ~TCON_INT0_TCON0_VB_INT_FLAG;
+
+  //Only switch the pages when a new frame is ready
+  if(displayflippending)
+  {
+    //Point the display engine at the new front pages. Done in the vertical blanking so the frame is not torn
+    display_load_front_page();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_load_front_page(void)
+{
+  //Set the layer1 and layer2 frame buffer addresses in bits, same as for layer0 in the display initialization
+  *DEBE_LAY1_FB_ADDRL = (uint32)tracefrontbuffer << 3;
+  *DEBE_LAY2_FB_ADDRL = (uint32)overlayfrontbuffer << 3;
+
+  //The top bits of the addresses of all the layers are in the same register
+  *DEBE_LAY0_FB_ADDR1H = (*DEBE_LAY0_FB_ADDR1H & DEBE_LAY_FB_ADDRH_LAYER0_MASK) | (((uint32)tracefrontbuffer >> 29) << DEBE_LAY_FB_ADDRH_LAYER1_SHIFT) | (((uint32)overlayfrontbuffer >> 29) << DEBE_LAY_FB_ADDRH_LAYER2_SHIFT);
+
+  //Show the trace and overlay layers when they are in use
+  if(displaylayersshown)
+  {
+    *DEBE_MODE_CTRL |= DEBE_MODE_CTRL_LAYER1_EN | DEBE_MODE_CTRL_LAYER2_EN;
+  }
+
+  //Load the module registers
+  *DEBE_REGBUFF_CTRL |= DEBE_REGBUFF_CTRL_LOAD;
+
+  //The back pages are no longer shown and free for drawing
+  displayflippending = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_hide_layers(void)
+{
+  //The vertical blanking interrupt changes the same registers, so keep it out while they are changed
+  *INTC_MASK_REG0 |= (1 << TCON_IRQ_NUM);
+
+  //Signal the layers are not in use so a flip does not show them
+  displaylayersshown = 0;
+
+  //Only show layer0
+  *DEBE_MODE_CTRL &= ~(DEBE_MODE_CTRL_LAYER1_EN | DEBE_MODE_CTRL_LAYER2_EN);
+
+  //Load the module registers
+  *DEBE_REGBUFF_CTRL |= DEBE_REGBUFF_CTRL_LOAD;
+
+  *INTC_MASK_REG0 &= ~(1 << TCON_IRQ_NUM);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_request_page_flip(void)
+{
+  uint16 *page = tracefrontbuffer;
+
+  //The freshly drawn back pages become the front pages and the old front pages will be drawn in next
+  tracefrontbuffer = tracebackbuffer;
+  tracebackbuffer = page;
+
+  page = overlayfrontbuffer;
+  overlayfrontbuffer = overlaybackbuffer;
+  overlaybackbuffer = page;
+
+  //With a new frame the layers are shown again
+  displaylayersshown = 1;
+
+  //Signal the interrupt handler to show the new front pages at the next vertical blanking
+  displayflippending = 1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_wait_page_flip(void)
+{
+  uint32 starttime = timer0ticks;
+
+  //The back pages can only be drawn in when the display engine is no longer reading them
+  while(displayflippending)
+  {
+    //Make sure a missing vertical blanking interrupt does not hang the scope
+    if((timer0ticks - starttime) > DISPLAY_FLIP_TIMEOUT)
+    {
+      //Force the new pages in, with the vertical blanking interrupt kept out since it does the same
+      *INTC_MASK_REG0 |= (1 << TCON_IRQ_NUM);
+
+      display_load_front_page();
+
+      *INTC_MASK_REG0 &= ~(1 << TCON_IRQ_NUM);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
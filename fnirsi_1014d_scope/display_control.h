@@ -37,6 +37,11 @@
 #define DEBE_LAY2_SIZE         ((volatile uint32 *)(0x01E60818))
 #define DEBE_LAY3_SIZE         ((volatile uint32 *)(0x01E6081C))
 
+#define DEBE_LAY0_CODNT        ((volatile uint32 *)(0x01E60820))
+#define DEBE_LAY1_CODNT        ((volatile uint32 *)(0x01E60824))
+#define DEBE_LAY2_CODNT        ((volatile uint32 *)(0x01E60828))
+#define DEBE_LAY3_CODNT        ((volatile uint32 *)(0x01E6082C))
+
 #define DEBE_LAY0_LINEWIDTH    ((volatile uint32 *)(0x01E60840))
 #define DEBE_LAY1_LINEWIDTH    ((volatile uint32 *)(0x01E60844))
 #define DEBE_LAY2_LINEWIDTH    ((volatile uint32 *)(0x01E60848))
@@ -52,10 +57,23 @@
 #define DEBE_LAY0_FB_ADDR3H    ((volatile uint32 *)(0x01E60868))
 #define DEBE_LAY0_FB_ADDR4H    ((volatile uint32 *)(0x01E6086C))
 
+#define DEBE_LAY1_FB_ADDRL     DEBE_LAY0_FB_ADDR2L                  //The numbered frame buffer address registers are for the layers 0 to 3
+#define DEBE_LAY2_FB_ADDRL     DEBE_LAY0_FB_ADDR3L
+
 
 #define DEBE_REGBUFF_CTRL      ((volatile uint32 *)(0x01E60870))
 
+#define DEBE_CKMAX             ((volatile uint32 *)(0x01E60880))
+#define DEBE_CKMIN             ((volatile uint32 *)(0x01E60884))
+#define DEBE_CKCFG             ((volatile uint32 *)(0x01E60888))
+
+#define DEBE_LAY0_ATT_CTRL0    ((volatile uint32 *)(0x01E60890))
+#define DEBE_LAY1_ATT_CTRL0    ((volatile uint32 *)(0x01E60894))
+#define DEBE_LAY2_ATT_CTRL0    ((volatile uint32 *)(0x01E60898))
+
 #define DEBE_LAY0_ATT_CTRL1    ((volatile uint32 *)(0x01E608A0))
+#define DEBE_LAY1_ATT_CTRL1    ((volatile uint32 *)(0x01E608A4))
+#define DEBE_LAY2_ATT_CTRL1    ((volatile uint32 *)(0x01E608A8))
 
 #define DEBE_COEF23            ((volatile uint32 *)(0x01E6097C))
 
@@ -64,6 +82,9 @@
 #define TCON_CTRL_MODULE_EN                 0x80000000         //Enable the LCD timing control module
 #define TCON_CTRL_IO_MAP_SEL_TCON1          0x00000001         //Use the TCON1 registers instead of the TCON0 registers
 
+#define TCON_INT0_TCON0_VB_INT_EN           0x80000000         //Enable the TCON0 vertical blanking interrupt
+#define TCON_INT0_TCON0_VB_INT_FLAG         0x00008000         //TCON0 vertical blanking interrupt pending. Cleared by writing a zero
+
 
 
 //--------------------------------------------------------------------------------------
@@ -72,6 +93,17 @@
 #define DEBE_MODE_CTRL_START                0x00000002         //Start the display engine back end
 
 #define DEBE_MODE_CTRL_LAYER0_EN            0x00000100         //Enable layer0
+#define DEBE_MODE_CTRL_LAYER1_EN            0x00000200         //Enable layer1
+#define DEBE_MODE_CTRL_LAYER2_EN            0x00000400         //Enable layer2
+
+#define DEBE_LAY_FB_ADDRH_LAYER0_MASK       0x0000000F         //Top bits of the layer0 frame buffer address
+#define DEBE_LAY_FB_ADDRH_LAYER1_SHIFT               8         //Position of the top bits of the layer1 frame buffer address
+#define DEBE_LAY_FB_ADDRH_LAYER2_SHIFT              16         //Position of the top bits of the layer2 frame buffer address
+
+#define DEBE_LAY_ATT_CTRL0_PRIORITY(p)      ((p) << 10)        //Layers with a higher priority are shown on top of the lower ones
+#define DEBE_LAY_ATT_CTRL0_COLOR_KEY_EN     0x00040000         //Pixels of the layer that match the color key are transparent
+
+#define DEBE_CKCFG_MATCH_IN_RANGE           0x00020202         //Red, green and blue match when between the minimum and maximum
 
 
 
@@ -93,6 +125,15 @@ void sys_init_display(uint16 xsize, uint16 ysize, uint16 *address);
 
 void display_bitmap(uint16 xpos, uint16 ypos, uint16 xsize, uint16 ysize, uint16 *source, uint16 *dest);
 
+void display_layers_setup(uint16 xsize, uint16 ysize);
+void display_vblank_irq_handler(void);
+
+void display_load_front_page(void);
+void display_hide_layers(void);
+
+void display_request_page_flip(void);
+void display_wait_page_flip(void);
+
 //--------------------------------------------------------------------------------------
 
 #endif /* DISPLAY_CONTROL_H */
@@ -45,10 +45,24 @@ void display_set_position(uint32 xpos, uint32 ypos)
 
 void display_set_dimensions(uint32 width, uint32 height)
 {
+  uint32 y;
+
   //Adjust for zero being part of the display
   displaydata.width  = width - 1;
   displaydata.height = height - 1;
   displaydata.pixelsperline = width;
+
+  //The line table can't hold more than the screen height
+  if(height > SCREEN_HEIGHT)
+  {
+    height = SCREEN_HEIGHT;
+  }
+
+  //Precalculate the start of the lines to avoid a multiply per line segment in the trace drawing
+  for(y=0;y<height;y++)
+  {
+    displaydata.rowoffsets[y] = y * width;
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -107,6 +121,177 @@ void display_restore_screen_buffer(void)
   displaydata.screenbuffer = displaydata.savebuffer;
 }
 
+//----------------------------------------------------------------------------------------------------------------------------------
+//Dirty region functions
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_set_dirty_region(PDIRTYREGION region)
+{
+  //Set to zero to stop keeping track of the changes
+  displaydata.dirtyregion = region;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_clear_dirty_region(PDIRTYREGION region)
+{
+  region->count = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_add_dirty_rect(int32 xpos, int32 ypos, int32 width, int32 height)
+{
+  PDIRTYREGION region = displaydata.dirtyregion;
+  PDISPLAYRECT ptr;
+  DISPLAYRECT  rect;
+  uint32       i;
+  uint32       best;
+  int32        growth;
+  int32        smallest;
+
+  //Only when changes need to be tracked
+  if(region == 0)
+  {
+    return;
+  }
+
+  //Limit the rectangle to the screen
+  rect.xstart = (xpos < 0) ? 0 : xpos;
+  rect.ystart = (ypos < 0) ? 0 : ypos;
+  //The ends are exclusive and the display dimensions hold the last pixel, so one more is allowed for them
+  rect.xend   = ((xpos + width) > ((int32)displaydata.width + 1)) ? ((int32)displaydata.width + 1) : (xpos + width);
+  rect.yend   = ((ypos + height) > ((int32)displaydata.height + 1)) ? ((int32)displaydata.height + 1) : (ypos + height);
+
+  //Nothing to add when it is not on the screen
+  if((rect.xstart >= rect.xend) || (rect.ystart >= rect.yend))
+  {
+    return;
+  }
+
+  //Take in every rectangle that touches or overlaps the new one
+  i = 0;
+
+  while(i < region->count)
+  {
+    ptr = &region->rects[i];
+
+    if((rect.xstart <= ptr->xend) && (rect.xend >= ptr->xstart) && (rect.ystart <= ptr->yend) && (rect.yend >= ptr->ystart))
+    {
+      //Grow the new rectangle to cover both
+      display_merge_dirty_rect(&rect, ptr);
+
+      //Remove the merged one by moving the last one in its place
+      region->count--;
+      region->rects[i] = region->rects[region->count];
+
+      //The bigger rectangle can touch rectangles that have already been checked, so start over
+      i = 0;
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  //Add it to the list when there is room
+  if(region->count < DISPLAY_DIRTY_RECTS)
+  {
+    region->rects[region->count++] = rect;
+    return;
+  }
+
+  //Otherwise merge it with the rectangle that grows the least by it
+  best = 0;
+  smallest = 0x7FFFFFFF;
+
+  for(i=0;i<region->count;i++)
+  {
+    ptr = &region->rects[i];
+
+    //Area of the combined rectangle minus the area of the one in the list
+    growth = (((ptr->xend > rect.xend) ? ptr->xend : rect.xend) - ((ptr->xstart < rect.xstart) ? ptr->xstart : rect.xstart)) *
+             (((ptr->yend > rect.yend) ? ptr->yend : rect.yend) - ((ptr->ystart < rect.ystart) ? ptr->ystart : rect.ystart)) -
+             ((ptr->xend - ptr->xstart) * (ptr->yend - ptr->ystart));
+
+    if(growth < smallest)
+    {
+      smallest = growth;
+      best = i;
+    }
+  }
+
+  display_merge_dirty_rect(&region->rects[best], &rect);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_merge_dirty_rect(PDISPLAYRECT target, PDISPLAYRECT rect)
+{
+  //Make the target cover both rectangles
+  if(rect->xstart < target->xstart)
+  {
+    target->xstart = rect->xstart;
+  }
+
+  if(rect->ystart < target->ystart)
+  {
+    target->ystart = rect->ystart;
+  }
+
+  if(rect->xend > target->xend)
+  {
+    target->xend = rect->xend;
+  }
+
+  if(rect->yend > target->yend)
+  {
+    target->yend = rect->yend;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_fill_dirty_region(PDIRTYREGION region)
+{
+  PDISPLAYRECT ptr = region->rects;
+  uint32       i;
+
+  //Fill all the rectangles with the foreground color. The fill function takes the last pixel instead of the size
+  for(i=0;i<region->count;i++,ptr++)
+  {
+    display_fill_rect(ptr->xstart, ptr->ystart, ptr->xend - ptr->xstart - 1, ptr->yend - ptr->ystart - 1);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_copy_dirty_region_to_screen(PDIRTYREGION region)
+{
+  PDISPLAYRECT ptr = region->rects;
+  uint32       i;
+
+  //Copy all the rectangles from the source buffer to the screen buffer
+  for(i=0;i<region->count;i++,ptr++)
+  {
+    display_copy_rect_to_screen(ptr->xstart, ptr->ystart, ptr->xend - ptr->xstart, ptr->yend - ptr->ystart);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void display_reset_pixel_count(void)
+{
+  displaydata.pixelspushed = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 display_get_pixel_count(void)
+{
+  return(displaydata.pixelspushed);
+}
+
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void display_set_fg_y_gradient(uint16 *buffer, uint32 ystart, uint32 yend, uint32 startcolor, uint32 endcolor)
@@ -193,6 +378,10 @@ void display_draw_line(uint32 xstart, uint32 ystart, uint32 xend, uint32 yend)
     ys = yend;
     ye = ystart;
   }
+
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xs, (ys < ye) ? ys : ye, (xe - xs) + 1, ((ys < ye) ? (ye - ys) : (ys - ye)) + 1);
+  displaydata.pixelspushed += (xe - xs) + ((ys < ye) ? (ye - ys) : (ys - ye)) + 1;
   
   //Check if the line is vertical
   if(xstart == xend)
@@ -258,6 +447,136 @@ void display_draw_line(uint32 xstart, uint32 ystart, uint32 xend, uint32 yend)
   }
 }
 
+//----------------------------------------------------------------------------------------------------------------------------------
+//Specialized version of display_draw_line for the traces. It sets the exact same pixels, but since trace segments are mostly steep,
+//every x position is drawn as a single vertical run that is clipped once, instead of checking the bounds for every pixel
+
+void display_draw_trace_line(uint32 xstart, uint32 ystart, uint32 xend, uint32 yend)
+{
+  register uint16 *ptr;
+  register uint16  color = displaydata.fg_color;
+  register uint32  stride = displaydata.pixelsperline;
+  register int32   x, xs, xe, ys, ye, dx;
+  register int32   ylow, yhigh;
+  register int32   yacc;
+  register int32   ystep;
+  register int32   count;
+  int32            width  = displaydata.width;
+  int32            height = displaydata.height;
+
+  //Determine the lowest x for start point
+  if(xstart < xend)
+  {
+    //Use the coordinates as is
+    xs = xstart;
+    xe = xend;
+    ys = ystart;
+    ye = yend;
+  }
+  else
+  {
+    //Swap start and end
+    xs = xend;
+    xe = xstart;
+    ys = yend;
+    ye = ystart;
+  }
+
+  //Get the y range of the whole segment
+  if(ys < ye)
+  {
+    ylow  = ys;
+    yhigh = ye;
+  }
+  else
+  {
+    ylow  = ye;
+    yhigh = ys;
+  }
+
+  //Nothing to do when the segment is completely outside the screen
+  if((xe < 0) || (xs >= width) || (yhigh < 0) || (ylow >= height))
+  {
+    return;
+  }
+
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xs, ylow, (xe - xs) + 1, (yhigh - ylow) + 1);
+  displaydata.pixelspushed += (xe - xs) + (yhigh - ylow) + 1;
+
+  //Check if the line is vertical
+  if(xstart == xend)
+  {
+    //If so use 1 for delta x to calculate the y segment length
+    dx = 1;
+  }
+  else
+  {
+    //Not vertical then calculate delta x.
+    dx = (xe - xs) + 1;
+  }
+
+  //Calculate the y segment length
+  ystep = ((ye - ys) << 16) / dx;
+
+  //Initialize the y accumulator for broken pixel accounting
+  yacc = ys << 16;
+
+  //The columns after the right edge of the screen do not influence the ones before it
+  if(xe >= width)
+  {
+    xe = width - 1;
+  }
+
+  //Handle all the x positions
+  for(x=xs;x<=xe;x++)
+  {
+    //Calculate the y end of this segment
+    yacc += ystep;
+    ye = yacc >> 16;
+
+    //The run goes from the lowest to the highest y, independent of the line direction
+    if(ye < ys)
+    {
+      ylow  = ye;
+      yhigh = ys;
+    }
+    else
+    {
+      ylow  = ys;
+      yhigh = ye;
+    }
+
+    //Clip the run on the top and bottom of the screen
+    if(ylow < 0)
+    {
+      ylow = 0;
+    }
+
+    if(yhigh >= height)
+    {
+      yhigh = height - 1;
+    }
+
+    //Only draw when the run is on the screen
+    if((x >= 0) && (ylow <= yhigh))
+    {
+      //Point to the first pixel of the run in the screen buffer
+      ptr = displaydata.screenbuffer + displaydata.rowoffsets[ylow] + x;
+
+      //Fill the run by stepping down a line per pixel
+      for(count=(yhigh - ylow) + 1;count;count--)
+      {
+        *ptr = color;
+        ptr += stride;
+      }
+    }
+
+    //Set y start of next segment
+    ys = ye;
+  }
+}
+
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void display_draw_horz_line(uint32 ypos, uint32 xstart, uint32 xend)
@@ -293,6 +612,10 @@ void display_draw_horz_line(uint32 ypos, uint32 xstart, uint32 xend)
     xe = displaydata.width;
   }
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xs, ypos, (xe - xs) + 1, 1);
+  displaydata.pixelspushed += (xe - xs) + 1;
+
   //Point to where the line needs to be drawn
   ptr = displaydata.screenbuffer + ((ypos * displaydata.pixelsperline) + xs);
   
@@ -340,6 +663,10 @@ void display_draw_vert_line(uint32 xpos, uint32 ystart, uint32 yend)
     ye = displaydata.height;
   }
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ys, 1, (ye - ys) + 1);
+  displaydata.pixelspushed += (ye - ys) + 1;
+
   //Point to where the line needs to be drawn
   ptr = displaydata.screenbuffer + ((ys * pixels) + xpos);
   
@@ -389,6 +716,10 @@ void display_draw_horz_dots(uint32 ypos, uint32 xstart, uint32 xend, uint32 inte
     xe = displaydata.width;
   }
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xs, ypos, (xe - xs) + 1, 1);
+  displaydata.pixelspushed += (xe - xs) + 1;
+
   //Point to where the dots need to be drawn
   ptr = displaydata.screenbuffer + ((ypos * displaydata.pixelsperline) + xs);
   
@@ -438,6 +769,10 @@ void display_draw_vert_dots(uint32 xpos, uint32 ystart, uint32 yend, uint32 inte
     ye = displaydata.height;
   }
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ys, 1, (ye - ys) + 1);
+  displaydata.pixelspushed += (ye - ys) + 1;
+
   //Calculate the dot interval
   pixels = displaydata.pixelsperline * interval;
   
@@ -490,6 +825,10 @@ void display_draw_horz_dashes(uint32 ypos, uint32 xstart, uint32 xend, uint32 le
     xe = displaydata.width;
   }
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xs, ypos, (xe - xs) + 1, 1);
+  displaydata.pixelspushed += (xe - xs) + 1;
+
   //Point to where the dots need to be drawn
   ptr = displaydata.screenbuffer + ((ypos * displaydata.pixelsperline) + xs);
   
@@ -547,6 +886,10 @@ void display_draw_vert_dashes(uint32 xpos, uint32 ystart, uint32 yend, uint32 le
     ye = displaydata.height;
   }
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ys, 1, (ye - ys) + 1);
+  displaydata.pixelspushed += (ye - ys) + 1;
+
   //Calculate the dash interval
   pixels1 = displaydata.pixelsperline;
   pixels2 = displaydata.pixelsperline * interval;
@@ -741,6 +1084,10 @@ void display_draw_arc(uint32 xpos, uint32 ypos, uint32 radius, uint32 startangle
   uint32  ea;
   uint32  a, step;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos - radius, ypos - radius, (radius * 2) + 1, (radius * 2) + 1);
+  displaydata.pixelspushed += radius * 2;
+
   //Determine the angles step fit for the given radius  
   if(radius > 450)
     step = 1;
@@ -854,6 +1201,10 @@ void display_fill_rect(uint32 xpos, uint32 ypos, uint32 width, uint32 height)
   {
     height = displaydata.height;
   }
+
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, (width - xpos) + 1, (height - ypos) + 1);
+  displaydata.pixelspushed += ((width - xpos) + 1) * ((height - ypos) + 1);
   
   //Draw all the pixels
   for(y=ypos;y<=height;y++)
@@ -878,6 +1229,10 @@ void display_fill_rounded_rect(uint32 xpos, uint32 ypos, uint32 width, uint32 he
   uint32  x, xc, xs, xe, xt, y, yc, ys, ye;
   uint32  a, step, r;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Compensate for the last pixel
   width--;
   height--;
@@ -1002,6 +1357,10 @@ void display_slide_top_rect_onto_screen(uint32 xpos, uint32 ypos, uint32 width,
   register uint32  startxy;
   register uint32  pixels = displaydata.pixelsperline;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Starting line of the rectangle to display first
   startline = height - ((height * speed) >> 20) - 1;
   
@@ -1047,6 +1406,10 @@ void display_slide_left_rect_onto_screen(uint32 xpos, uint32 ypos, uint32 width,
   register uint32  startxy;
   register uint32  pixels = displaydata.pixelsperline;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Starting pixel of the rectangle to display first
   startpixel = width - ((width * speed) >> 20) - 1;
   
@@ -1093,6 +1456,10 @@ void display_slide_right_rect_onto_screen(uint32 xpos, uint32 ypos, uint32 width
   register uint32  startxy;
   register uint32  pixels = displaydata.pixelsperline;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Starting pixel of the rectangle where to display first
   startpixel = width - ((width * speed) >> 20) - 1;
   
@@ -1168,6 +1535,10 @@ void display_copy_rect_to_screen(uint32 xpos, uint32 ypos, uint32 width, uint32
   register uint32  startpixel;
   register uint32  pixels = displaydata.pixelsperline;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Start pixel for source and destination calculation
   startpixel = xpos + (ypos * pixels);
 
@@ -1202,6 +1573,10 @@ void display_copy_icon_use_colors(const uint8 *icon, uint32 xpos, uint32 ypos, u
   register uint32  bytesperrow = (width + 7) / 8;
   register uint32  pixels = displaydata.pixelsperline;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Setup destination pointer
   ptr = displaydata.screenbuffer + xpos + (ypos * pixels);
   
@@ -1263,6 +1638,10 @@ void display_copy_icon_fg_color(const uint8 *icon, uint32 xpos, uint32 ypos, uin
   register uint32  bytesperrow = (width + 7) / 8;
   register uint32  pixels = displaydata.pixelsperline;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Setup destination pointer
   ptr = displaydata.screenbuffer + xpos + (ypos * pixels);
   
@@ -1318,6 +1697,10 @@ void display_copy_icon_fg_color_y_gradient(const uint8 *icon, uint32 xpos, uint3
   register uint32  pixeldata;
   register uint32  bytesperrow = (width + 7) / 8;
   register uint32  pixels = displaydata.pixelsperline;
+
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
   
   //Setup destination pointer
   ptr = displaydata.screenbuffer + xpos + (ypos * pixels);
@@ -1373,6 +1756,10 @@ void display_copy_icon_full_color(const uint16 *icon, uint32 xpos, uint32 ypos,
   register uint32  idx;
   register uint32  pixels = displaydata.pixelsperline;
 
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, ypos, width, height);
+  displaydata.pixelspushed += width * height;
+
   //Setup destination pointer
   ptr = displaydata.screenbuffer + xpos + (ypos * pixels);
   
@@ -1460,6 +1847,10 @@ void display_top_pointer(int32 xpos, int8 id)
   
   //Setup destination pointer
   dptr = displaydata.screenbuffer + xpos + (VERTICAL_POINTER_TOP * displaydata.pixelsperline);
+
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(xpos, VERTICAL_POINTER_TOP, HORIZONTAL_POINTER_WIDTH, HORIZONTAL_POINTER_HEIGHT);
+  displaydata.pixelspushed += HORIZONTAL_POINTER_WIDTH * HORIZONTAL_POINTER_HEIGHT;
   
   //Copy the needed lines
   for(line=0;line<HORIZONTAL_POINTER_HEIGHT;line++)
@@ -1769,6 +2160,10 @@ void draw_vw_character(uint16 character)
     
     //Add bounds limiting here for both height and pixels
 
+    //Keep track of the changed part of the screen
+    display_add_dirty_rect(displaydata.xpos, displaydata.ypos, metrics->pixels, height);
+    displaydata.pixelspushed += metrics->pixels * height;
+
     //Draw all the pixels
     for(y=0;y<height;y++)
     {
@@ -1937,6 +2332,10 @@ void render_fw_character(uint16 character)
   data = info->data + (character * font->height * info->bytes);
 
   //Add bounds limiting here for both height and pixels
+
+  //Keep track of the changed part of the screen
+  display_add_dirty_rect(displaydata.xpos, displaydata.ypos, info->pixels, height);
+  displaydata.pixelspushed += info->pixels * height;
   
   
   //Draw all the pixels
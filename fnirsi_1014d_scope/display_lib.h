@@ -36,6 +36,9 @@ struct tagDisplayData
   uint32     width;
   uint32     height;
   uint32     pixelsperline;
+  PDIRTYREGION dirtyregion;        //When set the drawing functions add the parts of the screen they change to it
+  uint32     pixelspushed;         //Number of pixels written by the drawing functions since the last reset
+  uint32     rowoffsets[SCREEN_HEIGHT]; //Offset of the first pixel of each line in the screen buffer, for the trace line drawing
 };
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -56,7 +59,20 @@ void display_set_fg_y_gradient(uint16 *buffer, uint32 ystart, uint32 yend, uint3
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
+void display_set_dirty_region(PDIRTYREGION region);
+void display_clear_dirty_region(PDIRTYREGION region);
+void display_add_dirty_rect(int32 xpos, int32 ypos, int32 width, int32 height);
+void display_merge_dirty_rect(PDISPLAYRECT target, PDISPLAYRECT rect);
+void display_fill_dirty_region(PDIRTYREGION region);
+void display_copy_dirty_region_to_screen(PDIRTYREGION region);
+
+void display_reset_pixel_count(void);
+uint32 display_get_pixel_count(void);
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
 void display_draw_line(uint32 xstart, uint32 ystart, uint32 xend, uint32 yend);
+void display_draw_trace_line(uint32 xstart, uint32 ystart, uint32 xend, uint32 yend);
 void display_draw_horz_line(uint32 ypos, uint32 xstart, uint32 xend);
 void display_draw_vert_line(uint32 xpos, uint32 ystart, uint32 yend);
 void display_draw_horz_dots(uint32 ypos, uint32 xstart, uint32 xend, uint32 interval);
@@ -0,0 +1,304 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "types.h"
+#include "fft_math.h"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+//Quarter sine table from sin_cos_math.c in 0.1 degree steps with 16384 for 1.0
+extern const uint16 qsintable[];
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Fractional part of log2(1 + n/128) in 1/256 steps for the decibel conversion
+
+const uint8 fftlog2table[128] =
+{
+    0,   3,   6,   9,  11,  14,  17,  20,  22,  25,  28,  30,  33,  36,  38,  41,
+   44,  46,  49,  51,  54,  56,  59,  61,  63,  66,  68,  71,  73,  75,  78,  80,
+   82,  85,  87,  89,  92,  94,  96,  98, 100, 103, 105, 107, 109, 111, 113, 116,
+  118, 120, 122, 124, 126, 128, 130, 132, 134, 136, 138, 140, 142, 144, 146, 148,
+  150, 152, 154, 155, 157, 159, 161, 163, 165, 167, 169, 170, 172, 174, 176, 178,
+  179, 181, 183, 185, 186, 188, 190, 192, 193, 195, 197, 198, 200, 202, 203, 205,
+  207, 208, 210, 212, 213, 215, 216, 218, 220, 221, 223, 224, 226, 228, 229, 231,
+  232, 234, 235, 237, 238, 240, 241, 243, 244, 246, 247, 249, 250, 252, 253, 255
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int16 fftcostable[FFT_MAX_POINTS / 2];     //Q15 twiddle factors for the largest transform. Smaller ones step through it
+int16 fftsintable[FFT_MAX_POINTS / 2];
+
+int16 fftwindowtable[FFT_MAX_POINTS];      //Q15 window for the current transform size
+
+int16 fftreal[FFT_MAX_POINTS];             //Q15 working buffers, holding the spectrum after processing the samples
+int16 fftimag[FFT_MAX_POINTS];
+
+uint32 fftbits = FFT_MAX_BITS;             //Size of the transform set with the window
+int32  fftreferencedb;                     //Level of a full scale sine in 0.1dB, to show the spectrum in dB full scale
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The angle is in 0.1 degree steps with a 16 bit fraction, so the quarter sine table can be interpolated for the twiddle factors
+//that fall in between the table steps. The result is in Q15
+
+int16 fft_sine(uint32 angle)
+{
+  uint32 tenths   = angle >> 16;
+  uint32 fraction = angle & 0xFFFF;
+  uint32 quadrant = (tenths / 900) % 4;
+  uint32 index    = tenths % 900;
+  int32  value1;
+  int32  value2;
+  int32  value;
+
+  //Get the two table entries around the angle based on which quadrant it is in
+  if((quadrant == 0) || (quadrant == 2))
+  {
+    //For up ramping table starts from the beginning
+    value1 = qsintable[index];
+    value2 = qsintable[index + 1];
+  }
+  else
+  {
+    //For down ramping table starts from the end
+    value1 = qsintable[900 - index];
+    value2 = qsintable[899 - index];
+  }
+
+  //Interpolate between the entries and scale from Q14 to Q15
+  value = (value1 + (((value2 - value1) * (int32)fraction) >> 16)) << 1;
+
+  //1.0 does not fit in Q15
+  if(value > 32767)
+  {
+    value = 32767;
+  }
+
+  //Check if quadrant is in the negative section
+  if(quadrant >= 2)
+  {
+    value = -value;
+  }
+
+  return(value);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fft_init(void)
+{
+  uint32 step = (3600 << 16) / FFT_MAX_POINTS;
+  uint32 index;
+
+  //The twiddle factors are the cosine and sine of the angles on the unit circle for the largest transform size
+  for(index=0;index<(FFT_MAX_POINTS / 2);index++)
+  {
+    fftcostable[index] = fft_sine((index * step) + (900 << 16));
+    fftsintable[index] = fft_sine(index * step);
+  }
+
+  //Start with the default window for the largest transform
+  fft_set_window(FFT_WINDOW_HANN, FFT_MAX_BITS);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fft_set_window(uint32 window, uint32 bits)
+{
+  uint32 points = 1 << bits;
+  uint32 step = (3600 << 16) / points;
+  uint32 index;
+  uint32 sum = 0;
+  int32  value;
+  int32  reference;
+
+  //Keep the size for the processing of the samples
+  fftbits = bits;
+
+  for(index=0;index<points;index++)
+  {
+    if(window == FFT_WINDOW_BLACKMAN)
+    {
+      //0.42 - 0.5 * cos(2 * pi * n / N) + 0.08 * cos(4 * pi * n / N)
+      value = 13763 - (fft_sine((index * step) + (900 << 16)) / 2) + ((2621 * fft_sine((index * step * 2) + (900 << 16))) >> 15);
+    }
+    else
+    {
+      //0.5 - 0.5 * cos(2 * pi * n / N)
+      value = (32768 - fft_sine((index * step) + (900 << 16))) / 2;
+    }
+
+    //Keep the window within range
+    if(value < 0)
+    {
+      value = 0;
+    }
+    else if(value > 32767)
+    {
+      value = 32767;
+    }
+
+    fftwindowtable[index] = value;
+
+    //Sum the window for its coherent gain
+    sum += value;
+  }
+
+  //A full scale sine of the ADC ends up in a single bin with half its amplitude, scaled with the coherent gain of the window
+  reference = (int32)(((FFT_SAMPLE_FULL_SCALE * (sum / points)) >> 15) / 2);
+
+  fftreferencedb = fft_power_to_db(reference * reference);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Converts the samples to Q15 without the DC component, applies the window and transforms them. The samples need to hold enough
+//data for the transform size set with the window
+
+void fft_process_samples(uint8 *samples)
+{
+  uint32 points = 1 << fftbits;
+  uint32 index;
+  uint32 sum = 0;
+  int32  average;
+
+  //Get the average of the samples to remove the DC part, which would otherwise hide the lower frequencies
+  for(index=0;index<points;index++)
+  {
+    sum += samples[index];
+  }
+
+  //The samples are scaled up to Q15 so the average is taken with that scaling
+  average = (sum << FFT_SAMPLE_SHIFT) >> fftbits;
+
+  //Fill the buffers with the windowed samples
+  for(index=0;index<points;index++)
+  {
+    fftreal[index] = ((((int32)samples[index] << FFT_SAMPLE_SHIFT) - average) * fftwindowtable[index]) >> 15;
+    fftimag[index] = 0;
+  }
+
+  fft_compute(fftreal, fftimag, fftbits);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//In place radix 2 decimation in time transform of Q15 data. Every stage halves the results to prevent overflow, so the output
+//is scaled with 1/N
+
+void fft_compute(int16 *real, int16 *imag, uint32 bits)
+{
+  register int32  tr, ti;
+  register int32  wr, wi;
+  register int32  ar, ai;
+  register uint32 a, b;
+  uint32 points = 1 << bits;
+  uint32 size;
+  uint32 half;
+  uint32 twiddlestep;
+  uint32 k;
+  uint32 i, j, m;
+  int16  temp;
+
+  //Put the data in bit reversed order
+  for(i=1,j=0;i<points;i++)
+  {
+    //Add one to the reversed index by carrying from the top bit down
+    for(m=points>>1;j&m;m>>=1)
+    {
+      j ^= m;
+    }
+
+    j |= m;
+
+    //Swap each pair only once
+    if(i < j)
+    {
+      temp = real[i];
+      real[i] = real[j];
+      real[j] = temp;
+
+      temp = imag[i];
+      imag[i] = imag[j];
+      imag[j] = temp;
+    }
+  }
+
+  //Combine the transforms, doubling the size with every stage
+  for(size=2;size<=points;size<<=1)
+  {
+    half = size >> 1;
+
+    //The twiddle table is made for the largest transform, so step through it for the smaller ones
+    twiddlestep = FFT_MAX_POINTS / size;
+
+    //Use each twiddle factor for all the butterflies that need it before getting the next one
+    for(k=0;k<half;k++)
+    {
+      wr = fftcostable[k * twiddlestep];
+      wi = fftsintable[k * twiddlestep];
+
+      for(a=k;a<points;a+=size)
+      {
+        b = a + half;
+
+        //Multiply with the conjugate twiddle factor for the forward transform
+        tr = ((real[b] * wr) + (imag[b] * wi)) >> 15;
+        ti = ((imag[b] * wr) - (real[b] * wi)) >> 15;
+
+        ar = real[a];
+        ai = imag[a];
+
+        real[b] = (ar - tr) >> 1;
+        imag[b] = (ai - ti) >> 1;
+        real[a] = (ar + tr) >> 1;
+        imag[a] = (ai + ti) >> 1;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Returns the level of a bin of the last processed samples in 0.1dB relative to a full scale sine
+
+int32 fft_get_bin_db(uint32 bin)
+{
+  int32 real = fftreal[bin];
+  int32 imag = fftimag[bin];
+
+  return(fft_power_to_db((uint32)(real * real) + (uint32)(imag * imag)) - fftreferencedb);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//10 * log10(power) in 0.1dB steps, calculated from the log2 of the power with the top bit and a table for the fraction
+
+int32 fft_power_to_db(uint32 power)
+{
+  uint32 msb;
+  uint32 mantissa;
+  uint32 log2;
+
+  //Zero is treated as one to have the lowest level
+  if(power == 0)
+  {
+    return(0);
+  }
+
+  //The integer part of log2 is the position of the top bit
+  msb = 31 - __builtin_clz(power);
+
+  //The next 7 bits below the top bit index the fraction table
+  if(msb >= 7)
+  {
+    mantissa = (power >> (msb - 7)) & 0x7F;
+  }
+  else
+  {
+    mantissa = (power << (7 - msb)) & 0x7F;
+  }
+
+  //log2 in 1/256 steps
+  log2 = (msb << 8) + fftlog2table[mantissa];
+
+  //10 * log10(2) / 256 * 10 = 0.11759 which is 7706 / 65536
+  return((log2 * 7706) >> 16);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,37 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef FFT_MATH_H
+#define FFT_MATH_H
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "types.h"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define FFT_MAX_BITS                    11
+#define FFT_MAX_POINTS                  (1 << FFT_MAX_BITS)
+
+//The 8 bit samples are scaled with 128 to keep the difference with the average within Q15
+#define FFT_SAMPLE_SHIFT                 7
+#define FFT_SAMPLE_FULL_SCALE            (128 << FFT_SAMPLE_SHIFT)
+
+#define FFT_WINDOW_HANN                  0
+#define FFT_WINDOW_BLACKMAN              1
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fft_init(void);
+void fft_set_window(uint32 window, uint32 bits);
+
+void fft_process_samples(uint8 *samples);
+void fft_compute(int16 *real, int16 *imag, uint32 bits);
+
+int32 fft_get_bin_db(uint32 bin);
+int32 fft_power_to_db(uint32 power);
+
+int16 fft_sine(uint32 angle);
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#endif /* FFT_MATH_H */
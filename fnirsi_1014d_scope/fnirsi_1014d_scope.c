@@ -6,6 +6,7 @@
 #include "spi_control.h"
 #include "timer.h"
 #include "interrupt.h"
+#include "mmu_control.h"
 #include "display_control.h"
 #include "uart.h"
 #include "fpga_control.h"
@@ -16,6 +17,7 @@
 #include "scope_functions.h"
 #include "user_interface_functions.h"
 #include "statemachine.h"
+#include "fft_math.h"
 
 #include "sd_card_interface.h"
 #include "ff.h"
@@ -32,6 +34,10 @@
 
 #define USE_SD_CARD
 
+//Enable to measure the trace display with and without the data cache on startup
+//#define DISPLAY_BENCHMARK
+#define DISPLAY_BENCHMARK_COUNT    32
+
 //----------------------------------------------------------------------------------------------------------------------------------
 
 extern IRQHANDLERFUNCION interrupthandlers[];
@@ -49,9 +55,8 @@ int main(void)
   //Setup the external clock synthesizer for generating the needed FPGA clocks
   clock_synthesizer_setup();
 
-  //Instead of full memory management just the caches enabled
-  arm32_icache_enable();
-  arm32_dcache_enable();
+  //Map the memory and enable the caches. The data cache only works with the MMU enabled
+  sys_init_mmu();
 
   //Clear the interrupt variables
   memset(interrupthandlers, 0, 256);
@@ -59,6 +64,9 @@ int main(void)
   //Setup timer interrupt
   timer0_setup();
 
+  //Setup the free running timer used for measuring the execution times
+  timer1_setup();
+
   //Enable interrupts only once. In the original code it is done on more then one location.
   arm32_interrupt_enable();
 
@@ -77,9 +85,15 @@ int main(void)
   //Initialize display (PORT D + DEBE)
   sys_init_display(SCREEN_WIDTH, SCREEN_HEIGHT, (uint16 *)maindisplaybuffer);
 
+  //Setup the trace and overlay layers on top of the main display buffer
+  display_layers_setup(SCREEN_WIDTH, SCREEN_HEIGHT);
+
   //Setup the display library for the scope hardware
   ui_setup_display_lib();
 
+  //Build the twiddle factors and the window for the spectrum display
+  fft_init();
+
 #ifdef USE_SD_CARD
   //Setup and check SD card on file system being present
   if(f_mount(&fs, "0", 1))
@@ -146,10 +160,60 @@ int main(void)
   //Clear the sample memory
   memset(channel1tracebuffer, 128, sizeof(channel1tracebuffer));
   memset(channel2tracebuffer, 128, sizeof(channel2tracebuffer));
+  memset(channel1longrecord, 128, sizeof(channel1longrecord));
+  memset(channel2longrecord, 128, sizeof(channel2longrecord));
   
   //Show initial trace data. When in NORMAL or SINGLE mode the display needs to be drawn because otherwise if there is no signal it remains black
   scope_display_trace_data();
 
+#ifdef DISPLAY_BENCHMARK
+  {
+    uint32 index;
+    uint32 ticks;
+    uint32 cached;
+    uint32 uncached;
+
+    //Time a number of trace displays with the data cache enabled
+    ticks = timer1_get_ticks();
+
+    for(index=0;index<DISPLAY_BENCHMARK_COUNT;index++)
+    {
+      displaytraceupdate = 1;
+      scope_display_trace_data();
+    }
+
+    cached = (timer1_get_ticks() - ticks) / (DISPLAY_BENCHMARK_COUNT * TIMER1_TICKS_PER_US);
+
+    //Write back and switch off the data cache to get the timing of the original uncached setup
+    arm32_dcache_clean_invalidate_all();
+    arm32_dcache_disable();
+
+    ticks = timer1_get_ticks();
+
+    for(index=0;index<DISPLAY_BENCHMARK_COUNT;index++)
+    {
+      displaytraceupdate = 1;
+      scope_display_trace_data();
+    }
+
+    uncached = (timer1_get_ticks() - ticks) / (DISPLAY_BENCHMARK_COUNT * TIMER1_TICKS_PER_US);
+
+    //Back to normal operation
+    arm32_dcache_enable();
+
+    //Show the results in micro seconds per display for a while
+    display_set_screen_buffer((uint16 *)maindisplaybuffer);
+    display_set_fg_color(COLOR_WHITE);
+    display_set_font(&font_2);
+    display_text(30, 70, "uncached us");
+    display_decimal(130, 70, uncached);
+    display_text(30, 85, "cached us");
+    display_decimal(130, 85, cached);
+
+    timer0_delay(5000);
+  }
+#endif
+
   //Set screen brightness
   fpga_set_translated_brightness();
 
@@ -178,6 +242,12 @@ int main(void)
       //Display the trace data and the other enabled screen items
       scope_display_trace_data();
     }
+
+    //Write the stage timing to the SD card once every second when logging is enabled
+    if((scopesettings.timingmode == TIMING_MODE_OVERLAY_LOG) && timinglogupdate)
+    {
+      ui_log_timing_data();
+    }
   }
 }
 
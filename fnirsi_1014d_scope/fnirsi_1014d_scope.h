@@ -88,6 +88,7 @@
 #define TRIGGER_COLOR               COLOR_GREEN
 
 #define XYMODE_COLOR                COLOR_MAGENTA
+#define MATH_COLOR                  COLOR_MAGENTA
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
@@ -6,6 +6,7 @@
 #include "statemachine.h"
 #include "timer.h"
 #include "variables.h"
+#include "arm32.h"
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
@@ -480,6 +481,34 @@ void fpga_set_time_base(uint32 timebase)
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void fpga_do_conversion(void)
+{
+  //Arm the FPGA for a new conversion
+  fpga_start_conversion();
+
+  //Check if sampling with trigger system enabled
+  if(scopesettings.samplemode == 1)
+  {
+    //Make sure the last command is erased
+    toprocesscommand = 0;
+  
+    //Wait for the FPGA to signal triggered or user input is given
+    while(((fpga_read_byte() & 1) == 0) && (uart1_get_user_input() == 0));
+    
+    //Disable trigger system
+    fpga_end_conversion();
+  }
+  else
+  {
+    //Without trigger wait until the buffer is filled
+    while((fpga_read_byte() & 1) == 0);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Non blocking variant of the conversion. The FPGA is armed here and the main loop polls it with fpga_check_conversion_done
+//so the rendering of the previous trace can be done while the FPGA fills its sample memory
+
+void fpga_start_conversion(void)
 {
   //Check if sampling with trigger system enabled
   if(scopesettings.samplemode == 1)
@@ -522,25 +551,30 @@ void fpga_do_conversion(void)
   
   //Send check on triggered or buffer full command to the FPGA
   fpga_write_cmd(0x0A);
+}
 
-  //Check if sampling with trigger system enabled
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint8 fpga_check_conversion_done(void)
+{
+  //Other commands might have been send in between so select the triggered or buffer full status again
+  fpga_write_cmd(0x0A);
+
+  //Return the state of the flag
+  return(fpga_read_byte() & 1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_end_conversion(void)
+{
+  //Only needed when sampling with trigger system enabled
   if(scopesettings.samplemode == 1)
   {
-    //Make sure the last command is erased
-    toprocesscommand = 0;
-  
-    //Wait for the FPGA to signal triggered or user input is given
-    while(((fpga_read_byte() & 1) == 0) && (uart1_get_user_input() == 0));
-    
     //Disable trigger system???
     fpga_write_cmd(0x0F);
     fpga_write_byte(0x01);
   }
-  else
-  {
-    //Without trigger wait until the buffer is filled
-    while((fpga_read_byte() & 1) == 0);
-  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -599,15 +633,10 @@ uint8 fpga_had_trigger(void)
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
-void fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint)
+void fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint, uint32 inputs)
 {
-  uint32 threshold;
-  
-  //Clear min and max and average for new calculations
-  settings->min     = 0x7FFFFFFF;
-  settings->max     = 0;
-  settings->average = 0;
-  settings->rms     = 0;
+  //Make sure the compensation lookup tables match the current compensation values
+  fpga_check_compensation_tables(settings);
   
   //Send command 0x1F to the FPGA followed by the translated data returned from command 0x14
   fpga_write_cmd(0x1F);
@@ -616,48 +645,19 @@ void fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint)
   //Send a command for getting ADC1 trace data from the FPGA
   fpga_write_cmd(settings->adc1command);
   
+  //Read the data for the first ADC. Samples start on the second location, skipping every other sample
+  fpga_read_burst(&settings->tracebuffer[1], SAMPLES_PER_ADC, 2);
+  
   //Signal no checking on the first ADC when compensating
   settings->checkfirstadc = 0;
   
-  //Setup for reading the first ADC
-  settings->compensation = settings->adc1compensation;
+  //Compensate and process the data of the first ADC
   settings->buffer = &settings->tracebuffer[1];
-  
-  //Read the data for the first ADC. Samples start on the second location, skipping every other sample
-  fpga_read_adc_data(settings);
+  fpga_process_adc_data(settings, settings->compensationtables->adc1);
 
-  //Save the calculated measurements
+  //Save the raw average for the calibration
   settings->adc1rawaverage = settings->rawaverage;
-  
-  //Calculate the signal center for frequency determination
-  settings->center = (settings->max + settings->min) / 2;
-  
-  //Calculate a zero crossing threshold value
-  threshold = ((settings->max - settings->min) / 10) + 2;
-  
-  //Set levels for detecting zero crossings
-  settings->highlevel = settings->center + threshold;
-  settings->lowlevel  = settings->center - threshold;
-  
-  //Initialize the frequency determination
-  settings->zerocrossings   = 0;
-  settings->lowsamplecount  = 0;
-  settings->lowdivider      = 0;
-  settings->highsamplecount = 0;
-  settings->highdivider     = 0;
-  
-  //See in which state the signal starts
-  if(settings->tracebuffer[1] > settings->highlevel)
-  {
-    //Above high it is a one
-    settings->state = 1;
-  }
-  else
-  {
-    //Below start with a zero
-    settings->state = 0;
-  }
-  
+
   //Send command 0x1F to the FPGA followed by the translated data returned from command 0x14
   fpga_write_cmd(0x1F);
   fpga_write_short(triggerpoint);
@@ -665,42 +665,167 @@ void fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint)
   //Send a command for getting ADC2 trace data from the FPGA
   fpga_write_cmd(settings->adc2command);
 
+  //Read the data for the second ADC. Samples start on the first location, skipping every other sample
+  fpga_read_burst(&settings->tracebuffer[0], SAMPLES_PER_ADC, 2);
+
   //Signal to check the readings of the first ADC on being zero when compensating
   settings->checkfirstadc = 1;
 
-  //Setup for reading the first ADC
-  settings->compensation = settings->adc2compensation;
+  //Compensate and process the data of the second ADC
   settings->buffer = &settings->tracebuffer[0];
-  
-  //Read the data for the second ADC. Samples start on the first location, skipping every other sample
-  fpga_read_adc_data(settings);
+  fpga_process_adc_data(settings, settings->compensationtables->adc2);
 
-  //Save the calculated measurements
+  //Save the raw average for the calibration
   settings->adc2rawaverage = settings->rawaverage;
-  
-  //Calculate the overall average
-  settings->average /= SAMPLE_COUNT;
 
-  //Calculate the RMS
-  settings->rms = isqrt(settings->rms / SAMPLE_COUNT);
+  //The measurements of the previous samples are no longer valid
+  settings->measurementinputs = 0;
 
-  //Calculate the peak to peak value
-  settings->peakpeak = settings->max - settings->min;
-  
-  //Calculate the signal center
-  settings->center = (settings->max + settings->min) / 2;
+  //Only do the measurement passes the caller needs. Others can be done later on from the trace buffer
+  fpga_compute_measurement_inputs(settings, inputs);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Computes the given measurement inputs from the samples in the trace buffer when they are not done yet for these samples. This
+//allows the consumers of the measurements to ask for what they need, so the passes are only done once per capture and only when
+//something uses them
+
+void fpga_compute_measurement_inputs(PCHANNELSETTINGS settings, uint32 inputs)
+{
+  //The zero crossing levels are based on the signal center
+  if(inputs & MEASUREMENT_INPUT_CROSSINGS)
+  {
+    inputs |= MEASUREMENT_INPUT_STATISTICS;
+  }
+
+  //Skip what is already there
+  inputs &= ~settings->measurementinputs;
+
+  if(inputs & MEASUREMENT_INPUT_STATISTICS)
+  {
+    //Clear min and max and average for new calculations
+    settings->min     = 0x7FFFFFFF;
+    settings->max     = 0;
+    settings->average = 0;
+    settings->rms     = 0;
+
+    //Get the measurements on the first ADC samples. These are in the odd bytes of the buffer
+    fpga_get_sample_statistics(settings, 8);
+
+    //Add the measurements on the second ADC samples. These are in the even bytes of the buffer
+    fpga_get_sample_statistics(settings, 0);
+
+    //Calculate the overall average
+    settings->average /= SAMPLE_COUNT;
+
+    //Calculate the RMS
+    settings->rms = isqrt(settings->rms / SAMPLE_COUNT);
+
+    //Calculate the peak to peak value
+    settings->peakpeak = settings->max - settings->min;
+    
+    //Calculate the signal center
+    settings->center = (settings->max + settings->min) / 2;
+
+    //With extra resolution in the samples the voltages are also taken with fraction bits
+    if(settings->precisionbits)
+    {
+      fpga_get_precise_statistics(settings);
+    }
+  }
+
+  if(inputs & MEASUREMENT_INPUT_CROSSINGS)
+  {
+    fpga_get_zero_crossings(settings);
+  }
+
+  settings->measurementinputs |= inputs;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Determines the average high and low times of the signal from the zero crossings of the second ADC samples, with hysteresis
+//around the signal center
+
+void fpga_get_zero_crossings(PCHANNELSETTINGS settings)
+{
+  register uint8  *buffer = settings->tracebuffer;
+  register uint32  count = SAMPLES_PER_ADC;
+  register int32   sample;
+  register int32   highlevel;
+  register int32   lowlevel;
+  register uint32  state;
+  register uint32  previousindex = 0;
+  uint32 threshold;
+  uint32 zerocrossings = 0;
+  uint32 lowsamplecount = 0;
+  uint32 lowdivider = 0;
+  uint32 highsamplecount = 0;
+  uint32 highdivider = 0;
+
+  //Calculate a zero crossing threshold value
+  threshold = ((settings->max - settings->min) / 10) + 2;
   
+  //Set levels for detecting zero crossings
+  highlevel = settings->center + threshold;
+  lowlevel  = settings->center - threshold;
+
+  //See in which state the signal starts. Above high it is a one, otherwise start with a zero
+  state = (buffer[0] > highlevel);
+
+  //The samples of the second ADC are in the even bytes of the buffer
+  while(count)
+  {
+    sample = *buffer;
+
+    //Check against the high level when low or against the low level when high
+    if((state == 0) && (sample > highlevel))
+    {
+      //If so flip the state
+      state = 1;
+
+      //From the second zero crossing on add the samples of the low part of the signal
+      if(zerocrossings)
+      {
+        lowsamplecount += previousindex - count;
+        lowdivider++;
+      }
+
+      previousindex = count;
+      zerocrossings++;
+    }
+    else if((state == 1) && (sample < lowlevel))
+    {
+      state = 0;
+
+      //From the second zero crossing on add the samples of the high part of the signal
+      if(zerocrossings)
+      {
+        highsamplecount += previousindex - count;
+        highdivider++;
+      }
+
+      previousindex = count;
+      zerocrossings++;
+    }
+
+    //Skip the sample of the other ADC
+    buffer += 2;
+    count--;
+  }
+
+  settings->zerocrossings = zerocrossings;
+
   //Calculate the frequency if possible
-  if(settings->zerocrossings > 2)
+  if(zerocrossings > 2)
   {
     //Signal valid frequency determination possible
     settings->frequencyvalid = 1;
     
     //Calculate the average high time of the signal expressed in samples
-    settings->hightime = ((settings->highsamplecount << 20) / settings->highdivider) * 2;
+    settings->hightime = ((highsamplecount << 20) / highdivider) * 2;
     
     //Calculate the average low time of the signal expressed in samples
-    settings->lowtime = ((settings->lowsamplecount << 20) / settings->lowdivider) * 2;
+    settings->lowtime = ((lowsamplecount << 20) / lowdivider) * 2;
     
     //Calculate the period time expressed in samples
     settings->periodtime = settings->hightime + settings->lowtime;
@@ -717,187 +842,427 @@ void fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint)
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
-void fpga_read_adc_data(PCHANNELSETTINGS settings)
+void fpga_check_compensation_tables(PCHANNELSETTINGS settings)
 {
+  register PADCCOMPENSATION tables = settings->compensationtables;
+  register int32  adc1compensation = settings->adc1compensation;
+  register int32  adc2compensation = settings->adc2compensation;
   register int32  sample;
-  register uint32 count;
-  register uint32 sum = 0;
+  register uint32 index;
+  register uint32 flags;
+
+  //Check if the tables are still valid for the current compensation values
+  if(tables->valid && (tables->adc1compensation == adc1compensation) && (tables->adc2compensation == adc2compensation))
+  {
+    //Nothing to do when so
+    return;
+  }
+
+  //Signal the tables are build for the current compensation values
+  tables->adc1compensation = adc1compensation;
+  tables->adc2compensation = adc2compensation;
+  tables->valid = 1;
+
+  //Handle all the possible sample values
+  for(index=0;index<256;index++)
+  {
+    //Compensate the value for ADC in equality and keep it within the 0 to 255 range
+    sample = index + adc1compensation;
+    tables->adc1[index] = (sample < 0) ? 0 : (sample > 255) ? 255 : sample;
+
+    sample = index + adc2compensation;
+    tables->adc2[index] = (sample < 0) ? 0 : (sample > 255) ? 255 : sample;
+
+    //Determine the merge flags for this compensated sample value
+    flags = 0;
+
+    //When ADC1 compensation is positive, ADC1 bottoms out on this value
+    //Near the top ADC2 reaches the top value first, so same method is needed
+    if(adc1compensation > 0)
+    {
+      //So when the compensated ADC2 sample is below the ADC1 compensation value the reading needs to be matched
+      if((int32)index < adc1compensation)
+      {
+        flags |= ADC_MERGE_USE_ADC2;
+      }
+
+      //Or when the compensated ADC1 sample is above max value ADC2 can reach the reading also needs to be matched
+      if((int32)index > (255 + adc2compensation))
+      {
+        flags |= ADC_MERGE_USE_ADC1;
+      }
+    }
+    //When ADC1 compensation is negative, ADC2 bottoms out on it's compensation value
+    else if(adc1compensation < 0)
+    {
+      //So when the compensated ADC1 sample is below the ADC2 compensation value the reading needs to be matched
+      if((int32)index < adc2compensation)
+      {
+        flags |= ADC_MERGE_USE_ADC1;
+      }
+
+      //Or when the compensated ADC2 sample is above max value ADC1 can reach the reading also needs to be matched
+      if((int32)index > (255 + adc1compensation))
+      {
+        flags |= ADC_MERGE_USE_ADC2;
+      }
+    }
+
+    tables->merge[index] = flags;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Read the FPGA sample memory around the trigger point in multiple windows into the long record of the channel. Needs to be called
+//after fpga_read_sample_data since the compensation tables need to be up to date
+
+void fpga_read_long_record(PCHANNELSETTINGS settings, uint32 triggerpoint)
+{
+  register uint8  *buffer;
+  register uint8  *adc1 = settings->compensationtables->adc1;
+  register uint8  *adc2 = settings->compensationtables->adc2;
+  register uint8  *merge = settings->compensationtables->merge;
+  register uint32  sample1;
+  register uint32  sample2;
+  register uint32  count;
+  uint32 window;
+  uint32 address;
+
+  //The trace buffer starts on the given trigger point, so go back half the extra samples to center it in the record
+  address = triggerpoint - ((LONG_RECORD_SAMPLES_PER_ADC - SAMPLES_PER_ADC) / 2);
+
+  //Read the record in a number of windows
+  for(window=0;window<LONG_RECORD_WINDOWS;window++)
+  {
+    //Point to where the window needs to be stored in the record
+    buffer = &settings->longrecord[window * LONG_RECORD_WINDOW_SIZE * 2];
+
+    //Set the FPGA read address to the start of this window. The sample memory wraps around
+    fpga_write_cmd(0x1F);
+    fpga_write_short(address & FPGA_SAMPLE_MEMORY_MASK);
+
+    //Read the ADC1 data for this window. Samples start on the second location, skipping every other sample
+    fpga_write_cmd(settings->adc1command);
+    fpga_read_burst(&buffer[1], LONG_RECORD_WINDOW_SIZE, 2);
+
+    //Set the same read address for the ADC2 data
+    fpga_write_cmd(0x1F);
+    fpga_write_short(address & FPGA_SAMPLE_MEMORY_MASK);
+
+    //Read the ADC2 data for this window. Samples start on the first location, skipping every other sample
+    fpga_write_cmd(settings->adc2command);
+    fpga_read_burst(&buffer[0], LONG_RECORD_WINDOW_SIZE, 2);
+
+    //Next window starts directly after this one
+    address += LONG_RECORD_WINDOW_SIZE;
+  }
+
+  //Compensate the raw samples in the record
+  buffer = settings->longrecord;
+
+  for(count=0;count<LONG_RECORD_SAMPLES_PER_ADC;count++)
+  {
+    //Get the compensated samples of both ADC's
+    sample1 = adc1[buffer[1]];
+    sample2 = adc2[buffer[0]];
+
+    //Match the two readings the same way as for the trace buffer when one of the ADC's bottoms or tops out
+    if(settings->adc1compensation > 0)
+    {
+      if(merge[sample2] & ADC_MERGE_USE_ADC2)
+      {
+        sample1 = sample2;
+      }
+      else if(merge[sample1] & ADC_MERGE_USE_ADC1)
+      {
+        sample2 = sample1;
+      }
+    }
+    else if(settings->adc1compensation < 0)
+    {
+      if(merge[sample1] & ADC_MERGE_USE_ADC1)
+      {
+        sample2 = sample1;
+      }
+      else if(merge[sample2] & ADC_MERGE_USE_ADC2)
+      {
+        sample1 = sample2;
+      }
+    }
+
+    //Store the compensated samples
+    buffer[0] = sample2;
+    buffer[1] = sample1;
+
+    buffer += 2;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Read a block of data from the FPGA with as little work as possible between the clock pulses. The clock is driven by writing
+//precalculated images of the port register instead of read modify write actions, and the loop is unrolled four times
+
+void fpga_read_burst(uint8 *dst, uint32 count, uint32 stride)
+{
+  register uint32 clocklow;
+  register uint32 clockhigh;
+  register uint32 blocks;
+  register uint32 data;
   
   //Set the bus for reading
   FPGA_BUS_DIR_IN();
   
-  //Set the control lines for reading a command
+  //Set the control lines for reading data
   FPGA_DATA_READ();
-  
-  //Set the number of samples to read
+
+  //Create the register images for the clock line low and high. The other bits do not change during the burst
+  clockhigh = *FPGA_DATA_REG | 0x00000100;
+  clocklow  = clockhigh & 0xFFFFFEFF;
+
+  //Read the data in blocks of four samples
+  blocks = count >> 2;
+
+  if(blocks)
+  {
+    __asm__ __volatile__
+    (
+      "1:\n"
+      "str  %[low], [%[reg]]\n"
+      "str  %[high], [%[reg]]\n"
+      "ldr  %[data], [%[reg]]\n"
+      "strb %[data], [%[dst]], %[stride]\n"
+      "str  %[low], [%[reg]]\n"
+      "str  %[high], [%[reg]]\n"
+      "ldr  %[data], [%[reg]]\n"
+      "strb %[data], [%[dst]], %[stride]\n"
+      "str  %[low], [%[reg]]\n"
+      "str  %[high], [%[reg]]\n"
+      "ldr  %[data], [%[reg]]\n"
+      "strb %[data], [%[dst]], %[stride]\n"
+      "str  %[low], [%[reg]]\n"
+      "str  %[high], [%[reg]]\n"
+      "ldr  %[data], [%[reg]]\n"
+      "strb %[data], [%[dst]], %[stride]\n"
+      "subs %[blocks], %[blocks], #1\n"
+      "bne  1b\n"
+      : [dst] "+r" (dst), [blocks] "+r" (blocks), [data] "=&r" (data)
+      : [reg] "r" (FPGA_DATA_REG), [low] "r" (clocklow), [high] "r" (clockhigh), [stride] "r" (stride)
+      : "cc", "memory"
+    );
+  }
+
+  //Read the remaining samples
+  for(count&=3;count;count--)
+  {
+    //Clock the data to the output of the FPGA
+    *FPGA_DATA_REG = clocklow;
+    *FPGA_DATA_REG = clockhigh;
+
+    //Store the data
+    *dst = FPGA_GET_DATA();
+    dst += stride;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_process_adc_data(PCHANNELSETTINGS settings, uint8 *lookup)
+{
+  register uint8  *buffer = settings->buffer;
+  register uint8  *merge = settings->compensationtables->merge;
+  register int32   checkfirstadc = settings->checkfirstadc;
+  register int32   adc1compensation = settings->adc1compensation;
+  register int32   sample;
+  register uint32  count;
+  register uint32  sum = 0;
+  
+  //Set the number of samples to process
   count = SAMPLES_PER_ADC;
   
-  //Read the data as long as there is count
+  //Process the data as long as there is count
   while(count)
   {
-    //Clock the data to the output of the FPGA
-    FPGA_PULSE_CLK();
-
-    //Read the data
-    sample = FPGA_GET_DATA();
+    //Get the raw sample
+    sample = *buffer;
     
     //Sum the raw data for ADC difference calibration
     sum += sample;
 
     //Compensate the value for ADC in equality
-    sample += settings->compensation;
-    
-    //Check if sample became negative
-    if(sample < 0)
-    {
-      //Keep it on zero if so
-      sample = 0;
-    }
-    
-    //Check if sample over its max
-    if(sample > 255)
-    {
-      //Keep it on max if so
-      sample = 255;
-    }
+    sample = lookup[sample];
     
     //Check if busy with second ADC data
-    if(settings->checkfirstadc)
+    if(checkfirstadc)
     {
-      //When ADC1 compensation is positive, ADC1 bottoms out on this value
-      //Near the top ADC2 reaches the top value first, so same method is needed
-      if(settings->adc1compensation > 0)
+      //When ADC1 compensation is positive the ADC2 sample takes precedence
+      if(adc1compensation > 0)
       {
-        //So when the compensated ADC2 sample is below the ADC1 compensation value the reading needs to be matched
-        if(sample < settings->adc1compensation)
+        //Match the two readings when within compensation range
+        if(merge[sample] & ADC_MERGE_USE_ADC2)
         {
-          //Match the two readings when within compensation range
-          settings->buffer[1] = sample;
+          buffer[1] = sample;
         }
-        //Or when the compensated ADC1 sample is above max value ADC2 can reach the reading also needs to be matched
-        else if(settings->buffer[1] > (255 + settings->adc2compensation))
+        //Use the compensated ADC1 sample when it is above the max value ADC2 can reach
+        else if(merge[buffer[1]] & ADC_MERGE_USE_ADC1)
         {
-          //Use the compensated ADC1 sample in that case
-          sample = settings->buffer[1];
+          sample = buffer[1];
         }
       }
-      //When ADC1 compensation is negative, ADC2 bottoms out on it's compensation value
-      else if(settings->adc1compensation < 0)
+      //When ADC1 compensation is negative the ADC1 sample takes precedence
+      else if(adc1compensation < 0)
       {
-        //So when the compensated ADC1 sample is below the ADC2 compensation value the reading needs to be matched
-        if(settings->buffer[1] < settings->adc2compensation)
+        //Use the compensated ADC1 sample when it is below the ADC2 compensation value
+        if(merge[buffer[1]] & ADC_MERGE_USE_ADC1)
         {
-          //Use the compensated ADC1 sample in that case
-          sample = settings->buffer[1];
+          sample = buffer[1];
         }
-        //Or when the compensated ADC2 sample is above max value ADC1 can reach the reading also needs to be matched
-        else if(sample > (255 + settings->adc1compensation))
+        //Match the two readings when the compensated ADC2 sample is above the max value ADC1 can reach
+        else if(merge[sample] & ADC_MERGE_USE_ADC2)
         {
-          //Match the two readings when within compensation range
-          settings->buffer[1] = sample;
+          buffer[1] = sample;
         }
       }
     }
     
-    //Get the minimum value of the samples
-    if(sample < settings->min)
-    {
-      //Keep the lowest
-      settings->min = sample;
-    }
-    
-    //Get the maximum value of the samples
-    if(sample > settings->max)
-    {
-      //Keep the highest
-      settings->max = sample;
-    }
-    
-    //Add the samples for average calculation
-    settings->average += sample;
+    //Store the data
+    *buffer = sample;
 
-	//Add squares of the samples for RMS calculation
-	settings->rms += (sample - 128) * (sample - 128);
+    //Skip the sample of the other ADC
+    buffer += 2;
     
-    //Store the data
-    *settings->buffer = sample;
+    //One sample done
+    count--;
+  }
+ 
+  //Calculate the raw average
+  settings->rawaverage = sum / SAMPLES_PER_ADC;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Measurement pass over the samples of a single ADC. These are interleaved with the other ADC so each 32 bit load holds two samples
+//of the selected ADC. These are masked into the two 16 bit halves of a word, which allows summing both with a single add and using
+//the DSP multiply accumulate instructions for the squares
 
-    //Check if busy with second ADC data to see if frequency determination can be done
-    if(settings->checkfirstadc)
+void fpga_get_sample_statistics(PCHANNELSETTINGS settings, uint32 shift)
+{
+  register uint32 *buffer = (uint32 *)settings->tracebuffer;
+  register uint32  count = SAMPLE_COUNT / 4;
+  register uint32  block;
+  register uint32  samples;
+  register int32   sample;
+  register int32   min = settings->min;
+  register int32   max = settings->max;
+  register uint32  halves;
+  register uint32  sum = 0;
+  register uint32  squares = 0;
+
+  //Process the buffer in blocks to avoid the 16 bit sums overflowing. 256 * 255 still fits
+  while(count)
+  {
+    //Determine the size of this block
+    block = (count > 256) ? 256 : count;
+    count -= block;
+
+    //Clear the per half sums
+    halves = 0;
+
+    while(block)
     {
-      //Check against the high level
-      if(sample > settings->highlevel)
+      //Get the two samples of the selected ADC in the lower byte of each half word
+      samples = (*buffer++ >> shift) & 0x00FF00FF;
+
+      //Sum both samples at once for the average
+      halves += samples;
+
+      //Add the squares of both samples for the RMS
+      squares = arm32_smlabb(squares, samples, samples);
+      squares = arm32_smlatt(squares, samples, samples);
+
+      //Check the first sample on being a new minimum or maximum
+      sample = samples & 0xFF;
+
+      if(sample < min)
       {
-        //If above, check if in low state
-        if(settings->state == 0)
-        {
-          //If so flip the state
-          settings->state = 1;
-          
-          //Check if first zero crossing detected
-          if(settings->zerocrossings == 0)
-          {
-            //Set the previous index if so
-            settings->previousindex = count;
-          }
-          else
-          {
-            //Calculate the total number of samples in the low parts of the signal
-            settings->lowsamplecount += settings->previousindex - count;
-            
-            //Add one to the low divider for average calculation
-            settings->lowdivider++;
-            
-            //Set the new previous index
-            settings->previousindex = count;
-          }
-
-          //Found a zero crossing
-          settings->zerocrossings++;
-        }
+        min = sample;
       }
-      //Check against the low level
-      else if(sample < settings->lowlevel)
+
+      if(sample > max)
       {
-        //If below check if in high state
-        if(settings->state == 1)
-        {
-          //If so flip the state
-          settings->state = 0;
-
-          //Check if first zero crossing detected
-          if(settings->zerocrossings == 0)
-          {
-            //Set the previous index if so
-            settings->previousindex = count;
-          }
-          else
-          {
-            //Calculate the total number of samples in the high parts of the signal
-            settings->highsamplecount += settings->previousindex - count;
-            
-            //Add one to the low divider for average calculation
-            settings->highdivider++;
-            
-            //Set the new previous index
-            settings->previousindex = count;
-          }
-          
-          //Found a zero crossing
-          settings->zerocrossings++;
-        }
+        max = sample;
       }
-    }    
-    
-    //Skip a sample to allow for ADC2 data to be placed into
-    settings->buffer += 2;
-    
-    //One read done
+
+      //Same for the second sample
+      sample = samples >> 16;
+
+      if(sample < min)
+      {
+        min = sample;
+      }
+
+      if(sample > max)
+      {
+        max = sample;
+      }
+
+      block--;
+    }
+
+    //Add the two half word sums to the total
+    sum += (halves & 0xFFFF) + (halves >> 16);
+  }
+
+  //Store the results
+  settings->min = min;
+  settings->max = max;
+  settings->average += sum;
+
+  //The squares are on the raw samples, so convert to the sum of (sample - 128)^2 = sample^2 - 256 * sample + 16384
+  settings->rms += squares - (sum * 256) + (16384 * SAMPLES_PER_ADC);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Gets the voltage measurements with STATISTICS_FRACTION_BITS fraction bits from the samples with extra resolution of the averaging
+//and high resolution modes. These are not split per ADC, so a plain single pass does it
+
+void fpga_get_precise_statistics(PCHANNELSETTINGS settings)
+{
+  register uint16 *buffer = settings->averagebuffer;
+  register uint32  shift = STATISTICS_FRACTION_BITS - settings->precisionbits;
+  register uint32  count = SAMPLE_COUNT;
+  register int32   sample;
+  register int32   min = 0x7FFFFFFF;
+  register int32   max = 0;
+  register uint32  sum = 0;
+  uint64 squares = 0;
+
+  while(count)
+  {
+    //Bring the sample to the measurement fraction bits, centered on the ADC center value for the RMS
+    sample = *buffer++ << shift;
+
+    sum += sample;
+
+    if(sample < min)
+    {
+      min = sample;
+    }
+
+    if(sample > max)
+    {
+      max = sample;
+    }
+
+    sample -= 128 << STATISTICS_FRACTION_BITS;
+
+    squares += (int64)sample * sample;
+
     count--;
   }
- 
-  //Calculate the raw average
-  settings->rawaverage = sum / SAMPLES_PER_ADC;
+
+  settings->precisemin = min;
+  settings->precisemax = max;
+  settings->preciseaverage = sum / SAMPLE_COUNT;
+  settings->preciserms = isqrt(squares / SAMPLE_COUNT);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
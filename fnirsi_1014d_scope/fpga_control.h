@@ -77,13 +77,25 @@ void   fpga_set_trigger_level(void);
 void   fpga_set_trigger_mode(void);
 
 void   fpga_do_conversion(void);
+void   fpga_start_conversion(void);
+uint8  fpga_check_conversion_done(void);
+void   fpga_end_conversion(void);
 
 uint16 fpga_prepare_for_transfer(void);
 
 uint8  fpga_had_trigger(void);
 
-void   fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint);
-void   fpga_read_adc_data(PCHANNELSETTINGS settings);
+void   fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint, uint32 inputs);
+void   fpga_compute_measurement_inputs(PCHANNELSETTINGS settings, uint32 inputs);
+void   fpga_get_zero_crossings(PCHANNELSETTINGS settings);
+void   fpga_check_compensation_tables(PCHANNELSETTINGS settings);
+void   fpga_read_long_record(PCHANNELSETTINGS settings, uint32 triggerpoint);
+void   fpga_read_burst(uint8 *dst, uint32 count, uint32 stride);
+void   fpga_process_adc_data(PCHANNELSETTINGS settings, uint8 *lookup);
+void   fpga_get_sample_statistics(PCHANNELSETTINGS settings, uint32 shift);
+void   fpga_get_precise_statistics(PCHANNELSETTINGS settings);
+
+uint32 isqrt(uint32 n);
 
 
 
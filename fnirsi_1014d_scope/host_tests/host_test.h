@@ -0,0 +1,114 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+//Support for building parts of the scope firmware on a PC for checking and timing them
+//
+//The test programs include the firmware sources they need directly. This header has to come first, so the C library headers are
+//read before the ARM inline assembly is stubbed out. Anything touching the hardware is never called by the tests, it only needs to
+//compile. Unused code is dropped by the linker, so only the firmware functions that are used need to resolve:
+//
+//  gcc -O2 -w -ffunction-sections -fdata-sections -Wl,--gc-sections -o test test.c
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../types.h"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The inline assembly of the firmware only runs on the ARM926, so make the statements disappear
+
+#define __asm__
+#define __volatile__ HOST_ASM_IGNORE
+#define HOST_ASM_IGNORE(...) ((void)0)
+
+//Replace arm32.h with plain C versions of the DSP instructions the sample processing uses
+#define __ARM32_H__
+
+static inline uint32 arm32_smlabb(uint32 acc, uint32 a, uint32 b)
+{
+  return(acc + (int16)a * (int16)b);
+}
+
+static inline uint32 arm32_smlatt(uint32 acc, uint32 a, uint32 b)
+{
+  return(acc + (int16)(a >> 16) * (int16)(b >> 16));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Test helpers
+
+static uint32 host_test_failures;
+
+//Check a condition and report the failure with the given message
+#define HOST_CHECK(condition, ...)                  \
+  do                                                \
+  {                                                 \
+    if(!(condition))                                \
+    {                                               \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);   \
+      printf(__VA_ARGS__);                          \
+      printf("\n");                                 \
+      host_test_failures++;                         \
+    }                                               \
+  } while(0)
+
+//Fixed random sequence so every run tests the same data
+static uint32 host_test_seed = 0x12345678;
+
+static inline uint32 host_test_random(void)
+{
+  host_test_seed ^= host_test_seed << 13;
+  host_test_seed ^= host_test_seed >> 17;
+  host_test_seed ^= host_test_seed << 5;
+
+  return(host_test_seed);
+}
+
+//Random number between -1.0 and 1.0
+static inline double host_test_random_unit(void)
+{
+  return(((double)host_test_random() / 2147483648.0) - 1.0);
+}
+
+//Monotonic time in nano seconds for the benchmarks
+static inline uint64 host_test_nanoseconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return(((uint64)now.tv_sec * 1000000000ull) + now.tv_nsec);
+}
+
+//CPU cycle counter where the PC has one that can be read from user space, otherwise nano seconds
+static inline uint64 host_test_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return(__builtin_ia32_rdtsc());
+#else
+  return(host_test_nanoseconds());
+#endif
+}
+
+//Report the result and give the exit code for the test program
+static inline int host_test_result(const char *name)
+{
+  if(host_test_failures)
+  {
+    printf("%s: %u checks FAILED\n", name, host_test_failures);
+    return(1);
+  }
+
+  printf("%s: passed\n", name);
+  return(0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#endif /* HOST_TEST_H */
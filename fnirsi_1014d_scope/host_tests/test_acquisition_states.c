@@ -0,0 +1,366 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+//Drives the idle, waiting and ready states of scope_acquire_trace_data with a stubbed FPGA and checks what is done in each of them
+//
+//  gcc -O2 -w -ffunction-sections -fdata-sections -Wl,--gc-sections -o test_acquisition_states test_acquisition_states.c -lm
+//
+//fpga_control.c is not included. The FPGA functions the acquisition uses are replaced by the stubs below, which log the calls and
+//let the test decide when the conversion is done
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "host_test.h"
+
+#include <math.h>
+
+#include "../scope_functions.c"
+#include "../display_lib.c"
+#include "../variables.c"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+//What the stubs have been asked to do since the last reset
+uint32 conversionsstarted;
+uint32 conversionsended;
+uint32 triggerdisables;
+uint32 channelsread;
+uint32 runstoptexts;
+
+//Set by the test to signal the FPGA is done with the conversion
+uint32 conversiondone;
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//FPGA stubs
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_start_conversion(void)
+{
+  conversionsstarted++;
+  conversiondone = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint8 fpga_check_conversion_done(void)
+{
+  return(conversiondone);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_end_conversion(void)
+{
+  conversionsended++;
+
+  //Like the real one the trigger system is only disabled when sampling with it
+  if(scopesettings.samplemode == 1)
+  {
+    triggerdisables++;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint16 fpga_prepare_for_transfer(void)
+{
+  return(1500);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint8 fpga_had_trigger(void)
+{
+  return(1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Fills the trace buffer with a sine crossing the trigger level in the center
+
+void fpga_read_sample_data(PCHANNELSETTINGS settings, uint32 triggerpoint, uint32 inputs)
+{
+  uint32 index;
+
+  for(index=0;index<SAMPLE_COUNT;index++)
+  {
+    settings->tracebuffer[index] = 128 + (int32)(100.0 * sin((2.0 * M_PI * ((int32)index - SAMPLES_PER_ADC)) / 100.0));
+  }
+
+  settings->measurementinputs = 0;
+
+  channelsread++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_read_long_record(PCHANNELSETTINGS settings, uint32 triggerpoint)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_compute_measurement_inputs(PCHANNELSETTINGS settings, uint32 inputs)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_set_trigger_level(void)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void fpga_set_time_base(uint32 timebase)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Timing and user interface stubs
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void timing_start(uint32 stage)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void timing_end(uint32 stage)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void timing_count_waveform(void)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_display_run_stop_text(void)
+{
+  runstoptexts++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_display_trigger_vertical_position(void)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_display_waiting_triggered_text(uint32 state)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Test steps
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void reset_counts(void)
+{
+  conversionsstarted = 0;
+  conversionsended = 0;
+  triggerdisables = 0;
+  channelsread = 0;
+  runstoptexts = 0;
+  displaytraceupdate = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void reset_scope(uint32 triggermode)
+{
+  scopesettings.runstate = RUN_STATE_RUNNING;
+  scopesettings.triggermode = triggermode;
+  scopesettings.triggerlevel = 128;
+  scopesettings.channel1.enable = 1;
+  scopesettings.channel2.enable = 0;
+
+  acquisitionstate = ACQUISITION_STATE_IDLE;
+  historyindex = 0;
+  historycount = 0;
+
+  reset_counts();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void test_free_running(void)
+{
+  uint32 loop;
+
+  reset_scope(0);
+
+  //The first pass only arms the FPGA and returns, so the main loop can render
+  scope_acquire_trace_data();
+
+  HOST_CHECK(acquisitionstate == ACQUISITION_STATE_WAITING, "idle does not go to waiting");
+  HOST_CHECK(conversionsstarted == 1, "idle does not start a conversion");
+  HOST_CHECK(scopesettings.samplemode == 1, "the conversion is not started with the trigger system");
+  HOST_CHECK(channelsread == 0, "samples are read before the conversion is started");
+
+  //While the FPGA is busy the main loop keeps going without reading anything
+  reset_counts();
+
+  for(loop=0;loop<10;loop++)
+  {
+    scope_acquire_trace_data();
+  }
+
+  HOST_CHECK(acquisitionstate == ACQUISITION_STATE_WAITING, "waiting does not stay waiting while the conversion is busy");
+  HOST_CHECK((conversionsstarted == 0) && (conversionsended == 0) && (channelsread == 0), "the FPGA is used while it is busy");
+  HOST_CHECK(displaytraceupdate == 0, "the display is updated without a new capture");
+
+  //When done the capture is read and the FPGA is armed again straight away in the same pass
+  conversiondone = 1;
+  scope_acquire_trace_data();
+
+  HOST_CHECK(triggerdisables == 1, "the trigger system is not disabled after the conversion");
+  HOST_CHECK(channelsread == 1, "the enabled channel is not read once");
+  HOST_CHECK(conversionsstarted == 1, "the FPGA is not re-armed after the read-out");
+  HOST_CHECK(acquisitionstate == ACQUISITION_STATE_WAITING, "running does not go back to waiting after the read-out");
+  HOST_CHECK(displaytraceupdate == 1, "the display is not signaled for the new capture");
+  HOST_CHECK(historycount == 1, "the capture is not added to the history");
+
+  //The re-armed conversion is not done yet, so the next pass waits again
+  reset_counts();
+  scope_acquire_trace_data();
+
+  HOST_CHECK((channelsread == 0) && (acquisitionstate == ACQUISITION_STATE_WAITING), "the re-armed conversion is read before it is done");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void test_single_shot(void)
+{
+  reset_scope(1);
+
+  scope_acquire_trace_data();
+
+  reset_counts();
+  conversiondone = 1;
+  scope_acquire_trace_data();
+
+  HOST_CHECK(channelsread == 1, "the single capture is not read");
+  HOST_CHECK(scopesettings.runstate == RUN_STATE_STOPPED, "single mode does not stop after the capture");
+  HOST_CHECK(runstoptexts == 1, "the stopped state is not shown");
+  HOST_CHECK(conversionsstarted == 0, "single mode arms the FPGA again");
+  HOST_CHECK(acquisitionstate == ACQUISITION_STATE_IDLE, "single mode does not go to idle");
+
+  //Nothing happens anymore while stopped
+  reset_counts();
+  scope_acquire_trace_data();
+
+  HOST_CHECK((conversionsstarted == 0) && (conversionsended == 0) && (channelsread == 0), "the FPGA is used while stopped");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void test_stop_while_waiting(void)
+{
+  reset_scope(0);
+
+  scope_acquire_trace_data();
+
+  //Stopping while the FPGA waits on a trigger drops the capture and disables the trigger system
+  reset_counts();
+  scopesettings.runstate = RUN_STATE_STOPPED;
+  scope_acquire_trace_data();
+
+  HOST_CHECK(triggerdisables == 1, "the trigger system is left enabled when stopped while waiting");
+  HOST_CHECK(channelsread == 0, "the dropped capture is read");
+  HOST_CHECK(acquisitionstate == ACQUISITION_STATE_IDLE, "stopping does not go to idle");
+
+  //Staying stopped does not disable it again
+  reset_counts();
+  scope_acquire_trace_data();
+
+  HOST_CHECK(conversionsended == 0, "the conversion is ended again while idle");
+
+  //Running again starts with arming the FPGA
+  scopesettings.runstate = RUN_STATE_RUNNING;
+  scope_acquire_trace_data();
+
+  HOST_CHECK((conversionsstarted == 1) && (acquisitionstate == ACQUISITION_STATE_WAITING), "running again does not re-arm the FPGA");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void test_channels_disabled(void)
+{
+  reset_scope(0);
+
+  scope_acquire_trace_data();
+
+  //Without an enabled channel there is nothing to capture, so it is handled like stopped
+  reset_counts();
+  scopesettings.channel1.enable = 0;
+  scope_acquire_trace_data();
+
+  HOST_CHECK((triggerdisables == 1) && (acquisitionstate == ACQUISITION_STATE_IDLE), "disabling the channels does not drop the capture");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void test_user_input(void)
+{
+  reset_scope(0);
+
+  scope_acquire_trace_data();
+
+  //Processed user input drops the capture in progress, the same as the state machine does, so the next one uses the new settings
+  reset_counts();
+  scope_abort_acquisition();
+
+  HOST_CHECK(triggerdisables == 1, "the trigger system is left enabled when user input drops the capture");
+  HOST_CHECK(acquisitionstate == ACQUISITION_STATE_IDLE, "user input does not go to idle");
+
+  //A second drop while idle does not touch the FPGA
+  reset_counts();
+  scope_abort_acquisition();
+
+  HOST_CHECK(conversionsended == 0, "the conversion is ended while idle");
+
+  //And the next pass arms the FPGA with the new settings
+  scope_acquire_trace_data();
+
+  HOST_CHECK((conversionsstarted == 1) && (acquisitionstate == ACQUISITION_STATE_WAITING), "the FPGA is not re-armed after user input");
+
+  //A capture that is done but not read yet is dropped the same way. The trigger system was already disabled for it
+  reset_counts();
+  acquisitionstate = ACQUISITION_STATE_READY;
+  scope_abort_acquisition();
+
+  HOST_CHECK((conversionsended == 0) && (acquisitionstate == ACQUISITION_STATE_IDLE), "a ready capture is not dropped without the FPGA");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int main(void)
+{
+  //The buffers and lookup tables as set on loading the configuration
+  scopesettings.channel1.tracebuffer = (uint8 *)channel1tracebuffer;
+  scopesettings.channel1.longrecord  = (uint8 *)channel1longrecord;
+  scopesettings.channel1.tracepoints = channel1pointsbuffer;
+  scopesettings.channel1.tracespans  = channel1spansbuffer;
+  scopesettings.channel1.xlookup     = channel1xlookup;
+  scopesettings.channel1.ylookup     = channel1ylookup;
+  scopesettings.channel1.lookupsettings = SCREEN_LOOKUP_INVALID;
+
+  scopesettings.channel2.tracebuffer = (uint8 *)channel2tracebuffer;
+  scopesettings.channel2.longrecord  = (uint8 *)channel2longrecord;
+  scopesettings.channel2.tracepoints = channel2pointsbuffer;
+  scopesettings.channel2.tracespans  = channel2spansbuffer;
+  scopesettings.channel2.xlookup     = channel2xlookup;
+  scopesettings.channel2.ylookup     = channel2ylookup;
+  scopesettings.channel2.lookupsettings = SCREEN_LOOKUP_INVALID;
+
+  test_free_running();
+  test_single_shot();
+  test_stop_while_waiting();
+  test_channels_disabled();
+  test_user_input();
+
+  return(host_test_result("test_acquisition_states"));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,229 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+//Checks the table driven ADC compensation and merging of fpga_control.c against the per sample branches it replaced and times both
+//
+//  gcc -O2 -w -ffunction-sections -fdata-sections -Wl,--gc-sections -o test_adc_compensation test_adc_compensation.c
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "host_test.h"
+
+#include "../fpga_control.c"
+#include "../variables.c"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define COMPENSATION_RANGE    40
+#define BENCHMARK_RUNS      2000
+#define BENCHMARK_REPEATS     25
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+//Raw readings as the FPGA read-out leaves them in the trace buffer. ADC1 in the odd bytes and ADC2 in the even bytes
+uint8 rawbuffer[SAMPLE_COUNT];
+
+uint8 expectedbuffer[SAMPLE_COUNT];
+uint8 resultbuffer[SAMPLE_COUNT];
+
+//Keeps the compiler from dropping the benchmark loops
+volatile uint32 benchmarksink;
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The compensation and merging as done per sample in the read-out loop before the lookup tables. Returns the raw average
+
+uint32 reference_process_adc_data(uint8 *buffer, int32 compensation, uint32 checkfirstadc, int32 adc1compensation, int32 adc2compensation)
+{
+  uint32 count;
+  uint32 sum = 0;
+  int32  sample;
+
+  for(count=0;count<SAMPLES_PER_ADC;count++)
+  {
+    sample = *buffer;
+
+    sum += sample;
+
+    sample += compensation;
+
+    if(sample < 0)
+    {
+      sample = 0;
+    }
+
+    if(sample > 255)
+    {
+      sample = 255;
+    }
+
+    if(checkfirstadc)
+    {
+      if(adc1compensation > 0)
+      {
+        if(sample < adc1compensation)
+        {
+          buffer[1] = sample;
+        }
+        else if(buffer[1] > (255 + adc2compensation))
+        {
+          sample = buffer[1];
+        }
+      }
+      else if(adc1compensation < 0)
+      {
+        if(buffer[1] < adc2compensation)
+        {
+          sample = buffer[1];
+        }
+        else if(sample > (255 + adc1compensation))
+        {
+          buffer[1] = sample;
+        }
+      }
+    }
+
+    *buffer = sample;
+
+    buffer += 2;
+  }
+
+  return(sum / SAMPLES_PER_ADC);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void reference_read_sample_data(uint8 *buffer, int32 adc1compensation, int32 adc2compensation, uint32 *rawaverages)
+{
+  memcpy(buffer, rawbuffer, SAMPLE_COUNT);
+
+  rawaverages[0] = reference_process_adc_data(&buffer[1], adc1compensation, 0, adc1compensation, adc2compensation);
+  rawaverages[1] = reference_process_adc_data(&buffer[0], adc2compensation, 1, adc1compensation, adc2compensation);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The processing part of fpga_read_sample_data. The raw samples of both ADC's are copied in at once, since processing the ADC1
+//samples does not touch the ADC2 ones
+
+void firmware_read_sample_data(uint8 *buffer, int32 adc1compensation, int32 adc2compensation, uint32 *rawaverages)
+{
+  PCHANNELSETTINGS settings = &scopesettings.channel1;
+
+  settings->tracebuffer = buffer;
+  settings->adc1compensation = adc1compensation;
+  settings->adc2compensation = adc2compensation;
+
+  fpga_check_compensation_tables(settings);
+
+  memcpy(buffer, rawbuffer, SAMPLE_COUNT);
+
+  settings->checkfirstadc = 0;
+  settings->buffer = &settings->tracebuffer[1];
+  fpga_process_adc_data(settings, settings->compensationtables->adc1);
+  rawaverages[0] = settings->rawaverage;
+
+  settings->checkfirstadc = 1;
+  settings->buffer = &settings->tracebuffer[0];
+  fpga_process_adc_data(settings, settings->compensationtables->adc2);
+  rawaverages[1] = settings->rawaverage;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Raw ADC readings with the two ADC's apart by the given offset, running into both ends of the range
+
+void make_raw_capture(int32 offset)
+{
+  uint32 index;
+  int32  sample;
+
+  for(index=0;index<SAMPLES_PER_ADC;index++)
+  {
+    //Sweep over the full range and past it, so both ADC's bottom and top out
+    sample = ((int32)((index * 7) % 320) - 32) + (int32)(host_test_random() % 5) - 2;
+
+    rawbuffer[(index * 2) + 1] = (sample < 0) ? 0 : (sample > 255) ? 255 : sample;
+
+    sample += offset;
+
+    rawbuffer[index * 2] = (sample < 0) ? 0 : (sample > 255) ? 255 : sample;
+  }
+
+  //Some fully random readings as well
+  for(index=0;index<SAMPLE_COUNT;index+=9)
+  {
+    rawbuffer[index] = host_test_random();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+double benchmark(void (*process)(uint8 *, int32, int32, uint32 *), int32 adc1compensation, int32 adc2compensation)
+{
+  uint32 rawaverages[2];
+  uint64 start;
+  uint64 time;
+  uint64 fastest = ~0ull;
+  uint32 repeat;
+  uint32 run;
+
+  //Take the fastest of a number of rounds to keep other activity on the PC out of the result
+  for(repeat=0;repeat<BENCHMARK_REPEATS;repeat++)
+  {
+    start = host_test_nanoseconds();
+
+    for(run=0;run<BENCHMARK_RUNS;run++)
+    {
+      process(resultbuffer, adc1compensation, adc2compensation, rawaverages);
+      benchmarksink += resultbuffer[run % SAMPLE_COUNT];
+    }
+
+    time = host_test_nanoseconds() - start;
+
+    if(time < fastest)
+    {
+      fastest = time;
+    }
+  }
+
+  //Samples per micro second
+  return(((double)BENCHMARK_RUNS * SAMPLE_COUNT * 1000.0) / (double)fastest);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int main(void)
+{
+  uint32 expectedaverages[2];
+  uint32 resultaverages[2];
+  int32  adc1compensation;
+  int32  adc2compensation;
+
+  scopesettings.channel1.compensationtables = &channel1compensationtables;
+
+  //Check every combination of compensation values in the range, which also checks rebuilding the tables when they change
+  for(adc1compensation=-COMPENSATION_RANGE;adc1compensation<=COMPENSATION_RANGE;adc1compensation++)
+  {
+    for(adc2compensation=-COMPENSATION_RANGE;adc2compensation<=COMPENSATION_RANGE;adc2compensation++)
+    {
+      make_raw_capture(adc2compensation - adc1compensation);
+
+      reference_read_sample_data(expectedbuffer, adc1compensation, adc2compensation, expectedaverages);
+      firmware_read_sample_data(resultbuffer, adc1compensation, adc2compensation, resultaverages);
+
+      HOST_CHECK(memcmp(expectedbuffer, resultbuffer, SAMPLE_COUNT) == 0, "samples differ for compensation %d, %d", adc1compensation, adc2compensation);
+
+      HOST_CHECK((expectedaverages[0] == resultaverages[0]) && (expectedaverages[1] == resultaverages[1]),
+                 "raw averages differ for compensation %d, %d", adc1compensation, adc2compensation);
+    }
+  }
+
+  //Time both versions without and with compensation. The tables stay valid over the runs, like they do on the scope
+  make_raw_capture(6);
+
+  printf("no compensation:     per sample %.0f samples/us, tables %.0f samples/us\n",
+         benchmark(reference_read_sample_data, 0, 0), benchmark(firmware_read_sample_data, 0, 0));
+
+  printf("compensation +3, -3: per sample %.0f samples/us, tables %.0f samples/us\n",
+         benchmark(reference_read_sample_data, 3, -3), benchmark(firmware_read_sample_data, 3, -3));
+
+  return(host_test_result("test_adc_compensation"));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,305 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+//Checks the word parallel measurement passes of fpga_control.c against a plain per sample version and times both
+//
+//  gcc -O2 -w -ffunction-sections -fdata-sections -Wl,--gc-sections -o test_sample_statistics test_sample_statistics.c -lm
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "host_test.h"
+
+#include <math.h>
+
+#include "../fpga_control.c"
+#include "../variables.c"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define CAPTURES           2000
+#define BENCHMARK_RUNS    20000
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+  int32  min;
+  int32  max;
+  uint32 average;
+  uint32 rms;
+  uint32 peakpeak;
+  uint32 center;
+  uint32 zerocrossings;
+  uint32 frequencyvalid;
+  uint32 hightime;
+  uint32 lowtime;
+  uint32 periodtime;
+  uint32 frequency;
+} MEASUREMENTS;
+
+uint8 samples[SAMPLE_COUNT] __attribute__ ((aligned (4)));
+
+//Keeps the compiler from dropping the benchmark loops
+volatile uint32 benchmarksink;
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Per sample statistics as done in the read-out loop before, first over the ADC1 samples in the odd bytes and then over the ADC2
+//samples in the even bytes
+
+void reference_statistics(uint8 *buffer, uint32 adc, MEASUREMENTS *result)
+{
+  uint32 count;
+  int32  sample;
+
+  for(count=0;count<SAMPLES_PER_ADC;count++)
+  {
+    sample = buffer[(count * 2) + adc];
+
+    if(sample < result->min)
+    {
+      result->min = sample;
+    }
+
+    if(sample > result->max)
+    {
+      result->max = sample;
+    }
+
+    result->average += sample;
+
+    result->rms += (sample - 128) * (sample - 128);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Zero crossing detection on the ADC2 samples as done per sample in the read-out loop before
+
+void reference_zero_crossings(uint8 *buffer, MEASUREMENTS *result)
+{
+  uint32 threshold = ((result->max - result->min) / 10) + 2;
+  int32  highlevel = result->center + threshold;
+  int32  lowlevel  = result->center - threshold;
+  uint32 state = (buffer[0] > highlevel);
+  uint32 previousindex = 0;
+  uint32 lowsamplecount = 0;
+  uint32 lowdivider = 0;
+  uint32 highsamplecount = 0;
+  uint32 highdivider = 0;
+  uint32 count;
+  int32  sample;
+
+  result->zerocrossings = 0;
+
+  for(count=SAMPLES_PER_ADC;count;count--)
+  {
+    sample = buffer[(SAMPLES_PER_ADC - count) * 2];
+
+    if(sample > highlevel)
+    {
+      if(state == 0)
+      {
+        state = 1;
+
+        if(result->zerocrossings)
+        {
+          lowsamplecount += previousindex - count;
+          lowdivider++;
+        }
+
+        previousindex = count;
+        result->zerocrossings++;
+      }
+    }
+    else if(sample < lowlevel)
+    {
+      if(state == 1)
+      {
+        state = 0;
+
+        if(result->zerocrossings)
+        {
+          highsamplecount += previousindex - count;
+          highdivider++;
+        }
+
+        previousindex = count;
+        result->zerocrossings++;
+      }
+    }
+  }
+
+  result->frequencyvalid = (result->zerocrossings > 2);
+
+  if(result->frequencyvalid)
+  {
+    result->hightime = ((highsamplecount << 20) / highdivider) * 2;
+    result->lowtime = ((lowsamplecount << 20) / lowdivider) * 2;
+    result->periodtime = result->hightime + result->lowtime;
+    result->frequency = ((uint64)freq_calc_data[scopesettings.samplerate].sample_rate << 20) / result->periodtime;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void reference_measurements(uint8 *buffer, MEASUREMENTS *result)
+{
+  memset(result, 0, sizeof(MEASUREMENTS));
+  result->min = 0x7FFFFFFF;
+
+  reference_statistics(buffer, 1, result);
+  reference_statistics(buffer, 0, result);
+
+  result->average /= SAMPLE_COUNT;
+  result->rms = isqrt(result->rms / SAMPLE_COUNT);
+  result->peakpeak = result->max - result->min;
+  result->center = (result->max + result->min) / 2;
+
+  reference_zero_crossings(buffer, result);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void firmware_measurements(uint8 *buffer, MEASUREMENTS *result)
+{
+  PCHANNELSETTINGS settings = &scopesettings.channel1;
+
+  settings->tracebuffer = buffer;
+  settings->precisionbits = 0;
+  settings->measurementinputs = 0;
+
+  fpga_compute_measurement_inputs(settings, MEASUREMENT_INPUT_STATISTICS | MEASUREMENT_INPUT_CROSSINGS);
+
+  memset(result, 0, sizeof(MEASUREMENTS));
+  result->min = settings->min;
+  result->max = settings->max;
+  result->average = settings->average;
+  result->rms = settings->rms;
+  result->peakpeak = settings->peakpeak;
+  result->center = settings->center;
+  result->zerocrossings = settings->zerocrossings;
+  result->frequencyvalid = settings->frequencyvalid;
+
+  //The times are only set when valid
+  if(result->frequencyvalid)
+  {
+    result->hightime = settings->hightime;
+    result->lowtime = settings->lowtime;
+    result->periodtime = settings->periodtime;
+    result->frequency = settings->frequency;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Fills the buffer with a synthetic capture of the given type with random frequency, phase, amplitude, offset and noise
+
+void make_capture(uint8 *buffer, uint32 type)
+{
+  double period = 8.0 + (host_test_random() % 1500);
+  double phase = host_test_random_unit() * M_PI;
+  double amplitude = 10.0 + (host_test_random() % 200);
+  double offset = 128.0 + (host_test_random_unit() * 100.0);
+  double noise = (host_test_random() % 8);
+  double value;
+  int32  sample;
+  uint32 index;
+
+  for(index=0;index<SAMPLE_COUNT;index++)
+  {
+    switch(type)
+    {
+      case 0:
+        //Random samples over the full range
+        sample = host_test_random() & 0xFF;
+        break;
+
+      case 1:
+        //Clipping sine
+        value = offset + (amplitude * sin(phase + ((2.0 * M_PI * index) / period)));
+        sample = (int32)(value + (noise * host_test_random_unit()));
+        break;
+
+      case 2:
+        //Square wave
+        value = (sin(phase + ((2.0 * M_PI * index) / period)) >= 0) ? amplitude / 2 : -amplitude / 2;
+        sample = (int32)(offset + value + (noise * host_test_random_unit()));
+        break;
+
+      default:
+        //Flat line on the extremes or in between
+        sample = (type == 3) ? 0 : (type == 4) ? 255 : (int32)offset;
+        break;
+    }
+
+    buffer[index] = (sample < 0) ? 0 : (sample > 255) ? 255 : sample;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 compare_measurements(MEASUREMENTS *expected, MEASUREMENTS *result)
+{
+  return((expected->min == result->min) && (expected->max == result->max) && (expected->average == result->average) &&
+         (expected->rms == result->rms) && (expected->peakpeak == result->peakpeak) && (expected->center == result->center) &&
+         (expected->zerocrossings == result->zerocrossings) && (expected->frequencyvalid == result->frequencyvalid) &&
+         (expected->hightime == result->hightime) && (expected->lowtime == result->lowtime) &&
+         (expected->periodtime == result->periodtime) && (expected->frequency == result->frequency));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int main(void)
+{
+  MEASUREMENTS expected;
+  MEASUREMENTS result;
+  uint64 start;
+  uint64 referencetime;
+  uint64 firmwaretime;
+  uint32 capture;
+  uint32 type;
+  uint32 run;
+
+  scopesettings.samplerate = 0;
+
+  //Check the results are the same for all the signal types
+  for(capture=0;capture<CAPTURES;capture++)
+  {
+    type = capture % 6;
+
+    make_capture(samples, type);
+
+    reference_measurements(samples, &expected);
+    firmware_measurements(samples, &result);
+
+    HOST_CHECK(compare_measurements(&expected, &result),
+               "capture %u type %u: min %d/%d max %d/%d avg %u/%u rms %u/%u crossings %u/%u high %u/%u low %u/%u", capture, type,
+               expected.min, result.min, expected.max, result.max, expected.average, result.average, expected.rms, result.rms,
+               expected.zerocrossings, result.zerocrossings, expected.hightime, result.hightime, expected.lowtime, result.lowtime);
+  }
+
+  //Time both versions on a noisy sine
+  make_capture(samples, 1);
+
+  start = host_test_nanoseconds();
+
+  for(run=0;run<BENCHMARK_RUNS;run++)
+  {
+    reference_measurements(samples, &expected);
+    benchmarksink += expected.rms;
+  }
+
+  referencetime = host_test_nanoseconds() - start;
+
+  start = host_test_nanoseconds();
+
+  for(run=0;run<BENCHMARK_RUNS;run++)
+  {
+    firmware_measurements(samples, &result);
+    benchmarksink += result.rms;
+  }
+
+  firmwaretime = host_test_nanoseconds() - start;
+
+  printf("per capture of %u samples: per sample %.2f us, word parallel %.2f us\n", SAMPLE_COUNT,
+         (double)referencetime / (BENCHMARK_RUNS * 1000.0), (double)firmwaretime / (BENCHMARK_RUNS * 1000.0));
+
+  return(host_test_result("test_sample_statistics"));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+//Checks display_draw_trace_line sets the same pixels as display_draw_line and times both on traces
+//
+//  gcc -O2 -w -ffunction-sections -fdata-sections -Wl,--gc-sections -o test_trace_line test_trace_line.c -lm
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "host_test.h"
+
+#include <math.h>
+
+#include "../display_lib.c"
+#include "../variables.c"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define RANDOM_SEGMENTS      50000
+#define TRACE_POINTS           700
+#define BENCHMARK_RUNS         200
+#define BENCHMARK_REPEATS      100
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint16 expectedscreen[SCREEN_WIDTH * SCREEN_HEIGHT];
+uint16 resultscreen[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+//Trace points as the trace display makes them, with a point in every column
+int32 tracey[TRACE_POINTS];
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Draws a segment with both functions on their own screen and compares the screens
+
+void check_segment(int32 xstart, int32 ystart, int32 xend, int32 yend)
+{
+  display_set_screen_buffer(expectedscreen);
+  display_draw_line(xstart, ystart, xend, yend);
+
+  display_set_screen_buffer(resultscreen);
+  display_draw_trace_line(xstart, ystart, xend, yend);
+
+  HOST_CHECK(memcmp(expectedscreen, resultscreen, sizeof(expectedscreen)) == 0, "pixels differ for %d,%d to %d,%d", xstart, ystart, xend, yend);
+
+  //Start the next segment on the same screens when the pixels differ, so the count does not run away
+  if(host_test_failures)
+  {
+    memcpy(resultscreen, expectedscreen, sizeof(expectedscreen));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Random coordinate that is mostly on the screen, but can be past its end. With below zero allowed it can also be before the start.
+//The coordinates are unsigned, so the callers never give an x below zero, since it would break the ordering of the end points
+
+int32 random_coordinate(int32 size, uint32 belowzero)
+{
+  int32 margin = size / 8;
+
+  if(belowzero)
+  {
+    return((int32)(host_test_random() % (size + (2 * margin))) - margin);
+  }
+
+  return(host_test_random() % (size + margin));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Fills the trace with a noisy sine or a square wave with fast edges, which give the long vertical runs
+
+void make_trace(uint32 square)
+{
+  double value;
+  uint32 index;
+
+  for(index=0;index<TRACE_POINTS;index++)
+  {
+    value = sin(index / 23.0);
+
+    if(square)
+    {
+      value = (value >= 0) ? 0.8 : -0.8;
+    }
+
+    tracey[index] = 240 + (int32)((180.0 * value) + (4.0 * host_test_random_unit()));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Returns the fastest time of a number of rounds in micro seconds per trace
+
+double benchmark(void (*drawline)(uint32, uint32, uint32, uint32))
+{
+  uint64 start;
+  uint64 time;
+  uint64 fastest = ~0ull;
+  uint32 repeat;
+  uint32 run;
+  uint32 index;
+
+  display_set_screen_buffer(resultscreen);
+
+  for(repeat=0;repeat<BENCHMARK_REPEATS;repeat++)
+  {
+    start = host_test_nanoseconds();
+
+    for(run=0;run<BENCHMARK_RUNS;run++)
+    {
+      for(index=1;index<TRACE_POINTS;index++)
+      {
+        drawline(TRACE_HORIZONTAL_START + index - 1, tracey[index - 1], TRACE_HORIZONTAL_START + index, tracey[index]);
+      }
+    }
+
+    time = host_test_nanoseconds() - start;
+
+    if(time < fastest)
+    {
+      fastest = time;
+    }
+  }
+
+  return((double)fastest / (BENCHMARK_RUNS * 1000.0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int main(void)
+{
+  uint32 segment;
+  uint32 index;
+  int32  x;
+  int32  y;
+
+  display_set_dimensions(SCREEN_WIDTH, SCREEN_HEIGHT);
+  display_set_fg_color(CHANNEL1_COLOR);
+
+  //No dirty region tracking for these tests
+  display_set_dirty_region(0);
+
+  //Random segments anywhere on the screen and partly or fully past its edges
+  for(segment=0;segment<RANDOM_SEGMENTS;segment++)
+  {
+    check_segment(random_coordinate(SCREEN_WIDTH, 0), random_coordinate(SCREEN_HEIGHT, 1), random_coordinate(SCREEN_WIDTH, 0), random_coordinate(SCREEN_HEIGHT, 1));
+  }
+
+  //Short steep segments like in a trace, with one or a few columns
+  for(segment=0;segment<RANDOM_SEGMENTS;segment++)
+  {
+    x = random_coordinate(SCREEN_WIDTH, 0);
+    y = random_coordinate(SCREEN_HEIGHT, 1);
+
+    check_segment(x, y, x + (host_test_random() % 4), random_coordinate(SCREEN_HEIGHT, 1));
+  }
+
+  //Whole traces drawn segment by segment
+  for(segment=0;segment<2;segment++)
+  {
+    make_trace(segment);
+
+    for(index=1;index<TRACE_POINTS;index++)
+    {
+      check_segment(TRACE_HORIZONTAL_START + index - 1, tracey[index - 1], TRACE_HORIZONTAL_START + index, tracey[index]);
+    }
+  }
+
+  make_trace(0);
+  printf("sine trace of %u points:   display_draw_line %.1f us, display_draw_trace_line %.1f us\n", TRACE_POINTS,
+         benchmark(display_draw_line), benchmark(display_draw_trace_line));
+
+  make_trace(1);
+  printf("square trace of %u points: display_draw_line %.1f us, display_draw_trace_line %.1f us\n", TRACE_POINTS,
+         benchmark(display_draw_line), benchmark(display_draw_trace_line));
+
+  return(host_test_result("test_trace_line"));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
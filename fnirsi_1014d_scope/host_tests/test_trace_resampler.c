@@ -0,0 +1,227 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+//Times the fixed point resampler of scope_display_channel_trace per screen column for every viable time base and sample rate
+//combination, against the floating point stepping it replaced. The sample indices are also checked against the exact rational ones
+//
+//  gcc -O2 -w -ffunction-sections -fdata-sections -Wl,--gc-sections -o test_trace_resampler test_trace_resampler.c -lm
+//
+//On a PC the double version runs on the FPU, while the scope does it with the soft float routines of libgcc, so there the gain is
+//much larger than shown here
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "host_test.h"
+
+#include <math.h>
+
+#include "../scope_functions.c"
+#include "../display_lib.c"
+#include "../variables.c"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define BENCHMARK_RUNS       200
+#define BENCHMARK_REPEATS     15
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+DISPLAYPOINTS referencepoints[730];
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The sample stepping with doubles as done before the fixed point version. The screen lookup is the same as in the firmware, so only
+//the stepping differs. Returns the number of trace points
+
+uint32 reference_display_channel_trace(PCHANNELSETTINGS settings)
+{
+  double xpospersample = (50.0 * frequency_per_div[scopesettings.timeperdiv]) / sample_rate[scopesettings.samplerate];
+  double samplestep = 1.0 / xpospersample;
+  double inputindex;
+  int32  previousindex;
+  int32  currentindex;
+  uint32 xpos = disp_xstart + 1;
+  uint32 count = 1;
+  uint16 *ylookup = settings->ylookup;
+  uint8  *buffer = settings->tracebuffer;
+  PDISPLAYPOINTS tracepoints = referencepoints;
+
+  tracepoints->x = disp_xstart;
+  tracepoints->y = ylookup[buffer[disp_first_sample]];
+  tracepoints++;
+
+  inputindex = disp_first_sample + samplestep;
+  previousindex = disp_first_sample;
+
+  for(; xpos < disp_xend; inputindex += samplestep, xpos++)
+  {
+    currentindex = inputindex;
+
+    if(currentindex != previousindex)
+    {
+      previousindex = currentindex;
+
+      tracepoints->x = xpos;
+      tracepoints->y = ylookup[buffer[currentindex]];
+      tracepoints++;
+
+      count++;
+    }
+  }
+
+  return(count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Checks the points of the firmware against the exact sample index of every column, which is first + column * rate / xpositions
+
+void check_trace_points(PCHANNELSETTINGS settings)
+{
+  uint64 rate = sample_rate[scopesettings.samplerate];
+  uint64 xpositions = 50ULL * frequency_per_div[scopesettings.timeperdiv];
+  uint32 points = settings->noftracepoints;
+  uint32 point;
+  uint32 column;
+  uint32 index;
+
+  //The last point is interpolated towards the end of the view when there is more than one pixel per sample
+  if(disp_sample_step < (1ULL << SAMPLE_STEP_SHIFTER))
+  {
+    points--;
+  }
+
+  for(point=0;point<points;point++)
+  {
+    column = settings->tracepoints[point].x - disp_xstart;
+    index = disp_first_sample + ((column * rate) / xpositions);
+
+    HOST_CHECK(settings->tracepoints[point].y == settings->ylookup[settings->tracebuffer[index]],
+               "rate %u time/div %s: column %u is not on sample %u", sample_rate[scopesettings.samplerate],
+               time_div_texts[scopesettings.timeperdiv], column, index);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Sets the view to the whole trace window from the first sample, limited on the samples available
+
+void set_full_view(void)
+{
+  uint64 available;
+
+  scope_calculate_sample_range_properties();
+
+  if(disp_sample_step > ((uint64)SAMPLES_PER_ADC << SAMPLE_STEP_SHIFTER))
+  {
+    disp_sample_step = (uint64)SAMPLES_PER_ADC << SAMPLE_STEP_SHIFTER;
+  }
+
+  disp_xstart = TRACE_HORIZONTAL_MIN;
+  disp_xend = TRACE_HORIZONTAL_MAX;
+  disp_first_sample = 0;
+  disp_first_fraction = 0;
+
+  available = ((uint64)(SAMPLE_COUNT - 1) << SAMPLE_STEP_SHIFTER) / disp_sample_step;
+
+  if(available < (uint64)(disp_xend - disp_xstart))
+  {
+    disp_xend = disp_xstart + (int32)available;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Returns the fastest time of a number of rounds in CPU cycles per displayed column
+
+double benchmark(uint32 (*resample)(PCHANNELSETTINGS), PCHANNELSETTINGS settings)
+{
+  uint64 start;
+  uint64 time;
+  uint64 fastest = ~0ull;
+  uint32 repeat;
+  uint32 run;
+
+  for(repeat=0;repeat<BENCHMARK_REPEATS;repeat++)
+  {
+    start = host_test_cycles();
+
+    for(run=0;run<BENCHMARK_RUNS;run++)
+    {
+      resample(settings);
+    }
+
+    time = host_test_cycles() - start;
+
+    if(time < fastest)
+    {
+      fastest = time;
+    }
+  }
+
+  return((double)fastest / ((double)BENCHMARK_RUNS * (disp_xend - disp_xstart)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 firmware_display_channel_trace(PCHANNELSETTINGS settings)
+{
+  scope_display_channel_trace(settings);
+
+  return(settings->noftracepoints);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int main(void)
+{
+  PCHANNELSETTINGS settings = &scopesettings.channel1;
+  uint8  *samples = (uint8 *)channel1tracebuffer;
+  uint32 samplerate;
+  uint32 timeperdiv;
+  uint32 index;
+
+  //A noisy sine over the whole buffer
+  for(index=0;index<SAMPLE_COUNT;index++)
+  {
+    samples[index] = 128 + (int32)((100.0 * sin(index / 37.0)) + (8.0 * host_test_random_unit()));
+  }
+
+  settings->tracebuffer = samples;
+  settings->tracepoints = channel1pointsbuffer;
+  settings->tracespans = channel1spansbuffer;
+  settings->ylookup = channel1ylookup;
+  settings->xlookup = channel1xlookup;
+  settings->lookupsettings = SCREEN_LOOKUP_INVALID;
+  settings->traceposition = 200;
+
+  //Only the resampling is timed, so the lines are not drawn. With persistence on only the trace points are made
+  scopesettings.persistencemode = PERSISTENCE_MODE_INFINITE;
+
+  printf("sample rate  time/div  samples/column  double cycles/column  fixed cycles/column\n");
+
+  for(samplerate=0;samplerate<18;samplerate++)
+  {
+    for(timeperdiv=0;timeperdiv<24;timeperdiv++)
+    {
+      if(viable_time_per_div[samplerate][timeperdiv] == 0)
+      {
+        continue;
+      }
+
+      scopesettings.samplerate = samplerate;
+      scopesettings.timeperdiv = timeperdiv;
+
+      set_full_view();
+
+      scope_display_channel_trace(settings);
+
+      //With more than one sample per column the envelope is drawn, which has no single sample per column to check
+      if(disp_sample_step <= (1ULL << SAMPLE_STEP_SHIFTER))
+      {
+        check_trace_points(settings);
+      }
+
+      printf("%11u  %8s  %14.3f  %20.1f  %19.1f\n", sample_rate[samplerate], time_div_texts[timeperdiv],
+             (double)disp_sample_step / (1ULL << SAMPLE_STEP_SHIFTER),
+             benchmark(reference_display_channel_trace, settings), benchmark(firmware_display_channel_trace, settings));
+    }
+  }
+
+  return(host_test_result("test_trace_resampler"));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,238 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+//Measures the horizontal jitter of the displayed trigger point on synthetic sine and square captures, for the interpolating whole
+//buffer search of scope_process_trigger and for the 40 sample window search it replaced
+//
+//  gcc -O2 -w -ffunction-sections -fdata-sections -Wl,--gc-sections -o test_trigger_jitter test_trigger_jitter.c -lm
+//
+//Every capture has the signal crossing the trigger level at a random point within a few samples of where the hardware put the
+//trigger, with a random phase and some noise. The jitter is the spread of the displayed trigger point around the actual crossing,
+//in pixels at 4 pixels per sample. The word compare the search is built on is checked against single sample compares as well
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "host_test.h"
+
+#include <math.h>
+
+#include "../scope_functions.c"
+#include "../display_lib.c"
+#include "../variables.c"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define CAPTURES             2000
+#define PIXELS_PER_SAMPLE       4
+#define SIGNAL_PERIOD        60.0
+#define SIGNAL_AMPLITUDE    100.0
+#define SIGNAL_NOISE          1.0
+#define TRIGGER_SPREAD        4.0
+#define RANDOM_WORDS       100000
+
+//Limits on the rms jitter in pixels for the interpolating search. The old search is only reported. The noise and rounding of the
+//samples, divided by the slope of the signal on the level, put the sine on about 0.3 pixel and the steeper square lower
+#define SINE_JITTER_LIMIT    0.40
+#define SQUARE_JITTER_LIMIT  0.15
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+  double sum;
+  double squares;
+  double min;
+  double max;
+  uint32 count;
+} JITTER;
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The trigger search as done before, on the first crossing in a 40 sample window around the hardware trigger point
+
+void reference_process_trigger(uint8 *buffer, uint32 count)
+{
+  uint32 index;
+  uint32 level = scopesettings.triggerlevel;
+  uint32 sample1;
+  uint32 sample2;
+
+  disp_trigger_index = SAMPLES_PER_ADC;
+  disp_trigger_fraction = 0;
+
+  index = count - 20;
+  count = 40;
+
+  while(count--)
+  {
+    sample1 = buffer[index];
+    sample2 = buffer[index + 1];
+
+    if(((scopesettings.triggeredge == 0) && (sample1 < level) && (sample2 >= level)) ||
+       ((scopesettings.triggeredge == 1) && (sample1 >= level) && (sample2 < level)))
+    {
+      disp_trigger_index = index;
+      return;
+    }
+
+    index++;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Makes a capture with the chosen edge crossing the middle level at the given sample time. The square wave has edges of about two
+//samples, like a fast signal through the analog front end
+
+void make_capture(uint8 *buffer, uint32 square, uint32 edge, double crossing)
+{
+  double phase;
+  double value;
+  int32  sample;
+  uint32 index;
+
+  for(index=0;index<SAMPLE_COUNT;index++)
+  {
+    phase = (2.0 * M_PI * (index - crossing)) / SIGNAL_PERIOD;
+
+    //A falling edge is the same signal upside down
+    value = edge ? -sin(phase) : sin(phase);
+
+    if(square)
+    {
+      value = tanh(value * 8.0);
+    }
+
+    //Add noise of about the given amplitude
+    value = 128.0 + (SIGNAL_AMPLITUDE * value) + (SIGNAL_NOISE * (host_test_random_unit() + host_test_random_unit()));
+
+    sample = (int32)floor(value + 0.5);
+
+    buffer[index] = (sample < 0) ? 0 : (sample > 255) ? 255 : sample;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void add_jitter(JITTER *jitter, double error)
+{
+  if((jitter->count == 0) || (error < jitter->min))
+  {
+    jitter->min = error;
+  }
+
+  if((jitter->count == 0) || (error > jitter->max))
+  {
+    jitter->max = error;
+  }
+
+  jitter->sum += error;
+  jitter->squares += error * error;
+  jitter->count++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The rms of the errors around their mean. A constant offset is not jitter, since it only moves the whole trace
+
+double jitter_rms(JITTER *jitter)
+{
+  double mean = jitter->sum / jitter->count;
+
+  return(sqrt((jitter->squares / jitter->count) - (mean * mean)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+double jitter_peak(JITTER *jitter)
+{
+  double mean = jitter->sum / jitter->count;
+
+  return(((jitter->max - mean) > (mean - jitter->min)) ? (jitter->max - mean) : (mean - jitter->min));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Checks the word compare of the trigger search against a compare of the single samples
+
+void check_flag_samples(void)
+{
+  uint32 word;
+  uint32 level;
+  uint32 expected;
+  uint32 count;
+  uint32 byte;
+
+  for(count=0;count<RANDOM_WORDS;count++)
+  {
+    word = host_test_random();
+
+    for(level=0;level<256;level++)
+    {
+      expected = 0;
+
+      for(byte=0;byte<4;byte++)
+      {
+        if(((word >> (byte * 8)) & 0xFF) >= level)
+        {
+          expected |= 0x80 << (byte * 8);
+        }
+      }
+
+      HOST_CHECK(scope_flag_samples_at_or_above(word, level) == expected, "word 0x%08X level %u", word, level);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int main(void)
+{
+  uint8  *buffer = (uint8 *)channel1tracebuffer;
+  JITTER  oldjitter;
+  JITTER  newjitter;
+  double  crossing;
+  double  position;
+  uint32  square;
+  uint32  edge;
+  uint32  capture;
+
+  scopesettings.channel1.tracebuffer = buffer;
+  scopesettings.triggerchannel = 0;
+  scopesettings.triggerlevel = 128;
+
+  check_flag_samples();
+
+  printf("signal  edge     old rms px  old max px  new rms px  new max px\n");
+
+  for(square=0;square<2;square++)
+  {
+    for(edge=0;edge<2;edge++)
+    {
+      scopesettings.triggeredge = edge;
+
+      memset(&oldjitter, 0, sizeof(JITTER));
+      memset(&newjitter, 0, sizeof(JITTER));
+
+      for(capture=0;capture<CAPTURES;capture++)
+      {
+        //The signal crosses the level somewhere near the hardware trigger point in the center of the buffer
+        crossing = SAMPLES_PER_ADC + (TRIGGER_SPREAD * host_test_random_unit());
+
+        make_capture(buffer, square, edge, crossing);
+
+        //The displayed trigger point is the index plus the 0.32 fraction
+        reference_process_trigger(buffer, SAMPLES_PER_ADC);
+        position = disp_trigger_index + (disp_trigger_fraction / 4294967296.0);
+        add_jitter(&oldjitter, (position - crossing) * PIXELS_PER_SAMPLE);
+
+        scope_process_trigger(SAMPLES_PER_ADC);
+        position = disp_trigger_index + (disp_trigger_fraction / 4294967296.0);
+        add_jitter(&newjitter, (position - crossing) * PIXELS_PER_SAMPLE);
+      }
+
+      printf("%-6s  %-7s  %10.2f  %10.2f  %10.2f  %10.2f\n", square ? "square" : "sine", edge ? "falling" : "rising",
+             jitter_rms(&oldjitter), jitter_peak(&oldjitter), jitter_rms(&newjitter), jitter_peak(&newjitter));
+
+      HOST_CHECK(jitter_rms(&newjitter) < (square ? SQUARE_JITTER_LIMIT : SINE_JITTER_LIMIT), "%s %s edge jitter too high",
+                 square ? "square" : "sine", edge ? "falling" : "rising");
+    }
+  }
+
+  return(host_test_result("test_trigger_jitter"));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
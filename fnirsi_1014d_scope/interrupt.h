@@ -44,6 +44,8 @@
 
 #define USB_IRQ_NUM            26
 
+#define TCON_IRQ_NUM           29
+
 #define PORTE_EINT_IRQ        0x27
 
 //----------------------------------------------------------------------------------------------------------------------------------
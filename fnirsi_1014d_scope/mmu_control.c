@@ -0,0 +1,97 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "types.h"
+#include "mmu_control.h"
+#include "arm32.h"
+#include "variables.h"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+//The first level translation table. Only sections are used so no second level tables are needed
+uint32 mmu_translation_table[MMU_SECTIONS] __attribute__ ((aligned (MMU_TABLE_ALIGNMENT)));
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void sys_init_mmu(void)
+{
+  //Start with the whole address space strongly ordered. This covers the peripherals, the SRAM and the boot ROM
+  mmu_map_sections(0, 0, MMU_STRONGLY_ORDERED);
+
+  //The DRAM is cached with write back for the best performance on the trace and display buffers
+  mmu_map_sections(MMU_DRAM_START, MMU_DRAM_SIZE, MMU_WRITE_BACK);
+
+  //The display engine reads the display buffers directly, so writes need to go to the DRAM without the need for cleaning
+  //Write through still allows the reads to be cached
+  mmu_map_sections((uint32)maindisplaybuffer, sizeof(maindisplaybuffer), MMU_WRITE_THROUGH);
+  mmu_map_sections((uint32)displaylayerpages, sizeof(displaylayerpages), MMU_WRITE_THROUGH);
+
+  //Make sure nothing stale is left in the caches or the TLB
+  arm32_cache_invalidate_all();
+  arm32_tlb_invalidate();
+
+  //Set the table and allow access based on the section permissions
+  arm32_ttb_set((uint32)mmu_translation_table);
+  arm32_domain_set(MMU_DOMAIN0_CLIENT);
+
+  //With the translation in place the data cache becomes active
+  arm32_mmu_enable();
+  arm32_icache_enable();
+  arm32_dcache_enable();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void mmu_map_sections(uint32 address, uint32 size, uint32 type)
+{
+  uint32 section = address >> MMU_SECTION_SHIFT;
+  uint32 last;
+
+  //A size of zero maps the complete address space
+  if(size == 0)
+  {
+    last = MMU_SECTIONS - 1;
+  }
+  else
+  {
+    //Include the sections the start and the end fall in
+    last = (address + size - 1) >> MMU_SECTION_SHIFT;
+  }
+
+  //Map the sections one on one with the given memory type
+  for(;section<=last;section++)
+  {
+    mmu_translation_table[section] = (section << MMU_SECTION_SHIFT) | type;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void mmu_clean_for_device(void *buffer, uint32 size)
+{
+  //Write the cached data to the DRAM so the device reads the latest data
+  arm32_dcache_clean_range((uint32)buffer, (uint32)buffer + size);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void mmu_invalidate_for_cpu(void *buffer, uint32 size)
+{
+  uint32 start = (uint32)buffer;
+  uint32 end = start + size;
+
+  //Partial cache lines on the edges might hold data of other variables, so these need to be written back before discarding
+  if(start & 31)
+  {
+    arm32_dcache_clean_invalidate_range(start, start + 1);
+  }
+
+  if(end & 31)
+  {
+    arm32_dcache_clean_invalidate_range(end, end + 1);
+  }
+
+  //Discard the cached data so the CPU reads what the device has written
+  arm32_dcache_invalidate_range(start, end);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,61 @@
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#ifndef MMU_CONTROL_H
+#define MMU_CONTROL_H
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#include "types.h"
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+//The whole 4GB address space is mapped one on one with 1MB sections
+#define MMU_SECTION_SHIFT            20
+#define MMU_SECTION_SIZE             (1 << MMU_SECTION_SHIFT)
+#define MMU_SECTIONS                 4096
+
+//The translation table needs to be aligned on 16KB
+#define MMU_TABLE_ALIGNMENT          0x4000
+
+//First level section descriptor bits
+#define MMU_SECTION_TYPE             0x00000002
+#define MMU_SECTION_BIT4             0x00000010     //Needs to be set for backwards compatibility on the ARM926EJ-S
+#define MMU_SECTION_BUFFERABLE       0x00000004
+#define MMU_SECTION_CACHEABLE        0x00000008
+#define MMU_SECTION_AP_FULL_ACCESS   0x00000C00
+
+#define MMU_SECTION_BASE             (MMU_SECTION_TYPE | MMU_SECTION_BIT4 | MMU_SECTION_AP_FULL_ACCESS)
+
+//Memory types used in the map
+#define MMU_STRONGLY_ORDERED         (MMU_SECTION_BASE)
+#define MMU_WRITE_THROUGH            (MMU_SECTION_BASE | MMU_SECTION_CACHEABLE)
+#define MMU_WRITE_BACK               (MMU_SECTION_BASE | MMU_SECTION_CACHEABLE | MMU_SECTION_BUFFERABLE)
+
+//All sections are in domain 0 which is set as client so the access permissions are checked
+#define MMU_DOMAIN0_CLIENT           0x00000001
+
+//The DRAM of the F1C100s
+#define MMU_DRAM_START               0x80000000
+#define MMU_DRAM_SIZE                0x02000000
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void sys_init_mmu(void);
+
+void mmu_map_sections(uint32 address, uint32 size, uint32 type);
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Cache maintenance for memory shared with other bus masters
+//
+//The SD card and USB interfaces are handled with the CPU through their FIFO's, so their buffers are coherent as is.
+//These functions are needed when a buffer in write back memory is handed to DMA or to the display engine
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void mmu_clean_for_device(void *buffer, uint32 size);
+void mmu_invalidate_for_cpu(void *buffer, uint32 size);
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#endif /* MMU_CONTROL_H */
+
+//----------------------------------------------------------------------------------------------------------------------------------
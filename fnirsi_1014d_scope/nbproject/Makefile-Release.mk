@@ -42,6 +42,7 @@ OBJECTFILES= \
 	${OBJECTDIR}/display_control.o \
 	${OBJECTDIR}/display_lib.o \
 	${OBJECTDIR}/ff.o \
+	${OBJECTDIR}/fft_math.o \
 	${OBJECTDIR}/ffunicode.o \
 	${OBJECTDIR}/fnirsi_1014d_scope.o \
 	${OBJECTDIR}/fpga_control.o \
@@ -52,6 +53,7 @@ OBJECTFILES= \
 	${OBJECTDIR}/memcpy.o \
 	${OBJECTDIR}/memmove.o \
 	${OBJECTDIR}/memset.o \
+	${OBJECTDIR}/mmu_control.o \
 	${OBJECTDIR}/scope_functions.o \
 	${OBJECTDIR}/sd_card_interface.o \
 	${OBJECTDIR}/sin_cos_math.o \
@@ -124,6 +126,11 @@ ${OBJECTDIR}/ff.o: ff.c
 	${RM} "$@.d"
 	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/ff.o ff.c
 
+${OBJECTDIR}/fft_math.o: fft_math.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/fft_math.o fft_math.c
+
 ${OBJECTDIR}/ffunicode.o: ffunicode.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
@@ -170,6 +177,11 @@ ${OBJECTDIR}/memset.o: memset.s
 	${MKDIR} -p ${OBJECTDIR}
 	$(AS) $(ASFLAGS) -o ${OBJECTDIR}/memset.o memset.s
 
+${OBJECTDIR}/mmu_control.o: mmu_control.c
+	${MKDIR} -p ${OBJECTDIR}
+	${RM} "$@.d"
+	$(COMPILE.c) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/mmu_control.o mmu_control.c
+
 ${OBJECTDIR}/scope_functions.o: scope_functions.c
 	${MKDIR} -p ${OBJECTDIR}
 	${RM} "$@.d"
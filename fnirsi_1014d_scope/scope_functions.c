@@ -8,12 +8,14 @@
 #include "spi_control.h"
 #include "sd_card_interface.h"
 #include "display_lib.h"
+#include "display_control.h"
 #include "ff.h"
 #include "user_interface_functions.h"
 #include "usb_interface.h"
 #include "variables.h"
 
 #include "sin_cos_math.h"
+#include "fft_math.h"
 
 #include <string.h>
 
@@ -28,36 +30,32 @@ void scope_acquire_trace_data(void)
   //Check if running and at least one channel enabled
   if((scopesettings.runstate == RUN_STATE_RUNNING) && (scopesettings.channel1.enable || scopesettings.channel2.enable))
   {
-    //Show the user waiting for a trigger
-    ui_display_waiting_triggered_text(0);
-    
-    //Set the trigger level
-    fpga_set_trigger_level();
-
-    //Write the time base setting to the FPGA
-    fpga_set_time_base(scopesettings.timeperdiv);
-
-    //Sampling with trigger circuit enabled
-    scopesettings.samplemode = 1;
-
-    //Start the conversion and wait until done or user input given
-    fpga_do_conversion();
-
-    //Check if cut short with user input
-    if(toprocesscommand)
+    //Check if the FPGA needs to be armed for a new conversion
+    if(acquisitionstate == ACQUISITION_STATE_IDLE)
     {
-      //If so skip the rest
+      //Start a new capture and return to let the main loop render the previous one
+      scope_arm_acquisition();
       return;
     }
-    
-    //Check if in single mode
-    if(scopesettings.triggermode == 1)
+
+    //Check if the FPGA is still busy with the conversion
+    if(acquisitionstate == ACQUISITION_STATE_WAITING)
     {
-      //Switch to stopped
-      scopesettings.runstate = RUN_STATE_STOPPED;
+      //Check if the FPGA signals triggered or buffer full
+      if(fpga_check_conversion_done() == 0)
+      {
+        //Not yet so continue with the rest of the main loop
+        return;
+      }
 
-      //Show this on the screen
-      ui_display_run_stop_text();
+      //The capture is done so the time waited on it is known
+      timing_end(TIMING_STAGE_TRIGGER_WAIT);
+
+      //Disable the trigger system
+      fpga_end_conversion();
+
+      //Samples are available for reading
+      acquisitionstate = ACQUISITION_STATE_READY;
     }
 
     //Get trigger point information
@@ -91,20 +89,41 @@ void scope_acquire_trace_data(void)
       data = data - 750;
     }
 
+    //Read the new capture directly into the next history segment so the previous ones stay available without copying
+    scope_next_history_segment();
+
+    timing_start(TIMING_STAGE_READ);
+
     //Check if channel 1 is enabled
     if(scopesettings.channel1.enable)
     {
-      //Get the samples for channel 1
-      fpga_read_sample_data(&scopesettings.channel1, data);
+      //Get the samples for channel 1. The measurements are only computed when something shown on the screen asks for them
+      fpga_read_sample_data(&scopesettings.channel1, data, 0);
     }
 
     //Check if channel 2 is enabled
     if(scopesettings.channel2.enable)
     {
       //Get the samples for channel 2
-      fpga_read_sample_data(&scopesettings.channel2, data);
+      fpga_read_sample_data(&scopesettings.channel2, data, 0);
+    }
+
+    //In high resolution mode the noise is filtered out before the trigger is searched for
+    if(scopesettings.acquisitionmode == ACQUISITION_MODE_HIGH_RES)
+    {
+      if(scopesettings.channel1.enable)
+      {
+        scope_high_res_filter(&scopesettings.channel1);
+      }
+
+      if(scopesettings.channel2.enable)
+      {
+        scope_high_res_filter(&scopesettings.channel2);
+      }
     }
 
+    timing_end(TIMING_STAGE_READ);
+
     //Check if always 50% trigger is enabled
     if(scopesettings.alwaystrigger50)
     {
@@ -113,1101 +132,3396 @@ void scope_acquire_trace_data(void)
     }
     
 
-    //Need to improve on this for a more stable displaying. On the low sample rate settings it seems to flip between two positions.
     //Determine the trigger position based on the selected trigger channel
-    scope_process_trigger(SAMPLES_PER_ADC);
+    timing_start(TIMING_STAGE_PROCESS_TRIGGER);
 
-  }
-}
-
-//----------------------------------------------------------------------------------------------------------------------------------
+    //With a trigger qualifier the capture is only used when the condition is found in it, which also sets the trigger position
+    //Without the cursors needed for its limits the qualifier can not be checked, so then the plain edge trigger is used
+    if((scopesettings.triggerqualifier != TRIGGER_QUALIFIER_OFF) && scope_trigger_qualifier_usable())
+    {
+      if(scope_qualify_trigger(SAMPLES_PER_ADC) == 0)
+      {
+        timing_end(TIMING_STAGE_PROCESS_TRIGGER);
 
-void scope_process_trigger(uint32 count)
-{
-  uint8  *buffer;
-  uint32  index;
-  uint32  level = scopesettings.triggerlevel;
-  uint32  sample1;
-  uint32  sample2;
+        //Drop the capture and start the next one straight away, keeping the previous capture on the screen
+        scope_previous_history_segment();
+        scope_arm_acquisition();
+        return;
+      }
+    }
+    else
+    {
+      scope_process_trigger(SAMPLES_PER_ADC);
+    }
 
-  //Select the trace buffer to process based on the trigger channel
-  if(scopesettings.triggerchannel == 0)
-  {
-    //Channel 1 buffer
-    buffer = (uint8 *)channel1tracebuffer;
-  }
-  else
-  {
-    //Channel 2 buffer
-    buffer = (uint8 *)channel2tracebuffer;
-  }
+    //List the events in the capture once for stepping through them when stopped
+    scope_build_search_index();
 
-  //Assume it to be in the center of the sample buffer to start with
-  disp_trigger_index = SAMPLES_PER_ADC;
+    timing_end(TIMING_STAGE_PROCESS_TRIGGER);
 
-  //Set a starting point for checking on trigger
-  //Count is half a sample buffer!!
-  index = count - 20;
-  count = 40;
+    //The rest of the FPGA sample memory is only read for a capture that is used, so the record stays with the displayed one
+    if(scopesettings.longrecordenable)
+    {
+      if(scopesettings.channel1.enable)
+      {
+        fpga_read_long_record(&scopesettings.channel1, data);
+      }
 
-  //Need a better check here, maybe over a wider range of samples
+      if(scopesettings.channel2.enable)
+      {
+        fpga_read_long_record(&scopesettings.channel2, data);
+      }
 
-  while(count--)
-  {
-    sample1 = buffer[index];
-    sample2 = buffer[index + 1];
+      //The displayable range changes when the first record comes in
+      if(longrecordvalid == 0)
+      {
+        longrecordvalid = 1;
+        scope_calculate_sample_range_properties();
+      }
+    }
 
-    if(((scopesettings.triggeredge == 0) && (sample1 < level) && (sample2 >= level)) ||
-       ((scopesettings.triggeredge == 1) && (sample1 >= level) && (sample2 < level)))
+    //Check if in single mode. Only done here so a capture that does not qualify does not stop the scope
+    if(scopesettings.triggermode == 1)
     {
-      //Set the current index as trigger point
-      disp_trigger_index = index;
+      //Switch to stopped
+      scopesettings.runstate = RUN_STATE_STOPPED;
 
-      //Done with checking
-      return;
+      //Show this on the screen
+      ui_display_run_stop_text();
     }
 
-    //Select next sample to check
-    index++;
-  }
-}
+    //Add the capture to the average on the found trigger point when averaging is enabled
+    if((scopesettings.acquisitionmode >= ACQUISITION_MODE_AVERAGE_2) && (scopesettings.acquisitionmode <= ACQUISITION_MODE_AVERAGE_256))
+    {
+      scope_average_captures();
+    }
 
-//----------------------------------------------------------------------------------------------------------------------------------
+    //One more capture for the update rate
+    timing_count_waveform();
 
-uint32 scope_do_baseline_calibration(void)
-{
-  uint32 flag = 1;
-  uint32 voltperdiv;
+    //Keep the time of the capture and the found trigger point with the segment for replaying it later on
+    historysegments[historyindex].timestamp    = timer0ticks;
+    historysegments[historyindex].triggerindex    = disp_trigger_index;
+    historysegments[historyindex].triggerfraction = disp_trigger_fraction;
 
-  //Disable the trigger circuit
-  scopesettings.samplemode = 0;
+    //Signal the display there is a new capture to add to the persistence display
+    phosphorupdate = 1;
 
-  //Send the command for setting the trigger level to the FPGA
-  fpga_write_cmd(0x17);
-  fpga_write_byte(0);
-  
-  //Send the command for auto trigger mode
-  fpga_write_cmd(0x1A);
-  fpga_write_byte(0);
+    //And to the measurement statistics, which is done after the math trace is computed
+    statisticsupdate = 1;
 
-  //Clear the compensation values before doing the calibration
-  calibrationsettings.adc1compensation = 0;
-  calibrationsettings.adc2compensation = 0;
+    //And that the trace layer needs to be redrawn
+    displaytraceupdate = 1;
 
-  //Setup for channel 1 calibration
-  calibrationsettings.voltperdivcommand = 0x33;
-  calibrationsettings.offsetcommand     = 0x32;
-  calibrationsettings.adc1command       = 0x20;
-  calibrationsettings.adc2command       = 0x21;
+    //Check if still running after processing this capture
+    if(scopesettings.runstate == RUN_STATE_RUNNING)
+    {
+      //Re-arm the FPGA directly so the next capture is taken while this one is being displayed
+      scope_arm_acquisition();
+    }
+    else
+    {
+      //Single shot done so nothing in progress anymore
+      acquisitionstate = ACQUISITION_STATE_IDLE;
+    }
+  }
+  else
+  {
+    //When stopped the FPGA needs to be armed again on the next run
+    scope_abort_acquisition();
+  }
+}
 
-  //Use the trace buffer of this channel
-  calibrationsettings.tracebuffer = (uint8 *)channel1tracebuffer;
+//----------------------------------------------------------------------------------------------------------------------------------
+//Moving average over HIGH_RES_SAMPLES samples around each sample in a single pass. The samples before and after the buffer are taken
+//as the first and the last sample. The sums are kept with their extra resolution for the measurements, and rounded to 8 bits in
+//the processed buffer for the display path, which the channel is pointed to. The captured samples in the history stay as they are
 
-  //Calibrate this channel
-  flag &= scope_do_channel_calibration();
+void scope_high_res_filter(PCHANNELSETTINGS settings)
+{
+  register uint8  *source = settings->tracebuffer;
+  register uint8  *buffer = settings->processedbuffer;
+  register uint16 *sums = settings->averagebuffer;
+  register int32   sum = 0;
+  register int32   index;
+  int32 last = SAMPLE_COUNT - 1;
+  int32 in;
+  int32 out;
+
+  //Fill the window of the first sample
+  for(in=1-(HIGH_RES_SAMPLES / 2);in<=(HIGH_RES_SAMPLES / 2);in++)
+  {
+    sum += source[(in > 0) ? in : 0];
+  }
 
-  //Check if calibration was successful
-  if(flag)
+  for(index=0;index<SAMPLE_COUNT;index++)
   {
-    //Copy the results if so
-    for(voltperdiv=0;voltperdiv<6;voltperdiv++)
-    {
-      //For each volt per division setting there is a DC calibration offset
-      scopesettings.channel1.dc_calibration_offset[voltperdiv] = calibrationsettings.dc_calibration_offset[voltperdiv];
-    }
+    sums[index] = sum;
 
-    //The last one is also for the highest sensitivity setting
-    scopesettings.channel1.dc_calibration_offset[6] = scopesettings.channel1.dc_calibration_offset[5];
+    //Write the rounded average for displaying
+    buffer[index] = (sum + (HIGH_RES_SAMPLES / 2)) >> HIGH_RES_SHIFT;
 
-    //Copy the ADC compensation values
-    scopesettings.channel1.adc1compensation = calibrationsettings.adc1compensation;
-    scopesettings.channel1.adc2compensation = calibrationsettings.adc2compensation;
+    //Slide the window one sample on
+    in  = index + (HIGH_RES_SAMPLES / 2) + 1;
+    out = index + 1 - (HIGH_RES_SAMPLES / 2);
+
+    sum += source[(in < last) ? in : last] - source[(out > 0) ? out : 0];
   }
 
-  //Setup for channel 2 calibration
-  calibrationsettings.voltperdivcommand = 0x36;
-  calibrationsettings.offsetcommand     = 0x35;
-  calibrationsettings.adc1command       = 0x22;
-  calibrationsettings.adc2command       = 0x23;
+  settings->tracebuffer = buffer;
+  settings->precisionbits = HIGH_RES_SHIFT;
+  settings->measurementinputs = 0;
+}
 
-  //Use the trace buffer of this channel
-  calibrationsettings.tracebuffer = (uint8 *)channel2tracebuffer;
+//----------------------------------------------------------------------------------------------------------------------------------
 
-  //Calibrate this channel
-  flag &= scope_do_channel_calibration();
+void scope_average_captures(void)
+{
+  uint32 reset = 0;
+  uint32 rescale = 0;
+  int32  offset;
 
-  //Check if calibration was successful
-  if(flag)
+  //Start over on the first capture or when the settings changed
+  if(averagereset || (averagecount == 0))
   {
-    //Copy the results if so
-    for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+    averagereset = 0;
+    averagecount = 1;
+    averageshift = 0;
+
+    //The next captures are aligned on the trigger point of this one
+    averagetriggerindex = disp_trigger_index;
+
+    reset = 1;
+  }
+  else
+  {
+    averagecount++;
+
+    //While filling up, the number of averaged captures doubles every time enough captures are taken, until it matches the mode
+    if((averageshift < scopesettings.acquisitionmode) && (averagecount >= (2U << averageshift)))
     {
-      //For each volt per division setting there is a DC calibration offset
-      scopesettings.channel2.dc_calibration_offset[voltperdiv] = calibrationsettings.dc_calibration_offset[voltperdiv];
+      averageshift++;
+      rescale = 1;
     }
+  }
 
-    //The last one is also for the highest sensitivity setting
-    scopesettings.channel2.dc_calibration_offset[6] = scopesettings.channel2.dc_calibration_offset[5];
+  //Distance of the trigger point of this capture to the one the average is aligned on
+  offset = (int32)disp_trigger_index - (int32)averagetriggerindex;
 
-    //Copy the ADC compensation values
-    scopesettings.channel2.adc1compensation = calibrationsettings.adc1compensation;
-    scopesettings.channel2.adc2compensation = calibrationsettings.adc2compensation;
+  if(scopesettings.channel1.enable)
+  {
+    scope_average_channel(&scopesettings.channel1, offset, rescale, reset);
   }
 
-  //Load the normal operation settings back into the FPGA
-  fpga_set_channel_voltperdiv(&scopesettings.channel1);
-  fpga_set_channel_offset(&scopesettings.channel1);
-  fpga_set_channel_voltperdiv(&scopesettings.channel2);
-  fpga_set_channel_offset(&scopesettings.channel2);
-  fpga_set_sample_rate(scopesettings.samplerate);
+  if(scopesettings.channel2.enable)
+  {
+    scope_average_channel(&scopesettings.channel2, offset, rescale, reset);
+  }
 
-  return(flag);
+  //The averaged trace has its trigger point on the aligned position
+  disp_trigger_index = averagetriggerindex;
+  disp_trigger_fraction = 0;
+
+  //The measurements need to be done on the averaged samples
+  scopesettings.channel1.measurementinputs = 0;
+  scopesettings.channel2.measurementinputs = 0;
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+//Exponential average of the new samples, shifted by the given offset, into the sum buffer in a single pass. The rounded result
+//is written to the processed buffer, which the channel is pointed to for the display and the measurements, so the captured
+//samples in the history stay as they are
 
-#define HIGH_DC_OFFSET   500
-#define LOW_DC_OFFSET   1200
-
-uint32 scope_do_channel_calibration(void)
+void scope_average_channel(PCHANNELSETTINGS settings, int32 offset, uint32 rescale, uint32 reset)
 {
-  uint32 flag = 1;
-  int32  samplerate;
-  int32  voltperdiv;
-  int32  highaverage;
-  int32  lowaverage;
-  int32  dcoffsetstep;
-  int32  compensationsum = 0;
-
-  //Calibrate for the hardware sensitivity settings
-  for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+  register uint8  *source = settings->tracebuffer;
+  register uint8  *buffer = settings->processedbuffer;
+  register uint16 *average = settings->averagebuffer;
+  register uint32  shift = averageshift;
+  register uint32  sum;
+  register int32   index;
+  register int32   sample;
+  int32 last = SAMPLE_COUNT - 1;
+
+  for(index=0;index<SAMPLE_COUNT;index++)
   {
-    //Set the to do sensitivity setting in the FPGA
-    calibrationsettings.samplevoltperdiv = voltperdiv;
-    fpga_set_channel_voltperdiv(&calibrationsettings);
+    //Get the sample that lines up with this position. Outside the buffer the edge sample is used
+    sample = index + offset;
 
-    //Wait 50ms to allow the relays to settle
-    timer0_delay(50);
-
-    //Start with the first set of averages
-    samplerateindex = 0;
+    if(sample < 0)
+    {
+      sample = 0;
+    }
+    else if(sample > last)
+    {
+      sample = last;
+    }
 
-    //Do the measurements on two sample rates. 200MSa/s and 50KSa/s
-    for(samplerate=0;samplerate<18;samplerate+=11)
+    if(reset)
     {
-      //Set the selected sample rate
-      fpga_set_sample_rate(samplerate);
+      //The first capture is the average
+      sum = source[sample];
+    }
+    else
+    {
+      sum = average[index];
 
-      //Set the matching time base
-      fpga_set_time_base(sample_rate_time_per_div[samplerate]);
+      //Scale up the sum when the number of averaged captures doubled
+      if(rescale)
+      {
+        sum <<= 1;
+      }
 
-      //Set the high DC offset in the FPGA (Lower value returns higher ADC reading)
-      calibrationsettings.dc_calibration_offset[voltperdiv] = HIGH_DC_OFFSET;
-      fpga_set_channel_offset(&calibrationsettings);
+      //Replace the average part of the sum with the new sample
+      sum += source[sample] - (sum >> shift);
+    }
 
-      //Wait 25ms before sampling
-      timer0_delay(25);
+    average[index] = sum;
 
-      //Start the conversion and wait until done
-      fpga_do_conversion();
+    //Round the sum to the averaged 8 bit sample
+    buffer[index] = (sum + ((1 << shift) >> 1)) >> shift;
+  }
 
-      //Get the data from a sample run
-      fpga_read_sample_data(&calibrationsettings, 100);
+  settings->tracebuffer = buffer;
+  settings->precisionbits = shift;
+}
 
-      //Need the average as one reading here. Only use ADC1 data
-      highaverage = calibrationsettings.adc1rawaverage;
+//----------------------------------------------------------------------------------------------------------------------------------
+//The math trace uses the sensitivity of channel 1, so it is displayed and measured in channel 1 volts
 
-      //Set the low DC offset in the FPGA (Higher value returns lower ADC reading)
-      calibrationsettings.dc_calibration_offset[voltperdiv] = LOW_DC_OFFSET;
-      fpga_set_channel_offset(&calibrationsettings);
+void scope_compute_math_channel(void)
+{
+  PCHANNELSETTINGS channel1 = &scopesettings.channel1;
+  PCHANNELSETTINGS channel2 = &scopesettings.channel2;
+  PVOLTCALCDATA    vcd1;
+  PVOLTCALCDATA    vcd2;
+  uint64           gain1;
+  uint64           gain2;
+  uint32           scale;
+  int32            ratio;
+  int32            product = 0;
+
+  //The math trace needs both input channels
+  mathchannel.enable = (scopesettings.mathmode != MATH_MODE_OFF) && channel1->enable && channel2->enable;
+
+  if(mathchannel.enable == 0)
+  {
+    return;
+  }
 
-      //Wait 25ms before sampling
-      timer0_delay(25);
+  mathchannel.magnification     = channel1->magnification;
+  mathchannel.displayvoltperdiv = channel1->displayvoltperdiv;
+  mathchannel.samplevoltperdiv  = channel1->samplevoltperdiv;
+  mathchannel.traceposition     = MATH_TRACE_POSITION;
 
-      //Start the conversion and wait until done
-      fpga_do_conversion();
+  //Volts per sample step of both channels, as used for the measurements
+  vcd1 = (PVOLTCALCDATA)&volt_calc_data[channel1->magnification][channel1->samplevoltperdiv];
+  vcd2 = (PVOLTCALCDATA)&volt_calc_data[channel2->magnification][channel2->samplevoltperdiv];
 
-      //Get the data from a sample run
-      fpga_read_sample_data(&calibrationsettings, 100);
+  gain1 = (uint64)signal_adjusters[channel1->samplevoltperdiv] * vcd1->mul_factor;
+  gain2 = (uint64)signal_adjusters[channel2->samplevoltperdiv] * vcd2->mul_factor;
 
-      //Need the average as another reading here. Only use ADC1 data
-      lowaverage = calibrationsettings.adc1rawaverage;
+  //The volt scales are a factor 1000 apart, so bring both gains on the same scale
+  for(scale=vcd1->volt_scale;scale<vcd2->volt_scale;scale++)
+  {
+    gain2 *= 1000;
+  }
 
-      //Calculate the DC offset step for a single ADC bit change for this volt/div setting
-      //Low DC offset minus high DC offset (1200 - 500) = 700. Scaled up for fixed point calculation ==> 700 << 20 = 734003200
-      dcoffsetstep = 734003200 / (highaverage - lowaverage);
+  for(scale=vcd2->volt_scale;scale<vcd1->volt_scale;scale++)
+  {
+    gain1 *= 1000;
+  }
 
-      //Calculate the average DC offset settings for both the low to center as the high to center readings
-      highaverage = HIGH_DC_OFFSET + (((highaverage - 128) * dcoffsetstep) >> 20);
-      lowaverage  = LOW_DC_OFFSET  - (((128 - lowaverage) * dcoffsetstep) >> 20);
+  //Scaling of the channel 2 samples to channel 1 sample steps
+  gain2 = (gain2 << MATH_RATIO_SHIFT) / gain1;
 
-      //Set the result for this sample rate and volt per division setting
-      samplerateaverage[samplerateindex][voltperdiv] = (highaverage + lowaverage) / 2;
+  if(gain2 > MATH_RATIO_MAX)
+  {
+    gain2 = MATH_RATIO_MAX;
+  }
 
-      //Save the dc offset step for final calibration after compensation data has been determined
-      sampleratedcoffsetstep[samplerateindex][voltperdiv] = dcoffsetstep;
+  ratio = (int32)gain2;
 
-      //Select the next set of sample indexes
-      samplerateindex++;
-    }
+  if(scopesettings.mathmode == MATH_MODE_SUBTRACT)
+  {
+    ratio = -ratio;
+  }
+  else if(scopesettings.mathmode == MATH_MODE_MULTIPLY)
+  {
+    //For the product the divider is the number of channel 1 sample steps per division
+    product = ((uint64)signal_adjusters[channel1->samplevoltperdiv] << MATH_RATIO_SHIFT) / (LINE_SPACING << VOLTAGE_SHIFTER);
   }
 
-  //Set the sample rate to 2MSa/s
-  fpga_set_sample_rate(6);
+  //The long record is only combined when it is displayed
+  if(scope_long_record_in_view())
+  {
+    scope_combine_math_samples(mathchannel.longrecord, channel1->longrecord, channel2->longrecord, LONG_RECORD_SAMPLE_COUNT, ratio, product);
+  }
 
-  //Set the matching time base
-  fpga_set_time_base(sample_rate_time_per_div[6]);
+  //Done last so the measurements are on the normal trace buffer like for the input channels
+  scope_combine_math_samples(mathchannel.tracebuffer, channel1->tracebuffer, channel2->tracebuffer, SAMPLE_COUNT, ratio, product);
+}
 
-  //Average and test the results on a third sample rate
-  for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+//----------------------------------------------------------------------------------------------------------------------------------
+//Combines the samples and gathers the measurements on the result in a single pass. The channel 2 samples are scaled with the ratio
+//and added, or multiplied when a product scaling is given
+
+void scope_combine_math_samples(uint8 *output, uint8 *input1, uint8 *input2, uint32 count, int32 ratio, int32 product)
+{
+  register int32  sample1;
+  register int32  sample2;
+  register int32  result;
+  register int32  min = 255;
+  register int32  max = 0;
+  register uint32 sum = 0;
+  register uint32 squares = 0;
+  register uint32 index;
+
+  for(index=0;index<count;index++)
   {
-    //Set the average of the two measurements as the DC offset to work with
-    calibrationsettings.dc_calibration_offset[voltperdiv] = (samplerateaverage[0][voltperdiv] + samplerateaverage[1][voltperdiv]) / 2;
+    //Center the samples and bring channel 2 on the channel 1 scale
+    sample1 = input1[index] - 128;
+    sample2 = ((input2[index] - 128) * ratio) >> MATH_RATIO_SHIFT;
 
-    //Set the to do sensitivity setting in the FPGA
-    calibrationsettings.samplevoltperdiv = voltperdiv;
-    fpga_set_channel_voltperdiv(&calibrationsettings);
+    if(product)
+    {
+      result = ((int64)(sample1 * sample2) * product) >> MATH_RATIO_SHIFT;
+    }
+    else
+    {
+      result = sample1 + sample2;
+    }
 
-    //Set the new DC channel offset in the FPGA
-    fpga_set_channel_offset(&calibrationsettings);
+    //Saturate on the sample range, the same as the ADC does for an out of range signal
+    if(result < -128)
+    {
+      result = -128;
+    }
+    else if(result > 127)
+    {
+      result = 127;
+    }
 
-    //Wait 50ms before sampling
-    timer0_delay(50);
+    //The squares for the RMS are on the centered samples
+    squares += result * result;
 
-    //Start the conversion and wait until done
-    fpga_do_conversion();
+    result += 128;
 
-    //Get the data from a sample run
-    fpga_read_sample_data(&calibrationsettings, 100);
+    output[index] = result;
 
-    //Check if the average reading is outside allowed range
-    if((calibrationsettings.adc1rawaverage < 125) || (calibrationsettings.adc1rawaverage > 131))
+    if(result < min)
     {
-      //When deviation is more then 3, signal it as a failure
-      flag = 0;
+      min = result;
     }
 
-    //Sum the ADC differences
-    compensationsum += (calibrationsettings.adc2rawaverage - calibrationsettings.adc1rawaverage);
+    if(result > max)
+    {
+      max = result;
+    }
+
+    sum += result;
   }
 
-  //Calculate the average of the ADC difference
-  compensationsum /= 6;
+  mathchannel.min      = min;
+  mathchannel.max      = max;
+  mathchannel.average  = sum / count;
+  mathchannel.rms      = isqrt(squares / count);
+  mathchannel.peakpeak = max - min;
+  mathchannel.center   = (max + min) / 2;
 
-  //Split the difference on the two ADC's
-  calibrationsettings.adc1compensation = compensationsum / 2;
-  calibrationsettings.adc2compensation = -1 * (compensationsum - calibrationsettings.adc1compensation);
+  //The time measurements are based on the zero crossings of the ADC data, which the math trace does not have
+  mathchannel.frequencyvalid = 0;
+}
 
-  //Check if the found result is within limits
-  if((compensationsum < -20) || (compensationsum > 20))
+//----------------------------------------------------------------------------------------------------------------------------------
+
+PCHANNELSETTINGS scope_get_measurement_channel(uint32 channel)
+{
+  if(channel == 0)
   {
-    //Not so clear the flag
-    flag = 0;
+    return(&scopesettings.channel1);
   }
-
-  //Adjust the center point DC offsets with the found compensation values
-  for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+  else if(channel == MATH_MEASUREMENT_CHANNEL)
   {
-    //The DC offset is based on the pre compensated ADC1 reading, so need to adjust with the average DC offset step times the ADC1 compensation value
-    calibrationsettings.dc_calibration_offset[voltperdiv] = (int16)calibrationsettings.dc_calibration_offset[voltperdiv] + (((int32)calibrationsettings.adc1compensation * (((int32)sampleratedcoffsetstep[0][voltperdiv] + (int32)sampleratedcoffsetstep[1][voltperdiv]) / 2)) >> 20);
+    return(&mathchannel);
   }
 
-  //Return the result of the tests. True if all tests passed
-  return(flag);
+  return(&scopesettings.channel2);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+//Adds the values of the new capture to the statistics of the measurement slots. A slot starts over when its measurement or the
+//settings its values depend on changed
 
-void scope_do_auto_setup(void)
+void scope_update_measurement_statistics(void)
 {
-  PCHANNELSETTINGS settings;
+  PMEASUREMENTINFO       item;
+  PCHANNELSETTINGS       settings;
+  PMEASUREMENTSTATISTICS statistics;
+  uint32 slot;
+  uint32 key;
+  int32  value;
+
+  for(slot=0;slot<(sizeof(scopesettings.measurementitems)/sizeof(MEASUREMENTINFO));slot++)
+  {
+    item = &scopesettings.measurementitems[slot];
+    settings = item->channelsettings;
+    statistics = &measurementstatistics[slot];
 
-  int32  screentime;
-  int32  timeperdiv;
-  int32  samplerate;
+    //The values are in ADC steps and samples, so they only compare for the same sensitivity and sample rate
+    key = item->index | (item->channel << 4) | (settings->samplevoltperdiv << 8) | ((uint8)settings->magnification << 12) | (scopesettings.samplerate << 16);
 
-  uint32 dochannel1 = scopesettings.channel1.enable;
-  uint32 dochannel2 = scopesettings.channel2.enable;
+    if(statistics->settings != key)
+    {
+      statistics->settings = key;
+      statistics->count = 0;
+    }
 
-  //No need to do auto setup if no channel is enabled
-  if((dochannel1 == 0) && (dochannel2 == 0))
-  {
-    return;
+    //Make sure the value is computed for this capture
+    fpga_compute_measurement_inputs(settings, measurement_inputs[item->index]);
+
+    //Captures without a valid value are not counted
+    if(scope_get_measurement_value(item->index, settings, &value))
+    {
+      scope_add_statistics_value(statistics, value);
+    }
   }
+}
 
-  //Disable the trigger circuit
-  scopesettings.samplemode = 0;
-  
-  //Modification on 09-03-2022. Begin
-  //Switch back to AUTO trigger mode to avoid lockup in NORMAL or SINGLE mode
-  scopesettings.triggermode = 0;
-  
-  //Show it on the display
-  ui_display_trigger_mode();
-  
-  //Also set the FPGA to the AUTO trigger mode
-  fpga_set_trigger_mode();
-  
-  //To make sure the scope will be running after auto set, set the run mode to running
-  scopesettings.runstate = RUN_STATE_RUNNING;
-  
-  //Show this on the screen
-  ui_display_run_stop_text();
-  //End. 09-03-2022
+//----------------------------------------------------------------------------------------------------------------------------------
 
-  //Send the command for setting the trigger level to the FPGA
-  fpga_write_cmd(0x17);
-  fpga_write_byte(0);
+void scope_reset_measurement_statistics(void)
+{
+  uint32 slot;
 
-  //Setup channel 1 if enabled
-  if(dochannel1)
+  for(slot=0;slot<(sizeof(scopesettings.measurementitems)/sizeof(MEASUREMENTINFO));slot++)
   {
-    //Use the most sensitive hardware setting and set it in the FPGA
-    scopesettings.channel1.samplevoltperdiv = 5;
-    fpga_set_channel_voltperdiv(&scopesettings.channel1);
+    measurementstatistics[slot].count = 0;
   }
+}
 
-  //Setup channel 2 if enabled
-  if(dochannel2)
+//----------------------------------------------------------------------------------------------------------------------------------
+//Gets the value of a measurement with STATISTICS_FRACTION_BITS fraction bits. The voltages are in ADC steps, the times in samples
+//and the duty cycles in 0.1%. The frequency is taken as the period time, since it is derived from it. Returns 0 when there is no
+//valid value
+
+uint32 scope_get_measurement_value(uint32 index, PCHANNELSETTINGS settings, int32 *value)
+{
+  int32 min;
+  int32 max;
+  int32 average;
+  int32 rms;
+
+  //The voltages are always valid. The time measurements need the zero crossings of the signal
+  if((index >= 6) && (settings->frequencyvalid == 0))
   {
-    //Use the most sensitive hardware setting and set it in the FPGA
-    scopesettings.channel2.samplevoltperdiv = 5;
-    fpga_set_channel_voltperdiv(&scopesettings.channel2);
+    return(0);
   }
 
-  //Select the channel to work with
-  if(scopesettings.triggerchannel == 0)
+  //The voltages come with fraction bits when the samples have extra resolution
+  if(settings->precisionbits)
   {
-    settings = &scopesettings.channel1;
+    min     = settings->precisemin;
+    max     = settings->precisemax;
+    average = settings->preciseaverage;
+    rms     = settings->preciserms;
   }
   else
   {
-    settings = &scopesettings.channel2;
+    min     = settings->min << STATISTICS_FRACTION_BITS;
+    max     = settings->max << STATISTICS_FRACTION_BITS;
+    average = settings->average << STATISTICS_FRACTION_BITS;
+    rms     = settings->rms << STATISTICS_FRACTION_BITS;
   }
 
-  //Wait 50ms to allow the relays to settle
-  timer0_delay(50);
-
-  //Do the measurements on four sample rates. 200MSa/s, 2MSa/s, 20KSa/s and 1000Sa/s
-  for(samplerate=0;samplerate<4;samplerate++)
+  switch(index)
   {
-    //Set the selected sample rate
-    fpga_set_sample_rate(samplerate_for_autosetup[samplerate]);
+    case 0:
+      //Vmax is taken of the center ADC value
+      *value = max - (128 << STATISTICS_FRACTION_BITS);
+      return(1);
+
+    case 1:
+      //Vmin is taken of the center ADC value
+      *value = min - (128 << STATISTICS_FRACTION_BITS);
+      return(1);
+
+    case 2:
+      //Vavg is taken of the center ADC value
+      *value = average - (128 << STATISTICS_FRACTION_BITS);
+      return(1);
+
+    case 3:
+      //Vrms is already centered
+      *value = rms;
+      return(1);
+
+    case 4:
+      *value = max - min;
+      return(1);
+
+    case 5:
+      //Vp is the biggest of the two extremes
+      min = (128 << STATISTICS_FRACTION_BITS) - min;
+      max = max - (128 << STATISTICS_FRACTION_BITS);
+
+      *value = (min > max) ? min : max;
+      return(1);
+
+    case 6:
+    case 7:
+      //Frequency and cycle time both use the period time
+      *value = settings->periodtime >> STATISTICS_TIME_SHIFT;
+      return(1);
+
+    case 8:
+      *value = settings->hightime >> STATISTICS_TIME_SHIFT;
+      return(1);
+
+    case 9:
+      *value = settings->lowtime >> STATISTICS_TIME_SHIFT;
+      return(1);
+
+    case 10:
+      *value = ((uint64)settings->hightime * 1000) / settings->periodtime;
+      break;
 
-    //Set the matching time base
-    fpga_set_time_base(sample_rate_time_per_div[samplerate_for_autosetup[samplerate]]);
+    case 11:
+      *value = ((uint64)settings->lowtime * 1000) / settings->periodtime;
+      break;
 
-    //Start the conversion and wait until done
-    fpga_do_conversion();
+    default:
+      return(0);
+  }
 
-    //Get the data from a sample run
-    fpga_read_sample_data(settings, 100);
+  //The voltages and times have their fraction already, the duty cycles need it added
+  *value <<= STATISTICS_FRACTION_BITS;
 
-    //Check if there is a frequency reading and break the loop if so
-    if(settings->frequencyvalid)
-    {
-      break;
-    }
-  }
+  return(1);
+}
 
-  //When there is a frequency reading determine the needed time per division setting
-  if(settings->frequencyvalid)
-  {
-    //Can't use the frequency here since it is based on the scopesettings.samplerate variable, which is not used here
-    //Calculate the time in nanoseconds for getting three periods on the screen
-    screentime = (float)settings->periodtime * sample_time_converters[samplerate_for_autosetup[samplerate]];
+//----------------------------------------------------------------------------------------------------------------------------------
+//Welford's running update of the mean and the squared differences, which needs no buffer of old values and does not suffer from
+//cancellation like summing the squares does. The mean comes from the sum of the values to keep it exact
 
-    //Match the found time to the nearest time per division setting
-    for(timeperdiv=0;timeperdiv<24;timeperdiv++)
-    {
-      //When the found time is higher than the selected time per division quit the search
-      if(screentime > time_per_div_matching[timeperdiv])
-      {
-        break;
-      }
-    }
+void scope_add_statistics_value(PMEASUREMENTSTATISTICS statistics, int32 value)
+{
+  int32 delta;
 
-    //Check if not on the first setting
-    if(timeperdiv)
-    {
-      //If so take one of to get to the right one to use. Also ensures not selecting a non existing setting if none found
-      timeperdiv--;
-    }
+  statistics->count++;
 
-    //Select the found time per division
-    scopesettings.timeperdiv = timeperdiv;
-    scopesettings.samplerate = time_per_div_sample_rate[timeperdiv];
+  //The first value sets the start point
+  if(statistics->count == 1)
+  {
+    statistics->minimum = value;
+    statistics->maximum = value;
+    statistics->mean = value;
+    statistics->sum = value;
+    statistics->m2 = 0;
+    return;
   }
-  else
+
+  if(value < statistics->minimum)
   {
-    //Set a default sample rate and time per division setting
-    scopesettings.timeperdiv = 12;
-    scopesettings.samplerate = time_per_div_sample_rate[12];
+    statistics->minimum = value;
   }
 
-  //On a change of sample rate or time per division it is necessary to re calculate the values for determining the number of point to display
-  scope_calculate_sample_range_properties();
-  
-  //Range the input sensitivity on the enabled channels
-  //Check on which bottom check level needs to be used
-  //When both channels are enabled and in normal display mode use separate sections of the screen for each channel.
-  if(dochannel1 && dochannel2 && (scopesettings.tracedisplaymode == DISPLAY_MODE_NORMAL))
+  if(value > statistics->maximum)
   {
-    //Both channels enabled then use a lower level. Smaller section of the display available per channel so lower value
-    scopesettings.channel1.maxscreenspace = 1900;
-    scopesettings.channel2.maxscreenspace = 1900;
+    statistics->maximum = value;
+  }
 
-    //Give both traces it's own location on screen
-    scopesettings.channel1.traceposition = 300;
-    scopesettings.channel2.traceposition = 100;
+  delta = value - statistics->mean;
 
-    //Get the sample data for the not trigger source channel when a valid frequency has been determined
-    if(settings->frequencyvalid)
-    {
-      //Check which channel is the trigger source
-      if(scopesettings.triggerchannel == 0)
-      {
-        //Channel 1 is trigger source so get channel 2 data
-        fpga_read_sample_data(&scopesettings.channel2, 100);
-      }
-      else
-      {
-        //Channel 2 is trigger source so get channel 1 data
-        fpga_read_sample_data(&scopesettings.channel1, 100);
-      }
-    }
-  }
-  else
-  {
-    //Only one channel enabled then more screen space available for it so higher value
-    scopesettings.channel1.maxscreenspace = 3900;
-    scopesettings.channel2.maxscreenspace = 3900;
+  statistics->sum += value;
+  statistics->mean = statistics->sum / statistics->count;
 
-    //Used channel will be set on the middle of the display
-    scopesettings.channel1.traceposition = 200;
-    scopesettings.channel2.traceposition = 200;
-  }
+  statistics->m2 += (int64)delta * (value - statistics->mean);
+}
 
-  //Set the new sample rate in the FPGA
-  fpga_set_sample_rate(scopesettings.samplerate);
+//----------------------------------------------------------------------------------------------------------------------------------
+//Returns the standard deviation with STATISTICS_FRACTION_BITS fraction bits
 
-  //Show the new settings
-  ui_display_time_per_division();
+uint32 scope_get_statistics_deviation(PMEASUREMENTSTATISTICS statistics)
+{
+  uint64 variance;
 
-  //Check the channels on valid voltage readings with the already done conversion, but only when valid frequency
-  if(settings->frequencyvalid)
+  //The truncated mean can make the sum go just below zero for a constant value
+  if((statistics->count < 2) || (statistics->m2 <= 0))
   {
-    //Check if channel 1 is enabled and check its range if so
-    if(dochannel1)
-    {
-      dochannel1 = scope_check_channel_range(&scopesettings.channel1);
-    }
-
-    //Check if channel 2 is enabled and check its range if so
-    if(dochannel2)
-    {
-      dochannel2 = scope_check_channel_range(&scopesettings.channel2);
-    }
+    return(0);
   }
 
-  //If one or either channel not in range another conversion is needed
-  if(dochannel1 || dochannel2)
+  variance = statistics->m2 / statistics->count;
+
+  //The square root only takes 32 bits, so for a big variance the fraction is dropped. The deviation is at least a whole unit then
+  if(variance >> 32)
   {
-    //Check if channel 1 still needs to be done
-    if(dochannel1)
-    {
-      //Use the 500mV/div setting and set it in the FPGA
-      scopesettings.channel1.samplevoltperdiv = 3;
-      fpga_set_channel_voltperdiv(&scopesettings.channel1);
-    }
+    return(isqrt(variance >> (2 * STATISTICS_FRACTION_BITS)) << STATISTICS_FRACTION_BITS);
+  }
 
-    //Check if channel 2 still needs to be done
-    if(dochannel2)
-    {
-      //Use the 500mV/div setting and set it in the FPGA
-      scopesettings.channel2.samplevoltperdiv = 3;
-      fpga_set_channel_voltperdiv(&scopesettings.channel2);
-    }
+  return(isqrt(variance));
+}
 
-    //Wait 50ms to allow the relays to settle
-    timer0_delay(50);
+//----------------------------------------------------------------------------------------------------------------------------------
 
-    //Start the conversion and wait until done
-    fpga_do_conversion();
+void scope_arm_acquisition(void)
+{
+  timing_start(TIMING_STAGE_ARM);
 
-    //Check if channel 1 still needs to be done
-    if(dochannel1)
-    {
-      //Get the data from a sample run
-      fpga_read_sample_data(&scopesettings.channel1, 100);
+  //Show the user waiting for a trigger
+  ui_display_waiting_triggered_text(0);
 
-      //Check the range again
-      dochannel1 = scope_check_channel_range(&scopesettings.channel1);
-    }
+  //Set the trigger level
+  fpga_set_trigger_level();
 
-    //Check if channel 2 still needs to be done
-    if(dochannel2)
-    {
-      //Get the data from a sample run
-      fpga_read_sample_data(&scopesettings.channel2, 100);
+  //Write the time base setting to the FPGA
+  fpga_set_time_base(scopesettings.timeperdiv);
 
-      //Check the range again
-      dochannel2 = scope_check_channel_range(&scopesettings.channel2);
-    }
+  //Sampling with trigger circuit enabled
+  scopesettings.samplemode = 1;
 
-    //If one or either channel not in range another conversion is needed
-    if(dochannel1 || dochannel2)
-    {
-      //Check if channel 1 still needs to be done
-      if(dochannel1)
-      {
-        //Use the 2.5V/div setting and set it in the FPGA
-        scopesettings.channel1.samplevoltperdiv = 1;
-        fpga_set_channel_voltperdiv(&scopesettings.channel1);
-      }
+  //Start the conversion without waiting for it to finish
+  fpga_start_conversion();
 
-      //Check if channel 2 still needs to be done
-      if(dochannel2)
-      {
-        //Use the 2.5V/div setting and set it in the FPGA
-        scopesettings.channel2.samplevoltperdiv = 1;
-        fpga_set_channel_voltperdiv(&scopesettings.channel2);
-      }
+  timing_end(TIMING_STAGE_ARM);
 
-      //Wait 50ms to allow the relays to settle
-      timer0_delay(50);
+  //From here on the FPGA is waiting for the trigger
+  timing_start(TIMING_STAGE_TRIGGER_WAIT);
 
-      //Start the conversion and wait until done
-      fpga_do_conversion();
+  //Signal the FPGA is busy filling its sample memory
+  acquisitionstate = ACQUISITION_STATE_WAITING;
+}
 
-      //Check if channel 1 still needs to be done
-      if(dochannel1)
-      {
-        //Get the data from a sample run
-        fpga_read_sample_data(&scopesettings.channel1, 100);
+//----------------------------------------------------------------------------------------------------------------------------------
+//Drops a capture that is not going to be read. When the FPGA is still waiting on a trigger its trigger system is disabled, the same
+//as is done after a capture is done
 
-        //Check the range again
-        dochannel1 = scope_check_channel_range(&scopesettings.channel1);
-      }
+void scope_abort_acquisition(void)
+{
+  if(acquisitionstate == ACQUISITION_STATE_WAITING)
+  {
+    fpga_end_conversion();
+  }
 
-      //Check if channel 2 still needs to be done
-      if(dochannel2)
-      {
-        //Get the data from a sample run
-        fpga_read_sample_data(&scopesettings.channel2, 100);
+  acquisitionstate = ACQUISITION_STATE_IDLE;
+}
 
-        //Check the range again
-        dochannel2 = scope_check_channel_range(&scopesettings.channel2);
-      }
+//----------------------------------------------------------------------------------------------------------------------------------
 
-      //If one or either channel not in range the least sensitive setting needs to be used
-      if(dochannel1 || dochannel2)
-      {
-        //Check if channel 1 still not done
-        if(dochannel1)
-        {
-          //Set the lowest sensitivity for this channel
-          scopesettings.channel1.samplevoltperdiv = 0;
-        }
+void scope_next_history_segment(void)
+{
+  //Select the next segment in the ring. When the ring is full the oldest capture is overwritten
+  historyindex++;
 
-        //Check if channel 2 still not done
-        if(dochannel2)
-        {
-          //Set the lowest sensitivity for this channel
-          scopesettings.channel2.samplevoltperdiv = 0;
-        }
-      }
-    }
+  if(historyindex >= HISTORY_SEGMENTS)
+  {
+    historyindex = 0;
   }
 
-  //Check if channel 1 is enabled and set the new settings if so
-  if(scopesettings.channel1.enable)
+  //Keep track of how many segments are filled for limiting the browsing
+  if(historycount < HISTORY_SEGMENTS)
   {
-    //Set the new setting in the FPGA
-    fpga_set_channel_voltperdiv(&scopesettings.channel1);
+    historycount++;
+  }
 
-    //Copy the found sample volt per division setting to the display setting
-    scopesettings.channel1.displayvoltperdiv = scopesettings.channel1.samplevoltperdiv;
-    
-    //Update the display
-    ui_display_channel_settings(&scopesettings.channel1);
+  //A new capture always brings the view back to the latest one and on its trigger point
+  historyviewoffset = 0;
+  searchcurrent = -1;
+
+  //Only the enabled channels are read, so the others keep pointing to their last valid capture
+  historysegments[historyindex].channel1enable = scopesettings.channel1.enable;
+  historysegments[historyindex].channel2enable = scopesettings.channel2.enable;
+
+  //Remember what the channels show now, so a dropped capture can go back to it
+  channel1previousbuffer = scopesettings.channel1.tracebuffer;
+  channel1previousbits   = scopesettings.channel1.precisionbits;
+  channel2previousbuffer = scopesettings.channel2.tracebuffer;
+  channel2previousbits   = scopesettings.channel2.precisionbits;
+
+  //Point the enabled channels to the segment for reading the samples into it
+  if(scopesettings.channel1.enable)
+  {
+    scopesettings.channel1.tracebuffer = (uint8 *)channel1history[historyindex];
+    scopesettings.channel1.precisionbits = 0;
   }
 
-  //Check if channel 2 is enabled and set the new settings if so
   if(scopesettings.channel2.enable)
   {
-    //Set the new setting in the FPGA
-    fpga_set_channel_voltperdiv(&scopesettings.channel2);
-
-    //Copy the found sample volt per division setting to the display setting
-    scopesettings.channel2.displayvoltperdiv = scopesettings.channel2.samplevoltperdiv;
-    
-    //Update the display
-    ui_display_channel_settings(&scopesettings.channel2);
+    scopesettings.channel2.tracebuffer = (uint8 *)channel2history[historyindex];
+    scopesettings.channel2.precisionbits = 0;
   }
-
-  //Adjust the trigger level to 50% setting
-  scope_set_50_percent_trigger();
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+//Undoes scope_next_history_segment for a capture that is not used. When the ring was full the oldest capture has been overwritten
+//by it, so the number of filled segments goes down either way
 
-uint32 scope_check_channel_range(PCHANNELSETTINGS settings)
+void scope_previous_history_segment(void)
 {
-  uint32 screenpixels;
-  uint32 range;
-  uint32 notdone = 0;
+  if(historyindex == 0)
+  {
+    historyindex = HISTORY_SEGMENTS;
+  }
 
-  //Convert the peak peak reading to screen pixels
-  screenpixels = (settings->peakpeak * signal_adjusters[settings->samplevoltperdiv]) >> VOLTAGE_SHIFTER;
+  historyindex--;
 
-  //Check if there is any signal at all to avoid divide by zero
-  if(screenpixels)
+  if(historycount)
   {
-    //Calculate a fixed point range to determine the volts per division setting, based on the available screen space
-    range = settings->maxscreenspace / screenpixels;
+    historycount--;
+  }
 
-    //Check if signal is at least 10 times smaller then the max range
-    if(range >= 100)
-    {
-      //If so go three sensitivity settings up. (e.g. 500mV/div ==> 50mV/div)
-      settings->samplevoltperdiv = 3;
-    }
-    //Else check if signal is at least 5 times smaller then the max range
-    else if(range >= 50)
-    {
-      //If so go two sensitivity settings up. (e.g. 500mV/div ==> 100mV/div)
-      settings->samplevoltperdiv += 2;
-    }
-    //Else check if signal is at least 2.5 times smaller then the max range
-    else if(range >= 25)
-    {
-      //If so go one sensitivity setting up. (e.g. 500mV/div ==> 200mV/div)
-      settings->samplevoltperdiv += 1;
-    }
-    //Else check if signal is bigger then the max range
-    else if(range < 10)
-    {
-      //Out of range so not done
-      notdone = 1;
-    }
+  //Point the channels back to what they showed before the dropped capture was read
+  if(scopesettings.channel1.enable)
+  {
+    scope_restore_segment_samples(&scopesettings.channel1, (uint8 *)channel1history[historyindex], historysegments[historyindex].channel1enable, channel1previousbuffer, channel1previousbits);
+  }
 
-    //Check if volt per division not out of range
-    if(settings->samplevoltperdiv > 6)
-    {
-      //Keep it on max if so
-      settings->samplevoltperdiv = 6;
-    }
+  if(scopesettings.channel2.enable)
+  {
+    scope_restore_segment_samples(&scopesettings.channel2, (uint8 *)channel2history[historyindex], historysegments[historyindex].channel2enable, channel2previousbuffer, channel2previousbits);
   }
-  else
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//A segment is only reselected when it holds a capture of the channel. The high resolution filter has to be redone on it, because
+//the dropped capture has been filtered into the processed buffer. Without such a segment the channel was showing samples from
+//outside the ring, like a loaded waveform or the capture of an earlier segment, so the remembered buffer is used
+
+void scope_restore_segment_samples(PCHANNELSETTINGS settings, uint8 *samples, uint32 segmentvalid, uint8 *previousbuffer, uint32 previousbits)
+{
+  if(historycount && segmentvalid)
   {
-    //When there is no signal use the most sensitive setting
-    settings->samplevoltperdiv = 6;
+    scope_select_segment_samples(settings, samples, 1);
   }
+  else
+  {
+    settings->tracebuffer = previousbuffer;
+    settings->precisionbits = previousbits;
 
-  return(notdone);
+    //The measurements are redone for the restored samples
+    settings->measurementinputs = 0;
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+//Points the channel to the samples to show for a history segment. The history holds the samples as captured, so in high resolution
+//mode they are filtered again, and for the latest capture in the averaging modes the average is used
 
-void scope_calculate_trigger_vertical_position(void)
+void scope_select_segment_samples(PCHANNELSETTINGS settings, uint8 *samples, uint32 latest)
 {
-  PCHANNELSETTINGS oldsettings;
-  PCHANNELSETTINGS newsettings;
-  int32            delta;
-  int32            volts;
+  settings->tracebuffer = samples;
+  settings->precisionbits = 0;
 
-  //Select the channel based on the current trigger channel
-  if(scopesettings.triggerchannel == 0)
+  //The measurements are redone for the selected samples
+  settings->measurementinputs = 0;
+
+  if(scopesettings.acquisitionmode == ACQUISITION_MODE_HIGH_RES)
   {
-    newsettings = &scopesettings.channel1;
-    oldsettings = &scopesettings.channel2;
-    
+    scope_high_res_filter(settings);
   }
-  else
+  else if(latest && averagecount && (scopesettings.acquisitionmode >= ACQUISITION_MODE_AVERAGE_2) && (scopesettings.acquisitionmode <= ACQUISITION_MODE_AVERAGE_256))
   {
-    newsettings = &scopesettings.channel2;
-    oldsettings = &scopesettings.channel1;
+    //The average is still in the processed buffer
+    settings->tracebuffer = settings->processedbuffer;
+    settings->precisionbits = averageshift;
   }
-
-  //Get the delta of the old trigger channel position versus the trigger level position
-  delta = scopesettings.triggerverticalposition - oldsettings->traceposition;
-  
-  //Multiply with the scaling factor for the old settings to get the level expressed in volts
-  volts = delta * volt_calc_data[oldsettings->magnification][oldsettings->displayvoltperdiv].mul_factor;
-  
-  //Convert it back into a position delta based on the new trigger channel settings
-  delta = volts / volt_calc_data[newsettings->magnification][newsettings->displayvoltperdiv].mul_factor;
-  
-  //Add the new channel trace position to get the new trigger position
-  scopesettings.triggerverticalposition = newsettings->traceposition + delta;
-  
-  //Show the new value on the screen
-  ui_display_trigger_vertical_position();
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
-void scope_set_50_percent_trigger(void)
+void scope_show_history_segment(int32 offset)
 {
-  PCHANNELSETTINGS settings;
-  int32            position;
+  uint32 longrecord = scope_long_record_in_view();
+  uint32 index;
 
-  //Select the channel based on the current trigger channel
-  if(scopesettings.triggerchannel == 0)
+  //Nothing to browse when there are no captures yet
+  if(historycount == 0)
   {
-    settings = &scopesettings.channel1;
+    return;
   }
-  else
+
+  //Limit the offset on the available segments
+  if(offset < 0)
   {
-    settings = &scopesettings.channel2;
+    offset = 0;
+  }
+  else if(offset >= (int32)historycount)
+  {
+    offset = historycount - 1;
   }
 
-  //Set the active channel center as the new trigger level
-  scopesettings.triggerlevel = settings->center;
-  
-  //Center the trigger level around 0 point
-  position = scopesettings.triggerlevel - 128;
+  historyviewoffset = offset;
 
-  //Adjust it for the current volt per div setting
-  position = (position * signal_adjusters[settings->displayvoltperdiv]) >> VOLTAGE_SHIFTER;
+  //The events of the previous segment do not apply to this one
+  searchcurrent = -1;
 
-  //Add the trace center to it and set as new trigger position
-  scopesettings.triggerverticalposition = settings->traceposition + position;
-  
-  //Show the new value on the screen
-  ui_display_trigger_vertical_position();
-}
+  //Get the ring index of the selected segment
+  if(historyindex >= historyviewoffset)
+  {
+    index = historyindex - historyviewoffset;
+  }
+  else
+  {
+    index = historyindex + HISTORY_SEGMENTS - historyviewoffset;
+  }
 
-//----------------------------------------------------------------------------------------------------------------------------------
+  //Point the channels to the samples of the segment. Channels that were not enabled for this capture keep their data
+  if(historysegments[index].channel1enable)
+  {
+    scope_select_segment_samples(&scopesettings.channel1, (uint8 *)channel1history[index], (offset == 0));
+  }
 
-void scope_calculate_sample_range_properties(void)
-{
-  //The amount of x positions needed per sample is based on the number of pixels per division, the set time per division and the sample rate.
-  disp_xpos_per_sample = (50.0 * frequency_per_div[scopesettings.timeperdiv]) / sample_rate[scopesettings.samplerate];
+  if(historysegments[index].channel2enable)
+  {
+    scope_select_segment_samples(&scopesettings.channel2, (uint8 *)channel2history[index], (offset == 0));
+  }
 
-  //This gives the step size for going through the samples. Is also the linear interleaving step for the y direction
-  disp_sample_step = 1.0 / disp_xpos_per_sample;
+  //Restore the trigger point of the capture so it is displayed the same as when it was taken
+  disp_trigger_index = historysegments[index].triggerindex;
+  disp_trigger_fraction = historysegments[index].triggerfraction;
 
-  //The displayable x range is based on the number of samples and the number of x positions needed per sample
-  //Halved to allow trigger position to be in the center
-  disp_xrange = (SAMPLE_COUNT * disp_xpos_per_sample) / 2.0;
+  //List the events of the shown segment
+  scope_build_search_index();
 
-  //x range needs to be at least 1 pixel
-  if(disp_xrange < 1.0)
+  //Only show the selected segment in the persistence display
+  scope_clear_phosphor();
+
+  //The long record only holds the latest capture so the displayable range changes when going in or out of the history
+  if(longrecord != scope_long_record_in_view())
   {
-    disp_xrange = 1.0;
+    scope_calculate_sample_range_properties();
   }
-  
-  //Set the bounds for horizontal trigger position adjustment
-  //Limit on the ends a bit extra to avoid artifacts
-  trigger_position_min = (TRACE_HORIZONTAL_END - disp_xrange) + 5;
-  trigger_position_max = (TRACE_HORIZONTAL_START + disp_xrange) - 5;
+}
 
-  //Limit the current pointer to the new extremes
-  if(scopesettings.triggerhorizontalposition < trigger_position_min)
+//----------------------------------------------------------------------------------------------------------------------------------
+
+//The hardware puts the trigger point around the given index. The level crossing closest to it in the whole buffer is used, with
+//hysteresis against noise and interpolated between the two samples around it to stop the trace jumping from sample to sample
+
+void scope_process_trigger(uint32 count)
+{
+  uint8  *buffer;
+  int32   index;
+  int32   level = scopesettings.triggerlevel;
+  int32   sample1;
+  int32   sample2;
+
+  //Select the trace buffer to process based on the trigger channel
+  if(scopesettings.triggerchannel == 0)
   {
-    //Limit it on the minimum range if needed
-    scopesettings.triggerhorizontalposition = trigger_position_min;
+    //Channel 1 buffer
+    buffer = scopesettings.channel1.tracebuffer;
+  }
+  else
+  {
+    //Channel 2 buffer
+    buffer = scopesettings.channel2.tracebuffer;
+  }
+
+  //Assume it to be in the center of the sample buffer to start with
+  disp_trigger_index = SAMPLES_PER_ADC;
+  disp_trigger_fraction = 0;
+
+  //Find the sample before the crossing
+  index = scope_find_trigger_edge(buffer, count);
+
+  if(index < 0)
+  {
+    //No crossing in the buffer so keep the default
+    return;
+  }
+
+  sample1 = buffer[index];
+  sample2 = buffer[index + 1];
+
+  scope_set_trigger_point(index, sample1, sample2, level);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Sets the trigger position on the crossing of the level between the sample on the index and the next one, interpolated between
+//the two. Works for both directions as long as the level is in between the samples
+
+void scope_set_trigger_point(int32 index, int32 sample1, int32 sample2, int32 level)
+{
+  uint64 fraction;
+
+  //Get the part of the step between the two samples where the signal crosses the level
+  if(sample2 > sample1)
+  {
+    fraction = ((uint64)(level - sample1) << 32) / (sample2 - sample1);
+  }
+  else
+  {
+    fraction = ((uint64)(sample1 - level) << 32) / (sample1 - sample2);
+  }
+
+  //A crossing on the second sample is a whole step
+  if(fraction >> 32)
+  {
+    index++;
+    fraction = 0;
+  }
+
+  disp_trigger_index = index;
+  disp_trigger_fraction = (uint32)fraction;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Sets the trigger position on the event of the selected trigger qualifier closest to the hardware trigger point. Returns 0 when the
+//capture does not hold one
+
+uint32 scope_qualify_trigger(int32 center)
+{
+  return(scope_scan_trigger_events(center, 0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Lists the events of the selected trigger qualifier in the capture for stepping through them. Without a qualifier the trigger
+//edges are listed
+
+void scope_build_search_index(void)
+{
+  searchcount = 0;
+
+  scope_scan_trigger_events(0, 1);
+
+  //Keep the selected event within the list when the criterion changed
+  if(searchcurrent >= (int32)searchcount)
+  {
+    searchcurrent = (int32)searchcount - 1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Selects an event of the search index to center the display on. Going before the first one returns to the trigger point
+
+void scope_select_search_event(int32 index)
+{
+  //The cursors or the qualifier might have been changed since the list was made
+  scope_build_search_index();
+
+  if(index < 0)
+  {
+    index = -1;
+  }
+  else if(index >= (int32)searchcount)
+  {
+    index = (int32)searchcount - 1;
+  }
+
+  searchcurrent = index;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Checks the capture on the selected trigger qualifier in a single pass. When collecting, all the events are stored in the search
+//index and their number is returned. Otherwise the trigger position is set on the event closest to the hardware trigger point,
+//returning 0 when there is none. The limits come from the cursors: the time between the two time cursors and, for runt and slope,
+//the level of the upper volt cursor for a rising edge or the lower one for a falling edge. Pulses start on the trigger edge, so for
+//a falling edge the samples are inverted and the same checks are done on negative pulses
+
+uint32 scope_scan_trigger_events(int32 center, uint32 collect)
+{
+  PCHANNELSETTINGS settings;
+  register uint8  *buffer;
+  register int32   sample;
+  register int32   index;
+  register int32   level;
+  register int32   low;
+  register int32   upper;
+  register uint32  invert = 0;
+  register uint32  high = 0;
+  register uint32  armed = 0;
+  register uint32  reached = 0;
+  int32  qualifier = scopesettings.triggerqualifier;
+  int32  limit;
+  int32  tolerance;
+  int32  width;
+  int32  rise = 0;
+  int32  fall = -1;
+  int32  edge = -1;
+  int32  event;
+  int32  eventlevel = 0;
+  int32  best = -1;
+  int32  bestlevel = 0;
+
+  //Select the channel based on the current trigger channel
+  if(scopesettings.triggerchannel == 0)
+  {
+    settings = &scopesettings.channel1;
+  }
+  else
+  {
+    settings = &scopesettings.channel2;
+  }
+
+  buffer = settings->tracebuffer;
+
+  //Without the limits the events are the plain trigger edges
+  if(scope_trigger_qualifier_usable() == 0)
+  {
+    qualifier = TRIGGER_QUALIFIER_OFF;
+  }
+
+  limit = scope_get_trigger_qualifier_limit();
+  tolerance = limit >> TRIGGER_WIDTH_TOLERANCE_SHIFT;
+
+  level = scopesettings.triggerlevel;
+
+  if(scopesettings.triggeredge == 0)
+  {
+    upper = scope_get_screen_sample(settings, scopesettings.voltcursor1position);
+  }
+  else
+  {
+    //Same as for the edge search, on the inverted samples the level becomes the first value above the inverted one
+    invert = 0xFF;
+    level  = 256 - level;
+    upper  = 255 - scope_get_screen_sample(settings, scopesettings.voltcursor2position);
+  }
+
+  low = level - TRIGGER_HYSTERESIS;
+
+  for(index=0;index<SAMPLE_COUNT;index++)
+  {
+    sample = buffer[index] ^ invert;
+    event = -1;
+
+    if(high == 0)
+    {
+      if(sample < low)
+      {
+        //Coming from below the hysteresis band allows the next pulse to start
+        armed = 1;
+      }
+      else if(armed && (sample >= level))
+      {
+        //Start of a pulse on the trigger edge
+        high = 1;
+        armed = 0;
+        rise = index;
+        edge = index;
+        fall = -1;
+        reached = 0;
+
+        //Without a qualifier the edge itself is the event
+        if(qualifier == TRIGGER_QUALIFIER_OFF)
+        {
+          event = index - 1;
+          eventlevel = level;
+        }
+      }
+    }
+    else if(sample >= level)
+    {
+      //Still in the pulse, so a dip that did not go through the hysteresis band is not the end of it
+      fall = -1;
+    }
+    else
+    {
+      //Keep the first sample below the level as the end of the pulse
+      if(fall < 0)
+      {
+        fall = index;
+      }
+
+      //The pulse only ended when the signal went through the hysteresis band
+      if(sample < low)
+      {
+        high = 0;
+        armed = 1;
+
+        width = fall - rise;
+
+        //The event is on the end of the pulse, which crosses the level in the other direction
+        if(((qualifier == TRIGGER_QUALIFIER_WIDTH_LESS)  && (width < limit)) ||
+           ((qualifier == TRIGGER_QUALIFIER_WIDTH_MORE)  && (width > limit)) ||
+           ((qualifier == TRIGGER_QUALIFIER_WIDTH_RANGE) && (width >= (limit - tolerance)) && (width <= (limit + tolerance))) ||
+           ((qualifier == TRIGGER_QUALIFIER_RUNT)        && (reached == 0)))
+        {
+          event = fall - 1;
+          eventlevel = level;
+        }
+      }
+    }
+
+    //Check on the first time in the pulse the signal reaches the upper level
+    if(high && (reached == 0) && (sample >= upper))
+    {
+      reached = 1;
+
+      //The slope time is from crossing the trigger level to crossing the upper level
+      width = index - rise;
+
+      if(((qualifier == TRIGGER_QUALIFIER_SLOPE_LESS) && (width < limit)) ||
+         ((qualifier == TRIGGER_QUALIFIER_SLOPE_MORE) && (width > limit)))
+      {
+        event = index - 1;
+        eventlevel = upper;
+      }
+    }
+
+    //The timeout is from the last edge, so it triggers only once when no new edge is found within the time limit
+    if((qualifier == TRIGGER_QUALIFIER_TIMEOUT) && (edge >= 0) && ((index - edge) == limit))
+    {
+      event = index;
+      eventlevel = -1;
+    }
+
+    if(event >= 0)
+    {
+      if(collect)
+      {
+        //The events beyond the size of the index are dropped
+        if(searchcount < SEARCH_MAX_EVENTS)
+        {
+          searchevents[searchcount++] = event;
+        }
+
+        continue;
+      }
+
+      //The events come in order, so from the first one past the center the closest of it and the one before is used
+      if(event > center)
+      {
+        if((best < 0) || ((center - best) > (event - center)))
+        {
+          best = event;
+          bestlevel = eventlevel;
+        }
+
+        break;
+      }
+
+      best = event;
+      bestlevel = eventlevel;
+    }
+  }
+
+  if(collect)
+  {
+    return(searchcount);
+  }
+
+  if(best < 0)
+  {
+    return(0);
+  }
+
+  if((bestlevel < 0) || (best >= (SAMPLE_COUNT - 1)))
+  {
+    //No crossing to interpolate for a timeout
+    disp_trigger_index = best;
+    disp_trigger_fraction = 0;
+  }
+  else
+  {
+    //Interpolation gives the same part of the step on the inverted samples
+    scope_set_trigger_point(best, buffer[best] ^ invert, buffer[best + 1] ^ invert, bestlevel);
+  }
+
+  return(1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//The time limit of the trigger qualifiers is the distance between the time cursors expressed in samples. It is 0 when the time
+//cursors are not enabled
+
+int32 scope_get_trigger_qualifier_limit(void)
+{
+  int32 distance = scopesettings.timecursor2position - scopesettings.timecursor1position;
+
+  if(scopesettings.timecursorsenable == 0)
+  {
+    return(0);
+  }
+
+  //The cursors can be in either order
+  if(distance < 0)
+  {
+    distance = -distance;
+  }
+
+  return(((uint64)distance * disp_sample_step) >> SAMPLE_STEP_SHIFTER);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Checks if the cursors the selected trigger qualifier takes its limits from are enabled, with a time limit of at least a sample
+
+uint32 scope_trigger_qualifier_usable(void)
+{
+  uint32 qualifier = scopesettings.triggerqualifier;
+
+  //All but the runt check need a time limit
+  if((qualifier != TRIGGER_QUALIFIER_OFF) && (qualifier != TRIGGER_QUALIFIER_RUNT) && (scope_get_trigger_qualifier_limit() == 0))
+  {
+    return(0);
+  }
+
+  //The runt and slope checks need the level of a volt cursor
+  if(((qualifier == TRIGGER_QUALIFIER_RUNT) || (qualifier == TRIGGER_QUALIFIER_SLOPE_LESS) || (qualifier == TRIGGER_QUALIFIER_SLOPE_MORE)) && (scopesettings.voltcursorsenable == 0))
+  {
+    return(0);
+  }
+
+  return(1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Returns the lowest sample value that is displayed on or above the given screen y position
+
+int32 scope_get_screen_sample(PCHANNELSETTINGS settings, int32 ypos)
+{
+  int32 sample;
+
+  //Make sure the screen coordinate lookup table matches the current settings
+  scope_check_screen_lookup(settings);
+
+  //Higher samples are displayed higher up, so on a lower y
+  for(sample=0;sample<255;sample++)
+  {
+    if(settings->ylookup[sample] <= ypos)
+    {
+      break;
+    }
+  }
+
+  return(sample);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Returns the index of the sample before the level crossing closest to the center index, or -1 when there is none. The samples are
+//scanned a word at a time, so words that can not hold a crossing are skipped without looking at the single samples. A falling
+//edge is searched for as a rising one on the inverted samples
+
+int32 scope_find_trigger_edge(uint8 *buffer, int32 center)
+{
+  register uint32 *data = (uint32 *)buffer;
+  register uint32  word;
+  register uint32  above;
+  register uint32  below;
+  register uint32  flag;
+  register uint32  armed = 0;
+  register int32   index;
+  int32  level = scopesettings.triggerlevel;
+  int32  before = -1;
+  uint32 invert = 0;
+  uint32 count;
+
+  //On the inverted samples the level becomes the first value above the inverted one
+  if(scopesettings.triggeredge)
+  {
+    invert = 0xFFFFFFFF;
+    level = 256 - level;
+  }
+
+  //Without a sample value below the hysteresis band or above the level there can not be a crossing
+  if(((level - TRIGGER_HYSTERESIS) <= 0) || (level > 255))
+  {
+    return(-1);
+  }
+
+  for(count=0;count<(SAMPLE_COUNT / 4);count++)
+  {
+    word = *data++ ^ invert;
+
+    //Flag the samples on or above the level and the ones below the hysteresis band
+    above = scope_flag_samples_at_or_above(word, level);
+    below = scope_flag_samples_at_or_above(word, level - TRIGGER_HYSTERESIS) ^ TRIGGER_BYTE_HIGH_BITS;
+
+    //When armed only a word with a sample on the level can hold the crossing, otherwise only one that arms the search
+    if((armed && (above == 0)) || ((armed == 0) && (below == 0)))
+    {
+      continue;
+    }
+
+    //Go through the samples of the word in buffer order
+    for(index=count*4,flag=0x80;flag;index++,flag<<=8)
+    {
+      if(armed && (above & flag))
+      {
+        //The crossing is between the previous sample and this one
+        if(index > center)
+        {
+          //All crossings from here on are further away, so take the closest of this one and the one before the center
+          if((before >= 0) && ((center - before) <= (index - 1 - center)))
+          {
+            return(before);
+          }
+
+          return(index - 1);
+        }
+
+        before = index - 1;
+
+        //The signal needs to go through the hysteresis band again for the next crossing
+        armed = 0;
+      }
+      else if(below & flag)
+      {
+        armed = 1;
+      }
+    }
+  }
+
+  return(before);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Sets the top bit of every sample in the word that is on or above the level, without carries between the samples
+
+uint32 scope_flag_samples_at_or_above(uint32 word, uint32 level)
+{
+  //With the top bit forced on, the subtraction of the lower seven bits of the level can not borrow from the next sample
+  uint32 result = (word | TRIGGER_BYTE_HIGH_BITS) - ((level & 0x7F) * TRIGGER_BYTE_ONES);
+
+  //The top bit of the result is set when the lower seven bits of the sample are on or above the ones of the level
+  if(level & 0x80)
+  {
+    //For a level from 128 on the top bit of the sample needs to be set too
+    return(word & result & TRIGGER_BYTE_HIGH_BITS);
+  }
+
+  //For a lower level a set top bit is always above it
+  return((word | result) & TRIGGER_BYTE_HIGH_BITS);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 scope_do_baseline_calibration(void)
+{
+  uint32 flag = 1;
+  uint32 voltperdiv;
+
+  //Disable the trigger circuit
+  scopesettings.samplemode = 0;
+
+  //Send the command for setting the trigger level to the FPGA
+  fpga_write_cmd(0x17);
+  fpga_write_byte(0);
+  
+  //Send the command for auto trigger mode
+  fpga_write_cmd(0x1A);
+  fpga_write_byte(0);
+
+  //Clear the compensation values before doing the calibration
+  calibrationsettings.adc1compensation = 0;
+  calibrationsettings.adc2compensation = 0;
+
+  //Setup for channel 1 calibration
+  calibrationsettings.voltperdivcommand = 0x33;
+  calibrationsettings.offsetcommand     = 0x32;
+  calibrationsettings.adc1command       = 0x20;
+  calibrationsettings.adc2command       = 0x21;
+
+  //Use the trace buffer of this channel
+  calibrationsettings.tracebuffer = (uint8 *)channel1tracebuffer;
+
+  //Use the separate compensation lookup tables for the calibration
+  calibrationsettings.compensationtables = &calibrationcompensationtables;
+
+  //Calibrate this channel
+  flag &= scope_do_channel_calibration();
+
+  //Check if calibration was successful
+  if(flag)
+  {
+    //Copy the results if so
+    for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+    {
+      //For each volt per division setting there is a DC calibration offset
+      scopesettings.channel1.dc_calibration_offset[voltperdiv] = calibrationsettings.dc_calibration_offset[voltperdiv];
+    }
+
+    //The last one is also for the highest sensitivity setting
+    scopesettings.channel1.dc_calibration_offset[6] = scopesettings.channel1.dc_calibration_offset[5];
+
+    //Copy the ADC compensation values
+    scopesettings.channel1.adc1compensation = calibrationsettings.adc1compensation;
+    scopesettings.channel1.adc2compensation = calibrationsettings.adc2compensation;
+  }
+
+  //Setup for channel 2 calibration
+  calibrationsettings.voltperdivcommand = 0x36;
+  calibrationsettings.offsetcommand     = 0x35;
+  calibrationsettings.adc1command       = 0x22;
+  calibrationsettings.adc2command       = 0x23;
+
+  //Use the trace buffer of this channel
+  calibrationsettings.tracebuffer = (uint8 *)channel2tracebuffer;
+
+  //Calibrate this channel
+  flag &= scope_do_channel_calibration();
+
+  //Check if calibration was successful
+  if(flag)
+  {
+    //Copy the results if so
+    for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+    {
+      //For each volt per division setting there is a DC calibration offset
+      scopesettings.channel2.dc_calibration_offset[voltperdiv] = calibrationsettings.dc_calibration_offset[voltperdiv];
+    }
+
+    //The last one is also for the highest sensitivity setting
+    scopesettings.channel2.dc_calibration_offset[6] = scopesettings.channel2.dc_calibration_offset[5];
+
+    //Copy the ADC compensation values
+    scopesettings.channel2.adc1compensation = calibrationsettings.adc1compensation;
+    scopesettings.channel2.adc2compensation = calibrationsettings.adc2compensation;
+  }
+
+  //Load the normal operation settings back into the FPGA
+  fpga_set_channel_voltperdiv(&scopesettings.channel1);
+  fpga_set_channel_offset(&scopesettings.channel1);
+  fpga_set_channel_voltperdiv(&scopesettings.channel2);
+  fpga_set_channel_offset(&scopesettings.channel2);
+  fpga_set_sample_rate(scopesettings.samplerate);
+
+  return(flag);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define HIGH_DC_OFFSET   500
+#define LOW_DC_OFFSET   1200
+
+uint32 scope_do_channel_calibration(void)
+{
+  uint32 flag = 1;
+  int32  samplerate;
+  int32  voltperdiv;
+  int32  highaverage;
+  int32  lowaverage;
+  int32  dcoffsetstep;
+  int32  compensationsum = 0;
+
+  //Calibrate for the hardware sensitivity settings
+  for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+  {
+    //Set the to do sensitivity setting in the FPGA
+    calibrationsettings.samplevoltperdiv = voltperdiv;
+    fpga_set_channel_voltperdiv(&calibrationsettings);
+
+    //Wait 50ms to allow the relays to settle
+    timer0_delay(50);
+
+    //Start with the first set of averages
+    samplerateindex = 0;
+
+    //Do the measurements on two sample rates. 200MSa/s and 50KSa/s
+    for(samplerate=0;samplerate<18;samplerate+=11)
+    {
+      //Set the selected sample rate
+      fpga_set_sample_rate(samplerate);
+
+      //Set the matching time base
+      fpga_set_time_base(sample_rate_time_per_div[samplerate]);
+
+      //Set the high DC offset in the FPGA (Lower value returns higher ADC reading)
+      calibrationsettings.dc_calibration_offset[voltperdiv] = HIGH_DC_OFFSET;
+      fpga_set_channel_offset(&calibrationsettings);
+
+      //Wait 25ms before sampling
+      timer0_delay(25);
+
+      //Start the conversion and wait until done
+      fpga_do_conversion();
+
+      //Get the data from a sample run
+      fpga_read_sample_data(&calibrationsettings, 100, 0);
+
+      //Need the average as one reading here. Only use ADC1 data
+      highaverage = calibrationsettings.adc1rawaverage;
+
+      //Set the low DC offset in the FPGA (Higher value returns lower ADC reading)
+      calibrationsettings.dc_calibration_offset[voltperdiv] = LOW_DC_OFFSET;
+      fpga_set_channel_offset(&calibrationsettings);
+
+      //Wait 25ms before sampling
+      timer0_delay(25);
+
+      //Start the conversion and wait until done
+      fpga_do_conversion();
+
+      //Get the data from a sample run
+      fpga_read_sample_data(&calibrationsettings, 100, 0);
+
+      //Need the average as another reading here. Only use ADC1 data
+      lowaverage = calibrationsettings.adc1rawaverage;
+
+      //Calculate the DC offset step for a single ADC bit change for this volt/div setting
+      //Low DC offset minus high DC offset (1200 - 500) = 700. Scaled up for fixed point calculation ==> 700 << 20 = 734003200
+      dcoffsetstep = 734003200 / (highaverage - lowaverage);
+
+      //Calculate the average DC offset settings for both the low to center as the high to center readings
+      highaverage = HIGH_DC_OFFSET + (((highaverage - 128) * dcoffsetstep) >> 20);
+      lowaverage  = LOW_DC_OFFSET  - (((128 - lowaverage) * dcoffsetstep) >> 20);
+
+      //Set the result for this sample rate and volt per division setting
+      samplerateaverage[samplerateindex][voltperdiv] = (highaverage + lowaverage) / 2;
+
+      //Save the dc offset step for final calibration after compensation data has been determined
+      sampleratedcoffsetstep[samplerateindex][voltperdiv] = dcoffsetstep;
+
+      //Select the next set of sample indexes
+      samplerateindex++;
+    }
+  }
+
+  //Set the sample rate to 2MSa/s
+  fpga_set_sample_rate(6);
+
+  //Set the matching time base
+  fpga_set_time_base(sample_rate_time_per_div[6]);
+
+  //Average and test the results on a third sample rate
+  for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+  {
+    //Set the average of the two measurements as the DC offset to work with
+    calibrationsettings.dc_calibration_offset[voltperdiv] = (samplerateaverage[0][voltperdiv] + samplerateaverage[1][voltperdiv]) / 2;
+
+    //Set the to do sensitivity setting in the FPGA
+    calibrationsettings.samplevoltperdiv = voltperdiv;
+    fpga_set_channel_voltperdiv(&calibrationsettings);
+
+    //Set the new DC channel offset in the FPGA
+    fpga_set_channel_offset(&calibrationsettings);
+
+    //Wait 50ms before sampling
+    timer0_delay(50);
+
+    //Start the conversion and wait until done
+    fpga_do_conversion();
+
+    //Get the data from a sample run
+    fpga_read_sample_data(&calibrationsettings, 100, 0);
+
+    //Check if the average reading is outside allowed range
+    if((calibrationsettings.adc1rawaverage < 125) || (calibrationsettings.adc1rawaverage > 131))
+    {
+      //When deviation is more then 3, signal it as a failure
+      flag = 0;
+    }
+
+    //Sum the ADC differences
+    compensationsum += (calibrationsettings.adc2rawaverage - calibrationsettings.adc1rawaverage);
+  }
+
+  //Calculate the average of the ADC difference
+  compensationsum /= 6;
+
+  //Split the difference on the two ADC's
+  calibrationsettings.adc1compensation = compensationsum / 2;
+  calibrationsettings.adc2compensation = -1 * (compensationsum - calibrationsettings.adc1compensation);
+
+  //Check if the found result is within limits
+  if((compensationsum < -20) || (compensationsum > 20))
+  {
+    //Not so clear the flag
+    flag = 0;
+  }
+
+  //Adjust the center point DC offsets with the found compensation values
+  for(voltperdiv=0;voltperdiv<6;voltperdiv++)
+  {
+    //The DC offset is based on the pre compensated ADC1 reading, so need to adjust with the average DC offset step times the ADC1 compensation value
+    calibrationsettings.dc_calibration_offset[voltperdiv] = (int16)calibrationsettings.dc_calibration_offset[voltperdiv] + (((int32)calibrationsettings.adc1compensation * (((int32)sampleratedcoffsetstep[0][voltperdiv] + (int32)sampleratedcoffsetstep[1][voltperdiv]) / 2)) >> 20);
+  }
+
+  //Return the result of the tests. True if all tests passed
+  return(flag);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_do_auto_setup(void)
+{
+  PCHANNELSETTINGS settings;
+
+  int32  screentime;
+  int32  timeperdiv;
+  int32  samplerate;
+
+  uint32 dochannel1 = scopesettings.channel1.enable;
+  uint32 dochannel2 = scopesettings.channel2.enable;
+
+  //No need to do auto setup if no channel is enabled
+  if((dochannel1 == 0) && (dochannel2 == 0))
+  {
+    return;
+  }
+
+  //Disable the trigger circuit
+  scopesettings.samplemode = 0;
+  
+  //Modification on 09-03-2022. Begin
+  //Switch back to AUTO trigger mode to avoid lockup in NORMAL or SINGLE mode
+  scopesettings.triggermode = 0;
+  
+  //Show it on the display
+  ui_display_trigger_mode();
+  
+  //Also set the FPGA to the AUTO trigger mode
+  fpga_set_trigger_mode();
+  
+  //To make sure the scope will be running after auto set, set the run mode to running
+  scopesettings.runstate = RUN_STATE_RUNNING;
+  
+  //Show this on the screen
+  ui_display_run_stop_text();
+  //End. 09-03-2022
+
+  //Send the command for setting the trigger level to the FPGA
+  fpga_write_cmd(0x17);
+  fpga_write_byte(0);
+
+  //Setup channel 1 if enabled
+  if(dochannel1)
+  {
+    //Use the most sensitive hardware setting and set it in the FPGA
+    scopesettings.channel1.samplevoltperdiv = 5;
+    fpga_set_channel_voltperdiv(&scopesettings.channel1);
+  }
+
+  //Setup channel 2 if enabled
+  if(dochannel2)
+  {
+    //Use the most sensitive hardware setting and set it in the FPGA
+    scopesettings.channel2.samplevoltperdiv = 5;
+    fpga_set_channel_voltperdiv(&scopesettings.channel2);
+  }
+
+  //Select the channel to work with
+  if(scopesettings.triggerchannel == 0)
+  {
+    settings = &scopesettings.channel1;
+  }
+  else
+  {
+    settings = &scopesettings.channel2;
+  }
+
+  //Wait 50ms to allow the relays to settle
+  timer0_delay(50);
+
+  //Do the measurements on four sample rates. 200MSa/s, 2MSa/s, 20KSa/s and 1000Sa/s
+  for(samplerate=0;samplerate<4;samplerate++)
+  {
+    //Set the selected sample rate
+    fpga_set_sample_rate(samplerate_for_autosetup[samplerate]);
+
+    //Set the matching time base
+    fpga_set_time_base(sample_rate_time_per_div[samplerate_for_autosetup[samplerate]]);
+
+    //Start the conversion and wait until done
+    fpga_do_conversion();
+
+    //Get the data from a sample run
+    fpga_read_sample_data(settings, 100, MEASUREMENT_INPUTS_ALL);
+
+    //Check if there is a frequency reading and break the loop if so
+    if(settings->frequencyvalid)
+    {
+      break;
+    }
+  }
+
+  //When there is a frequency reading determine the needed time per division setting
+  if(settings->frequencyvalid)
+  {
+    //Can't use the frequency here since it is based on the scopesettings.samplerate variable, which is not used here
+    //Calculate the time in nanoseconds for getting three periods on the screen
+    screentime = (float)settings->periodtime * sample_time_converters[samplerate_for_autosetup[samplerate]];
+
+    //Match the found time to the nearest time per division setting
+    for(timeperdiv=0;timeperdiv<24;timeperdiv++)
+    {
+      //When the found time is higher than the selected time per division quit the search
+      if(screentime > time_per_div_matching[timeperdiv])
+      {
+        break;
+      }
+    }
+
+    //Check if not on the first setting
+    if(timeperdiv)
+    {
+      //If so take one of to get to the right one to use. Also ensures not selecting a non existing setting if none found
+      timeperdiv--;
+    }
+
+    //Select the found time per division
+    scopesettings.timeperdiv = timeperdiv;
+    scopesettings.samplerate = time_per_div_sample_rate[timeperdiv];
+  }
+  else
+  {
+    //Set a default sample rate and time per division setting
+    scopesettings.timeperdiv = 12;
+    scopesettings.samplerate = time_per_div_sample_rate[12];
+  }
+
+  //On a change of sample rate or time per division it is necessary to re calculate the values for determining the number of point to display
+  scope_calculate_sample_range_properties();
+  
+  //Range the input sensitivity on the enabled channels
+  //Check on which bottom check level needs to be used
+  //When both channels are enabled and in normal display mode use separate sections of the screen for each channel.
+  if(dochannel1 && dochannel2 && (scopesettings.tracedisplaymode == DISPLAY_MODE_NORMAL))
+  {
+    //Both channels enabled then use a lower level. Smaller section of the display available per channel so lower value
+    scopesettings.channel1.maxscreenspace = 1900;
+    scopesettings.channel2.maxscreenspace = 1900;
+
+    //Give both traces it's own location on screen
+    scopesettings.channel1.traceposition = 300;
+    scopesettings.channel2.traceposition = 100;
+
+    //Get the sample data for the not trigger source channel when a valid frequency has been determined
+    if(settings->frequencyvalid)
+    {
+      //Check which channel is the trigger source
+      if(scopesettings.triggerchannel == 0)
+      {
+        //Channel 1 is trigger source so get channel 2 data
+        fpga_read_sample_data(&scopesettings.channel2, 100, MEASUREMENT_INPUTS_ALL);
+      }
+      else
+      {
+        //Channel 2 is trigger source so get channel 1 data
+        fpga_read_sample_data(&scopesettings.channel1, 100, MEASUREMENT_INPUTS_ALL);
+      }
+    }
+  }
+  else
+  {
+    //Only one channel enabled then more screen space available for it so higher value
+    scopesettings.channel1.maxscreenspace = 3900;
+    scopesettings.channel2.maxscreenspace = 3900;
+
+    //Used channel will be set on the middle of the display
+    scopesettings.channel1.traceposition = 200;
+    scopesettings.channel2.traceposition = 200;
+  }
+
+  //Set the new sample rate in the FPGA
+  fpga_set_sample_rate(scopesettings.samplerate);
+
+  //Show the new settings
+  ui_display_time_per_division();
+
+  //Check the channels on valid voltage readings with the already done conversion, but only when valid frequency
+  if(settings->frequencyvalid)
+  {
+    //Check if channel 1 is enabled and check its range if so
+    if(dochannel1)
+    {
+      dochannel1 = scope_check_channel_range(&scopesettings.channel1);
+    }
+
+    //Check if channel 2 is enabled and check its range if so
+    if(dochannel2)
+    {
+      dochannel2 = scope_check_channel_range(&scopesettings.channel2);
+    }
+  }
+
+  //If one or either channel not in range another conversion is needed
+  if(dochannel1 || dochannel2)
+  {
+    //Check if channel 1 still needs to be done
+    if(dochannel1)
+    {
+      //Use the 500mV/div setting and set it in the FPGA
+      scopesettings.channel1.samplevoltperdiv = 3;
+      fpga_set_channel_voltperdiv(&scopesettings.channel1);
+    }
+
+    //Check if channel 2 still needs to be done
+    if(dochannel2)
+    {
+      //Use the 500mV/div setting and set it in the FPGA
+      scopesettings.channel2.samplevoltperdiv = 3;
+      fpga_set_channel_voltperdiv(&scopesettings.channel2);
+    }
+
+    //Wait 50ms to allow the relays to settle
+    timer0_delay(50);
+
+    //Start the conversion and wait until done
+    fpga_do_conversion();
+
+    //Check if channel 1 still needs to be done
+    if(dochannel1)
+    {
+      //Get the data from a sample run
+      fpga_read_sample_data(&scopesettings.channel1, 100, MEASUREMENT_INPUTS_ALL);
+
+      //Check the range again
+      dochannel1 = scope_check_channel_range(&scopesettings.channel1);
+    }
+
+    //Check if channel 2 still needs to be done
+    if(dochannel2)
+    {
+      //Get the data from a sample run
+      fpga_read_sample_data(&scopesettings.channel2, 100, MEASUREMENT_INPUTS_ALL);
+
+      //Check the range again
+      dochannel2 = scope_check_channel_range(&scopesettings.channel2);
+    }
+
+    //If one or either channel not in range another conversion is needed
+    if(dochannel1 || dochannel2)
+    {
+      //Check if channel 1 still needs to be done
+      if(dochannel1)
+      {
+        //Use the 2.5V/div setting and set it in the FPGA
+        scopesettings.channel1.samplevoltperdiv = 1;
+        fpga_set_channel_voltperdiv(&scopesettings.channel1);
+      }
+
+      //Check if channel 2 still needs to be done
+      if(dochannel2)
+      {
+        //Use the 2.5V/div setting and set it in the FPGA
+        scopesettings.channel2.samplevoltperdiv = 1;
+        fpga_set_channel_voltperdiv(&scopesettings.channel2);
+      }
+
+      //Wait 50ms to allow the relays to settle
+      timer0_delay(50);
+
+      //Start the conversion and wait until done
+      fpga_do_conversion();
+
+      //Check if channel 1 still needs to be done
+      if(dochannel1)
+      {
+        //Get the data from a sample run
+        fpga_read_sample_data(&scopesettings.channel1, 100, MEASUREMENT_INPUTS_ALL);
+
+        //Check the range again
+        dochannel1 = scope_check_channel_range(&scopesettings.channel1);
+      }
+
+      //Check if channel 2 still needs to be done
+      if(dochannel2)
+      {
+        //Get the data from a sample run
+        fpga_read_sample_data(&scopesettings.channel2, 100, MEASUREMENT_INPUTS_ALL);
+
+        //Check the range again
+        dochannel2 = scope_check_channel_range(&scopesettings.channel2);
+      }
+
+      //If one or either channel not in range the least sensitive setting needs to be used
+      if(dochannel1 || dochannel2)
+      {
+        //Check if channel 1 still not done
+        if(dochannel1)
+        {
+          //Set the lowest sensitivity for this channel
+          scopesettings.channel1.samplevoltperdiv = 0;
+        }
+
+        //Check if channel 2 still not done
+        if(dochannel2)
+        {
+          //Set the lowest sensitivity for this channel
+          scopesettings.channel2.samplevoltperdiv = 0;
+        }
+      }
+    }
+  }
+
+  //Check if channel 1 is enabled and set the new settings if so
+  if(scopesettings.channel1.enable)
+  {
+    //Set the new setting in the FPGA
+    fpga_set_channel_voltperdiv(&scopesettings.channel1);
+
+    //Copy the found sample volt per division setting to the display setting
+    scopesettings.channel1.displayvoltperdiv = scopesettings.channel1.samplevoltperdiv;
+    
+    //Update the display
+    ui_display_channel_settings(&scopesettings.channel1);
+  }
+
+  //Check if channel 2 is enabled and set the new settings if so
+  if(scopesettings.channel2.enable)
+  {
+    //Set the new setting in the FPGA
+    fpga_set_channel_voltperdiv(&scopesettings.channel2);
+
+    //Copy the found sample volt per division setting to the display setting
+    scopesettings.channel2.displayvoltperdiv = scopesettings.channel2.samplevoltperdiv;
+    
+    //Update the display
+    ui_display_channel_settings(&scopesettings.channel2);
+  }
+
+  //Adjust the trigger level to 50% setting
+  scope_set_50_percent_trigger();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 scope_check_channel_range(PCHANNELSETTINGS settings)
+{
+  uint32 screenpixels;
+  uint32 range;
+  uint32 notdone = 0;
+
+  //Convert the peak peak reading to screen pixels
+  screenpixels = (settings->peakpeak * signal_adjusters[settings->samplevoltperdiv]) >> VOLTAGE_SHIFTER;
+
+  //Check if there is any signal at all to avoid divide by zero
+  if(screenpixels)
+  {
+    //Calculate a fixed point range to determine the volts per division setting, based on the available screen space
+    range = settings->maxscreenspace / screenpixels;
+
+    //Check if signal is at least 10 times smaller then the max range
+    if(range >= 100)
+    {
+      //If so go three sensitivity settings up. (e.g. 500mV/div ==> 50mV/div)
+      settings->samplevoltperdiv = 3;
+    }
+    //Else check if signal is at least 5 times smaller then the max range
+    else if(range >= 50)
+    {
+      //If so go two sensitivity settings up. (e.g. 500mV/div ==> 100mV/div)
+      settings->samplevoltperdiv += 2;
+    }
+    //Else check if signal is at least 2.5 times smaller then the max range
+    else if(range >= 25)
+    {
+      //If so go one sensitivity setting up. (e.g. 500mV/div ==> 200mV/div)
+      settings->samplevoltperdiv += 1;
+    }
+    //Else check if signal is bigger then the max range
+    else if(range < 10)
+    {
+      //Out of range so not done
+      notdone = 1;
+    }
+
+    //Check if volt per division not out of range
+    if(settings->samplevoltperdiv > 6)
+    {
+      //Keep it on max if so
+      settings->samplevoltperdiv = 6;
+    }
+  }
+  else
+  {
+    //When there is no signal use the most sensitive setting
+    settings->samplevoltperdiv = 6;
+  }
+
+  return(notdone);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_calculate_trigger_vertical_position(void)
+{
+  PCHANNELSETTINGS oldsettings;
+  PCHANNELSETTINGS newsettings;
+  int32            delta;
+  int32            volts;
+
+  //Select the channel based on the current trigger channel
+  if(scopesettings.triggerchannel == 0)
+  {
+    newsettings = &scopesettings.channel1;
+    oldsettings = &scopesettings.channel2;
+    
+  }
+  else
+  {
+    newsettings = &scopesettings.channel2;
+    oldsettings = &scopesettings.channel1;
+  }
+
+  //Get the delta of the old trigger channel position versus the trigger level position
+  delta = scopesettings.triggerverticalposition - oldsettings->traceposition;
+  
+  //Multiply with the scaling factor for the old settings to get the level expressed in volts
+  volts = delta * volt_calc_data[oldsettings->magnification][oldsettings->displayvoltperdiv].mul_factor;
+  
+  //Convert it back into a position delta based on the new trigger channel settings
+  delta = volts / volt_calc_data[newsettings->magnification][newsettings->displayvoltperdiv].mul_factor;
+  
+  //Add the new channel trace position to get the new trigger position
+  scopesettings.triggerverticalposition = newsettings->traceposition + delta;
+  
+  //Show the new value on the screen
+  ui_display_trigger_vertical_position();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_set_50_percent_trigger(void)
+{
+  PCHANNELSETTINGS settings;
+  int32            position;
+
+  //Select the channel based on the current trigger channel
+  if(scopesettings.triggerchannel == 0)
+  {
+    settings = &scopesettings.channel1;
+  }
+  else
+  {
+    settings = &scopesettings.channel2;
+  }
+
+  //The center comes from the sample statistics
+  fpga_compute_measurement_inputs(settings, MEASUREMENT_INPUT_STATISTICS);
+
+  //Set the active channel center as the new trigger level
+  scopesettings.triggerlevel = settings->center;
+  
+  //Center the trigger level around 0 point
+  position = scopesettings.triggerlevel - 128;
+
+  //Adjust it for the current volt per div setting
+  position = (position * signal_adjusters[settings->displayvoltperdiv]) >> VOLTAGE_SHIFTER;
+
+  //Add the trace center to it and set as new trigger position
+  scopesettings.triggerverticalposition = settings->traceposition + position;
+  
+  //Show the new value on the screen
+  ui_display_trigger_vertical_position();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_calculate_sample_range_properties(void)
+{
+  //The amount of x positions needed per sample is based on the number of pixels per division (50), the set time per division and the sample rate.
+  uint64 xpositions = 50ULL * frequency_per_div[scopesettings.timeperdiv];
+  uint64 xrange;
+
+  //The step size for going through the samples is the inverse of this. Is also the linear interleaving step for the y direction
+  //Done in 32.32 fixed point since there is no FPU. Rounded up so accumulating it over a screen width never ends up below a sample boundary
+  disp_sample_step = (((uint64)sample_rate[scopesettings.samplerate] << SAMPLE_STEP_SHIFTER) + xpositions - 1) / xpositions;
+
+  //The displayable x range is based on the number of samples and the number of x positions needed per sample
+  //Halved to allow trigger position to be in the center
+  xrange = (((scope_get_display_sample_count() / 2) * xpositions) << XRANGE_SHIFTER) / sample_rate[scopesettings.samplerate];
+
+  //x range needs to be at least 1 pixel
+  if(xrange < (1 << XRANGE_SHIFTER))
+  {
+    xrange = 1 << XRANGE_SHIFTER;
+  }
+  //Anything beyond the screen is not needed and would overflow the screen position calculations
+  else if(xrange > XRANGE_MAX)
+  {
+    xrange = XRANGE_MAX;
+  }
+
+  disp_xrange = xrange;
+
+  //Set the bounds for horizontal trigger position adjustment
+  //Limit on the ends a bit extra to avoid artifacts. The divides truncate towards zero just like the conversion from double did
+  trigger_position_min = (((TRACE_HORIZONTAL_END + 5) << XRANGE_SHIFTER) - disp_xrange) / (1 << XRANGE_SHIFTER);
+  trigger_position_max = (((TRACE_HORIZONTAL_START - 5) << XRANGE_SHIFTER) + disp_xrange) / (1 << XRANGE_SHIFTER);
+
+  //Limit the current pointer to the new extremes
+  if(scopesettings.triggerhorizontalposition < trigger_position_min)
+  {
+    //Limit it on the minimum range if needed
+    scopesettings.triggerhorizontalposition = trigger_position_min;
   }
   else if(scopesettings.triggerhorizontalposition > trigger_position_max)
   {
-    //Limit it on maximum range if needed
-    scopesettings.triggerhorizontalposition = trigger_position_max;
+    //Limit it on maximum range if needed
+    scopesettings.triggerhorizontalposition = trigger_position_max;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+// Signal data display functions
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 scope_long_record_in_view(void)
+{
+  //The long record is only available for the latest capture and not for the older history segments
+  return(scopesettings.longrecordenable && longrecordvalid && (historyviewoffset == 0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 scope_get_display_sample_count(void)
+{
+  //In long record mode the whole record is available for displaying
+  if(scope_long_record_in_view())
+  {
+    return(LONG_RECORD_SAMPLE_COUNT);
+  }
+
+  //Otherwise only the trace buffer
+  return(SAMPLE_COUNT);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Returns the first sample of a range of samples centered on the trigger point, moved to stay within the trace buffer
+
+uint32 scope_get_trigger_span_start(uint32 span)
+{
+  int32 start = disp_trigger_index - (int32)(span / 2);
+
+  if(start > (int32)(SAMPLE_COUNT - span))
+  {
+    start = SAMPLE_COUNT - span;
+  }
+
+  if(start < 0)
+  {
+    start = 0;
+  }
+
+  return(start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_trace_data(void)
+{
+  //When hidden the layers are merged in the main display buffer and need to be restored after the flip
+  uint32 restorelayers = (displaylayersshown == 0);
+  uint32 traceupdate = displaytraceupdate;
+  PDIRTYREGION region;
+
+  //Without new data, user input or changing timing figures the pages on the screen are still valid, so skip the frame
+  if((displaytraceupdate == 0) && (restorelayers == 0) && (displayoverlayredraw == 0) && (scopesettings.timingmode == TIMING_MODE_OFF))
+  {
+    return;
+  }
+
+  //Handled with this frame
+  displaytraceupdate = 0;
+
+  //Count the pixels written for this frame
+  display_reset_pixel_count();
+
+  //The previous frame needs to be on the display before its old pages can be drawn in
+  timing_start(TIMING_STAGE_PAGE_FLIP);
+  display_wait_page_flip();
+  timing_end(TIMING_STAGE_PAGE_FLIP);
+
+  //Each page keeps track of what was drawn on it the last time it was used
+  region = &tracedirtyregions[(tracebackbuffer == displaylayerpages[0]) ? 0 : 1];
+
+  //The grid is on the main display buffer below the traces, so only the parts of the trace layer drawn on before need to be cleared
+  display_set_screen_buffer(tracebackbuffer);
+  display_set_fg_color(COLOR_BLACK);
+  display_fill_dirty_region(region);
+
+  //Start tracking the changes for this frame
+  display_set_dirty_region(0);
+  display_clear_dirty_region(region);
+  display_set_dirty_region(region);
+
+  timing_start(TIMING_STAGE_TRACE_DRAW);
+
+  //Check if scope is in normal display mode
+  if(scopesettings.tracedisplaymode == DISPLAY_MODE_NORMAL)
+  {
+    //The view is placed on the trigger point unless an event is selected, which is put in the center of the screen
+    int32  anchorposition = scopesettings.triggerhorizontalposition;
+    int32  anchorindex = disp_trigger_index;
+    uint32 anchorfraction = disp_trigger_fraction;
+
+    if(searchcurrent >= 0)
+    {
+      anchorposition = TRACE_HORIZONTAL_CENTER;
+      anchorindex = searchevents[searchcurrent];
+      anchorfraction = 0;
+    }
+
+    //Calculate the start and end x coordinates
+    disp_xstart = ((anchorposition << XRANGE_SHIFTER) - disp_xrange) / (1 << XRANGE_SHIFTER);
+    disp_xend = ((anchorposition << XRANGE_SHIFTER) + disp_xrange) / (1 << XRANGE_SHIFTER);
+
+    //Limit on just before the start of trace display
+    if(disp_xstart < TRACE_HORIZONTAL_MIN)
+    {
+      disp_xstart = TRACE_HORIZONTAL_MIN;
+    }
+
+    //And limit slightly after the end of the trace display for better results
+    if(disp_xend > TRACE_HORIZONTAL_MAX)
+    {
+      disp_xend = TRACE_HORIZONTAL_MAX;
+    }
+
+    //Determine first sample to use based on the number of samples per pixel and the trigger position in relation to the center of the screen
+    //The center delta is a half pixel so the position is doubled and the number of x positions per sample doubled with it
+    int64 samples = (int64)(TRACE_CENTER_DELTA_X2 - (anchorposition * 2)) * sample_rate[scopesettings.samplerate];
+    int64 xpositions = 100LL * frequency_per_div[scopesettings.timeperdiv];
+
+    //Round down to get the same first sample as the truncation of the positive results with the floating point calculation
+    int64 whole = samples / xpositions;
+    int64 remainder = samples % xpositions;
+
+    if(remainder < 0)
+    {
+      whole--;
+      remainder += xpositions;
+    }
+
+    //Keep the part of a sample that is left as fraction, with 24 bits to stay within 64 bits, and add the interpolated trigger
+    //position to it so the trace is placed on the actual crossing instead of the nearest sample
+    uint64 fraction = ((((uint64)remainder << 24) / xpositions) << 8) + anchorfraction;
+
+    disp_first_sample = anchorindex + (int32)whole + (int32)(fraction >> 32);
+    disp_first_fraction = (uint32)fraction;
+
+    //In long record mode the trace buffer sits in the center of the record
+    if(scope_long_record_in_view())
+    {
+      disp_first_sample += LONG_RECORD_TRACE_OFFSET;
+    }
+
+    //This makes sure no reading outside the buffer can occur
+    if(disp_sample_step > ((uint64)SAMPLES_PER_ADC << SAMPLE_STEP_SHIFTER))
+    {
+      disp_sample_step = (uint64)SAMPLES_PER_ADC << SAMPLE_STEP_SHIFTER;
+    }
+
+    //When the view starts before the first sample the pixels without samples are skipped, so the anchor stays on its position
+    if(disp_first_sample < 0)
+    {
+      uint64 skip = ((uint64)(-disp_first_sample) << SAMPLE_STEP_SHIFTER) - disp_first_fraction;
+      uint64 pixels = (skip + disp_sample_step - 1) / disp_sample_step;
+
+      //Check if there is anything left to draw
+      if(pixels < (uint64)(disp_xend - disp_xstart))
+      {
+        //Move on to the first sample within the buffer
+        uint64 position = (pixels * disp_sample_step) - skip;
+
+        disp_xstart += (int32)pixels;
+        disp_first_sample = (int32)(position >> SAMPLE_STEP_SHIFTER);
+        disp_first_fraction = (uint32)position;
+      }
+      else
+      {
+        disp_xstart = disp_xend;
+        disp_first_sample = 0;
+        disp_first_fraction = 0;
+      }
+    }
+
+    //The last sample read for the end of the view has to be within the buffer too, so the end is limited on the samples available
+    int32 samplecount = scope_get_display_sample_count();
+
+    if(disp_first_sample >= samplecount - 1)
+    {
+      disp_xend = disp_xstart;
+      disp_first_sample = samplecount - 1;
+      disp_first_fraction = 0;
+    }
+    else
+    {
+      uint64 available = ((((uint64)(samplecount - 1 - disp_first_sample)) << SAMPLE_STEP_SHIFTER) - disp_first_fraction) / disp_sample_step;
+
+      if(available < (uint64)(disp_xend - disp_xstart))
+      {
+        disp_xend = disp_xstart + (int32)available;
+      }
+    }
+
+    //Check if channel1 is enabled
+    if(scopesettings.channel1.enable)
+    {
+      //Go and do the actual trace drawing
+      scope_display_channel_trace(&scopesettings.channel1);
+    }
+
+    //Check if channel2 is enabled
+    if(scopesettings.channel2.enable)
+    {
+      //Go and do the actual trace drawing
+      scope_display_channel_trace(&scopesettings.channel2);
+    }
+
+    //Only combine the channels when there is new data or the settings changed
+    if(traceupdate)
+    {
+      scope_compute_math_channel();
+    }
+
+    //Check if the math trace is enabled
+    if(mathchannel.enable)
+    {
+      scope_display_channel_trace(&mathchannel);
+    }
+
+    //Check if the traces need to be shown with persistence
+    if(scopesettings.persistencemode != PERSISTENCE_MODE_OFF)
+    {
+      //Add the new capture to the hit counts and draw them instead of the vector traces
+      scope_display_phosphor();
+
+      //The persistence display writes the pixels directly, so the whole trace window needs to be cleared the next time
+      display_add_dirty_rect(TRACE_HORIZONTAL_START, TRACE_VERTICAL_START, TRACE_MAX_WIDTH, TRACE_MAX_HEIGHT);
+    }
+
+    //Check if the spectrum of channel 1 needs to be shown
+    if(scopesettings.channel1.enable && scopesettings.channel1.fftenable)
+    {
+      //Only transform the samples when there is new data or the settings changed
+      if(traceupdate)
+      {
+        scope_compute_channel_spectrum(&scopesettings.channel1);
+      }
+
+      scope_display_channel_spectrum(&scopesettings.channel1);
+    }
+
+    //Check if the spectrum of channel 2 needs to be shown
+    if(scopesettings.channel2.enable && scopesettings.channel2.fftenable)
+    {
+      //Only transform the samples when there is new data or the settings changed
+      if(traceupdate)
+      {
+        scope_compute_channel_spectrum(&scopesettings.channel2);
+      }
+
+      scope_display_channel_spectrum(&scopesettings.channel2);
+    }
+
+    //Show the scale of the spectrum when any is displayed
+    if((scopesettings.channel1.enable && scopesettings.channel1.fftenable) || (scopesettings.channel2.enable && scopesettings.channel2.fftenable))
+    {
+      display_set_fg_color(COLOR_WHITE);
+      display_set_font(&font_2);
+      display_text(FFT_TEXT_XPOS, FFT_TEXT_YPOS, "FFT 10dB/div");
+    }
+  }
+  else
+  {
+    //Scope set to x y display mode
+    //Set x-y mode display trace color
+    display_set_fg_color(XYMODE_COLOR);
+
+    //The trigger can be anywhere in the buffer, so keep the samples around it within the buffer
+    uint32 index = scope_get_trigger_span_start(730);
+    uint32 last = index + 730;
+
+    //Need two samples per channel
+    uint32 x1,x2;
+    uint32 y1,y2;
+
+    //Make sure the screen coordinate lookup tables match the current settings
+    scope_check_screen_lookup(&scopesettings.channel1);
+    scope_check_screen_lookup(&scopesettings.channel2);
+
+    //Channel 1 is used for x and channel 2 for y
+    register uint16 *xlookup = scopesettings.channel1.xlookup;
+    register uint16 *ylookup = scopesettings.channel2.ylookup;
+    register uint8  *xbuffer = scopesettings.channel1.tracebuffer;
+    register uint8  *ybuffer = scopesettings.channel2.tracebuffer;
+
+    //Get the samples for the first point
+    x1 = xlookup[xbuffer[index]];
+    y1 = ylookup[ybuffer[index]];
+    
+    //Handle all the needed samples
+    for(;index<last;index++)
+    {
+      //Get the samples for the next point
+      x2 = xlookup[xbuffer[index]];
+      y2 = ylookup[ybuffer[index]];
+
+      //Draw the line between these two points
+      display_draw_trace_line(x1, y1, x2, y2);
+
+      //Swap the points for drawing the next part
+      x1 = x2;
+      y1 = y2;
+    }
+  }
+
+  timing_end(TIMING_STAGE_TRACE_DRAW);
+
+  //When browsing the history show which segment is displayed
+  if(historyviewoffset)
+  {
+    scope_display_history_info();
+  }
+
+  //Show the acquisition mode when it is not the normal one
+  if(scopesettings.acquisitionmode != ACQUISITION_MODE_NORMAL)
+  {
+    scope_display_acquisition_info();
+  }
+
+  //Show when the trace is displayed from the long record
+  if(scopesettings.longrecordenable)
+  {
+    scope_display_long_record_info();
+  }
+
+  //Show which channels are combined for the math trace
+  if(mathchannel.enable)
+  {
+    scope_display_math_info();
+  }
+
+  //Show the condition captures need to meet to be displayed
+  if(scopesettings.triggerqualifier != TRIGGER_QUALIFIER_OFF)
+  {
+    scope_display_trigger_qualifier_info();
+  }
+
+  //The events can only be stepped through when stopped, so only show them then
+  if((scopesettings.runstate != RUN_STATE_RUNNING) && (scopesettings.tracedisplaymode == DISPLAY_MODE_NORMAL))
+  {
+    scope_display_search_info();
+  }
+
+  //Show the statistics of the measurement slots when requested
+  if(statisticsdisplay)
+  {
+    ui_display_measurement_statistics();
+  }
+
+  //Show the stage timing when enabled
+  if(scopesettings.timingmode != TIMING_MODE_OFF)
+  {
+    ui_display_timing_overlay();
+  }
+  
+  //To allow for grid brightness to be changed in the background of the slider menu draw it in when needed
+  ui_show_open_slider();
+
+  //The cursors and pointers only change with user input, so the overlay layer is only redrawn when needed
+  if(displayoverlayredraw)
+  {
+    timing_start(TIMING_STAGE_OVERLAY_DRAW);
+
+    //Clear the parts of the overlay drawn on the last time this page was used
+    region = &overlaydirtyregions[(overlaybackbuffer == displaylayerpages[2]) ? 0 : 1];
+    display_set_dirty_region(0);
+    display_set_screen_buffer(overlaybackbuffer);
+    display_set_fg_color(COLOR_BLACK);
+    display_fill_dirty_region(region);
+
+    //Start tracking the changes on this page
+    display_clear_dirty_region(region);
+    display_set_dirty_region(region);
+
+    //Draw the cursors with their text and measurement display
+    ui_display_cursors();
+
+    //Draw the signal center, trigger level and trigger position pointers
+    ui_draw_pointers();
+
+    timing_end(TIMING_STAGE_OVERLAY_DRAW);
+
+    //One page less to do
+    displayoverlayredraw--;
+  }
+
+  //The measurements and the main display buffer are not on the layers
+  display_set_dirty_region(0);
+
+  //Update the measurements in the six slots on the screen
+  timing_start(TIMING_STAGE_MEASUREMENTS);
+
+  //Add the values of a new capture to the statistics
+  if(statisticsupdate)
+  {
+    statisticsupdate = 0;
+    scope_update_measurement_statistics();
+  }
+
+  ui_update_measurements();
+  timing_end(TIMING_STAGE_MEASUREMENTS);
+
+  //The rest of the screen is drawn on the main display buffer
+  display_set_screen_buffer((uint16 *)maindisplaybuffer);
+
+  //Check if in waveform view
+  if(scopesettings.waveviewmode)
+  {
+    //Display the file name directly on the main display buffer because it is outside the trace window
+    display_set_fg_color(FILE_NAME_HIGHLIGHT_COLOR);
+    display_set_font(&font_0);
+    display_text(VIEW_FILENAME_XPOS, VIEW_FILENAME_YPOS, viewfilename);
+  }
+
+  //Keep the number of pixels written for the timing display
+  framepixelspushed = display_get_pixel_count();
+
+  //Show the new frame from the next vertical blanking on. This also enables the layers when they were hidden
+  display_request_page_flip();
+
+  //Check if the merged layers need to be removed from the main display buffer or the grid brightness has been changed
+  if(restorelayers || (gridtemplatebrightness != scopesettings.gridbrightness))
+  {
+    //Wait until the layers are on the screen to not show an empty trace window in between
+    display_wait_page_flip();
+
+    //Only have the grid in the trace window. The traces, cursors and pointers are on the layers above it
+    ui_restore_grid();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_hide_trace_layers(void)
+{
+  //Only needed when the layers are on the screen
+  if(displaylayersshown)
+  {
+    //Make sure the pages that are merged are the ones shown
+    display_wait_page_flip();
+
+    //Copy the traces, cursors and pointers into the main display buffer in the order the display engine stacks them
+    scope_merge_layer(tracefrontbuffer);
+    scope_merge_layer(overlayfrontbuffer);
+
+    //Only show the main display buffer so the user interface can be drawn on top of the merged layers
+    display_hide_layers();
+
+    //Both overlay pages need to be redrawn when the layers are shown again
+    displayoverlayredraw = DISPLAY_PAGES;
+  }
+
+  //Make sure further drawing is done on the main display buffer
+  display_set_screen_buffer((uint16 *)maindisplaybuffer);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_merge_layer(uint16 *layer)
+{
+  register uint16 *src = layer + (TRACE_VERTICAL_START * SCREEN_WIDTH) + TRACE_HORIZONTAL_START;
+  register uint16 *dst = (uint16 *)maindisplaybuffer + (TRACE_VERTICAL_START * SCREEN_WIDTH) + TRACE_HORIZONTAL_START;
+  register uint32  x;
+  register uint32  y;
+  register uint32  data;
+
+  //Only the trace window is used on the layers
+  for(y=0;y<TRACE_MAX_HEIGHT;y++)
+  {
+    for(x=0;x<TRACE_MAX_WIDTH;x++)
+    {
+      //Black is transparent on the layers, same as with the color key of the display engine
+      if((data = src[x]))
+      {
+        dst[x] = data;
+      }
+    }
+
+    src += SCREEN_WIDTH;
+    dst += SCREEN_WIDTH;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_history_info(void)
+{
+  uint32 index;
+
+  //Get the ring index of the displayed segment
+  if(historyindex >= historyviewoffset)
+  {
+    index = historyindex - historyviewoffset;
+  }
+  else
+  {
+    index = historyindex + HISTORY_SEGMENTS - historyviewoffset;
+  }
+
+  display_set_fg_color(COLOR_WHITE);
+  display_set_font(&font_2);
+
+  //Show the number of segments back from the latest capture
+  display_text(HISTORY_TEXT_XPOS, HISTORY_TEXT_YPOS, "History");
+  display_decimal(HISTORY_TEXT_XPOS + 52, HISTORY_TEXT_YPOS, -(int32)historyviewoffset);
+
+  //And the time in milliseconds between this capture and the latest one
+  display_decimal(HISTORY_TEXT_XPOS + 92, HISTORY_TEXT_YPOS, historysegments[index].timestamp - historysegments[historyindex].timestamp);
+  display_text(HISTORY_TEXT_XPOS + 152, HISTORY_TEXT_YPOS, "ms");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_acquisition_info(void)
+{
+  display_set_fg_color(COLOR_WHITE);
+  display_set_font(&font_2);
+
+  if(scopesettings.acquisitionmode == ACQUISITION_MODE_HIGH_RES)
+  {
+    display_text(ACQUISITION_TEXT_XPOS, ACQUISITION_TEXT_YPOS, "Hi-Res");
+  }
+  else
+  {
+    //Show the selected number of averaged captures
+    display_text(ACQUISITION_TEXT_XPOS, ACQUISITION_TEXT_YPOS, "Average");
+    display_decimal(ACQUISITION_TEXT_XPOS + 56, ACQUISITION_TEXT_YPOS, 1 << scopesettings.acquisitionmode);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_long_record_info(void)
+{
+  display_set_fg_color(COLOR_WHITE);
+  display_set_font(&font_2);
+  display_text(LONG_RECORD_TEXT_XPOS, LONG_RECORD_TEXT_YPOS, "Long record");
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_math_info(void)
+{
+  display_set_fg_color(MATH_COLOR);
+  display_set_font(&font_2);
+  display_text(MATH_TEXT_XPOS, MATH_TEXT_YPOS, (char *)math_mode_texts[scopesettings.mathmode]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_trigger_qualifier_info(void)
+{
+  display_set_fg_color(TRIGGER_COLOR);
+  display_set_font(&font_2);
+  display_text(TRIGGER_QUALIFIER_TEXT_XPOS, TRIGGER_QUALIFIER_TEXT_YPOS, (char *)trigger_qualifier_texts[scopesettings.triggerqualifier]);
+
+  //Show that the captures are not checked when the cursors for the limits are missing
+  if(scope_trigger_qualifier_usable() == 0)
+  {
+    display_text(TRIGGER_QUALIFIER_TEXT_XPOS + 64, TRIGGER_QUALIFIER_TEXT_YPOS, "n/a");
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_search_info(void)
+{
+  display_set_fg_color(TRIGGER_COLOR);
+  display_set_font(&font_2);
+
+  if(searchcurrent < 0)
+  {
+    //Only the number of events when centered on the trigger point
+    display_text(SEARCH_TEXT_XPOS, SEARCH_TEXT_YPOS, "Events");
+    display_decimal(SEARCH_TEXT_XPOS + 48, SEARCH_TEXT_YPOS, searchcount);
+  }
+  else
+  {
+    //Show which of the events is in the center of the screen
+    display_text(SEARCH_TEXT_XPOS, SEARCH_TEXT_YPOS, "Event");
+    display_decimal(SEARCH_TEXT_XPOS + 42, SEARCH_TEXT_YPOS, searchcurrent + 1);
+    display_text(SEARCH_TEXT_XPOS + 70, SEARCH_TEXT_YPOS, "/");
+    display_decimal(SEARCH_TEXT_XPOS + 78, SEARCH_TEXT_YPOS, searchcount);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_check_screen_lookup(PCHANNELSETTINGS settings)
+{
+  register int32  sample;
+  register uint32 index;
+
+  //The tables only depend on the volt per div settings and the trace position
+  uint32 lookupsettings = settings->displayvoltperdiv | (settings->samplevoltperdiv << 8) | ((uint16)settings->traceposition << 16);
+
+  //Check if the tables are still valid for the current settings
+  if(settings->lookupsettings == lookupsettings)
+  {
+    //Nothing to do when so
+    return;
+  }
+
+  //Signal the tables are build for the current settings
+  settings->lookupsettings = lookupsettings;
+
+  //Translate all the possible sample values to screen coordinates
+  for(index=0;index<256;index++)
+  {
+    //Center adjust the sample
+    sample = (int32)index - 128;
+
+    //Get the sample and adjust the data for the correct voltage per div setting
+    sample = (sample * signal_adjusters[settings->samplevoltperdiv]) >> VOLTAGE_SHIFTER;
+
+    //Scale the sample based on the two volt per div settings when they differ
+    if(settings->displayvoltperdiv != settings->samplevoltperdiv)
+    {
+      //Scaling factor is based on the two volts per division settings
+      sample = (sample * vertical_scaling_factors[settings->displayvoltperdiv][settings->samplevoltperdiv]) / SAMPLE_DIVIDER;
+    }
+
+    //Offset the sample on the screen
+    sample = settings->traceposition + sample;
+
+    //Limit sample on min displayable
+    if(sample < 0)
+    {
+      sample = 0;
+    }
+    //Limit the sample on max displayable
+    else if(sample > TRACE_WINDOW_BORDER_HEIGHT)
+    {
+      sample = TRACE_WINDOW_BORDER_HEIGHT;
+    }
+
+    //The x center position has an extra offset compared to the y trace position
+    settings->xlookup[index] = sample + TRACE_CHANNEL_XY_OFFSET;
+
+    //Display y coordinates are inverted to signal orientation
+    settings->ylookup[index] = TRACE_VERTICAL_END - sample;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_invalidate_screen_lookup(PCHANNELSETTINGS settings)
+{
+  //Make sure the tables are rebuild before the next use
+  settings->lookupsettings = SCREEN_LOOKUP_INVALID;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int32 scope_get_x_sample(PCHANNELSETTINGS settings, int32 index)
+{
+  //Translate the sample with the lookup table. Needs scope_check_screen_lookup to be called before use
+  return(settings->xlookup[settings->tracebuffer[index]]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+int32 scope_get_y_sample(PCHANNELSETTINGS settings, int32 index)
+{
+  //Translate the sample with the lookup table. Needs scope_check_screen_lookup to be called before use
+  return(settings->ylookup[settings->tracebuffer[index]]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_channel_trace(PCHANNELSETTINGS settings)
+{
+  register uint64 inputindex;
+
+  register int32 previousindex;
+  register int32 currentindex;
+  register int32 sample1 = 0;
+  register int32 sample2 = 0;
+  register uint32 lastx = disp_xstart;
+  register uint32 xpos = disp_xstart + 1;
+
+  register PDISPLAYPOINTS tracepoints = settings->tracepoints;
+
+  register uint16 *ylookup = settings->ylookup;
+  register uint8  *buffer = settings->tracebuffer;
+
+  //With persistence enabled only the trace points are needed, since the lines are drawn from the hit counts
+  register uint32 drawlines = (scopesettings.persistencemode == PERSISTENCE_MODE_OFF);
+
+  //In long record mode the trace is displayed from the record to allow panning through it with the trigger position
+  if(scope_long_record_in_view())
+  {
+    buffer = settings->longrecord;
+  }
+
+  //Make sure the screen coordinate lookup table matches the current settings
+  scope_check_screen_lookup(settings);
+
+  //Set the trace color for the current channel
+  display_set_fg_color(settings->color);
+
+  //With more than one sample per pixel the skipped samples would hide glitches, so draw the range of all the samples per column
+  if(disp_sample_step > (1ULL << SAMPLE_STEP_SHIFTER))
+  {
+    scope_display_channel_envelope(settings, buffer);
+    return;
+  }
+
+  //No spans for the other users of the trace data
+  settings->noftracespans = 0;
+
+  //Get the processed sample
+  sample1 = ylookup[buffer[disp_first_sample]];
+
+  //Store the first sample in the trace points buffer
+  tracepoints->x = lastx;
+  tracepoints->y = sample1;
+  tracepoints++;
+
+  //Start with one tracepoint
+  settings->noftracepoints = 1;
+
+  //Step to the next input index
+  //The integer part of the 32.32 fixed point index is in the top word, so no soft float is needed for stepping through the samples
+  inputindex = ((uint64)disp_first_sample << SAMPLE_STEP_SHIFTER) + disp_first_fraction + disp_sample_step;
+
+  //The previous index is the index of the first sample
+  previousindex = disp_first_sample;
+
+  //Process the sample data to screen data
+  for(; xpos < disp_xend; inputindex += disp_sample_step, xpos++)
+  {
+    //Get the current integer index into the sample buffer
+    currentindex = inputindex >> SAMPLE_STEP_SHIFTER;
+
+    //Check if linear approximation needs to be done. (Only when step < 1) pixels are skipped if so.
+    if(currentindex != previousindex)
+    {
+      //Set new previous index
+      previousindex = currentindex;
+
+      //Get the processed sample
+      sample2 = ylookup[buffer[currentindex]];
+
+      //Store the second sample in the screen buffer
+      tracepoints->x = xpos;
+      tracepoints->y = sample2;
+      tracepoints++;
+
+      //One more tracepoint
+      settings->noftracepoints++;
+
+      //Need to draw a line here
+      if(drawlines)
+      {
+        display_draw_trace_line(lastx, sample1, xpos, sample2);
+      }
+
+      sample1 = sample2;
+
+      lastx = xpos;
+    }
+  }
+
+  //When step less then 1 the last pixel needs to be interpolated between current sample and next sample.
+  if(disp_sample_step < (1ULL << SAMPLE_STEP_SHIFTER))
+  {
+    //Calculate the scaler for the last y value based on the x distance from the last drawn position to the end of the trace
+    //divided by the x distance it takes to where the next position should be drawn (Number of x steps per sample)
+    int64 scaler = (int64)(disp_xend - lastx) * (int64)disp_sample_step;
+
+    //Get the processed sample
+    sample2 = ylookup[buffer[inputindex >> SAMPLE_STEP_SHIFTER]];
+
+    //Avoid a divide by zero when already on the end of the screen
+    if(scaler)
+    {
+      //Interpolate between the two samples. sample1 is scaled up to the fixed point of the scaler to get a single truncating divide
+      sample2 = (((int64)sample1 * scaler) + ((int64)(sample2 - sample1) << SAMPLE_STEP_SHIFTER)) / scaler;
+    }
+
+    //Store the last sample in the screen buffer
+    tracepoints->x = xpos;
+    tracepoints->y = sample2;
+    tracepoints++;
+
+    //One more tracepoint
+    settings->noftracepoints++;
+
+    //Draw the last line
+    if(drawlines)
+    {
+      display_draw_trace_line(lastx, sample1, xpos, sample2);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void scope_display_channel_envelope(PCHANNELSETTINGS settings, uint8 *buffer)
+{
+  register uint64 inputindex;
+
+  register int32  sampleindex;
+  register int32  lastindex;
+  register uint32 sample;
+  register uint32 ymin;
+  register uint32 ymax;
+  register uint32 xpos = disp_xstart;
+
+  register PDISPLAYPOINTS tracepoints = settings->tracepoints;
+  register PDISPLAYSPAN   tracespans = settings->tracespans + disp_xstart;
+
+  register uint16 *ylookup = settings->ylookup;
+
+  //With persistence enabled only the spans are needed, since the lines are drawn from the hit counts
+  register uint32 drawlines = (scopesettings.persistencemode == PERSISTENCE_MODE_OFF);
+
+  //The first column only has the first sample
+  sampleindex = disp_first_sample;
+  sample = ylookup[buffer[sampleindex]];
+
+  //Step to the last sample of the next column
+  inputindex = ((uint64)disp_first_sample << SAMPLE_STEP_SHIFTER) + disp_first_fraction + disp_sample_step;
+
+  //Start with no points
+  settings->noftracepoints = 0;
+  settings->noftracespans  = 0;
+
+  ymin = sample;
+  ymax = sample;
+
+  //Process the sample data to a span per column
+  while(1)
+  {
+    //Store the range of this column
+    tracespans->ymin = ymin;
+    tracespans->ymax = ymax;
+    tracespans++;
+
+    //The last sample of the column is kept as the trace point for the thumbnails
+    tracepoints->x = xpos;
+    tracepoints->y = sample;
+    tracepoints++;
+
+    settings->noftracespans++;
+    settings->noftracepoints++;
+
+    //Draw the column as a single vertical run
+    if(drawlines)
+    {
+      display_draw_trace_line(xpos, ymin, xpos, ymax);
+    }
+
+    //Check if done with the last column
+    if(++xpos >= disp_xend)
+    {
+      break;
+    }
+
+    //Start the next column on the last sample of the previous one to connect them
+    ymin = sample;
+    ymax = sample;
+
+    //Get the index of the last sample of this column
+    lastindex = inputindex >> SAMPLE_STEP_SHIFTER;
+    inputindex += disp_sample_step;
+
+    //Find the minimum and maximum of all the samples in this column in a single pass
+    while(sampleindex < lastindex)
+    {
+      sampleindex++;
+
+      sample = ylookup[buffer[sampleindex]];
+
+      if(sample < ymin)
+      {
+        ymin = sample;
+      }
+      else if(sample > ymax)
+      {
+        ymax = sample;
+      }
+    }
   }
 }
 
-//----------------------------------------------------------------------------------------------------------------------------------
-// Signal data display functions
 //----------------------------------------------------------------------------------------------------------------------------------
 
-void scope_display_trace_data(void)
+void scope_compute_channel_spectrum(PCHANNELSETTINGS settings)
 {
-  //Use a separate buffer to clear the screen. Also used as source to copy back to the screen
-  display_set_screen_buffer(displaybuffer1);
-  display_set_source_buffer(displaybuffer1);
+  uint8  *buffer = settings->tracebuffer;
+  uint16 *spectrum = settings->spectrum;
+  int32   first = disp_first_sample;
+  int32   last = scope_get_display_sample_count() - (1 << FFT_DISPLAY_BITS);
+  uint32  bins = (1 << FFT_DISPLAY_BITS) / 2;
+  uint32  column;
+  uint32  bin;
+  uint32  nextbin;
+  int32   level;
+  int32   maximum;
+  int32   ypos;
+
+  timing_start(TIMING_STAGE_FFT);
+
+  //In long record mode the spectrum is taken from the record like the trace
+  if(scope_long_record_in_view())
+  {
+    buffer = settings->longrecord;
+  }
 
-  //Clear the trace portion of the screen
-  display_set_fg_color(COLOR_BLACK);
-  display_fill_rect(TRACE_HORIZONTAL_START, TRACE_VERTICAL_START, TRACE_MAX_WIDTH - 1, TRACE_MAX_HEIGHT - 1);
+  //Take the samples from the start of the displayed trace, but keep them within the buffer
+  if(first > last)
+  {
+    first = last;
+  }
 
-  //Draw the grid lines and dots based on the grid brightness setting
-  ui_draw_grid();
+  //Transform the samples with the window and size set on startup
+  fft_process_samples(&buffer[first]);
 
-  //Check if scope is in normal display mode
-  if(scopesettings.tracedisplaymode == DISPLAY_MODE_NORMAL)
+  //Spread the bins from DC to half the sample rate over the width of the trace window. Multiple bins per column so the highest is used
+  for(column=0,bin=0;column<TRACE_MAX_WIDTH;column++)
   {
-    //Calculate the start and end x coordinates
-    disp_xstart = scopesettings.triggerhorizontalposition - disp_xrange;
-    disp_xend = scopesettings.triggerhorizontalposition + disp_xrange;
-
-    //Limit on just before the start of trace display
-    if(disp_xstart < TRACE_HORIZONTAL_MIN)
-    {
-      disp_xstart = TRACE_HORIZONTAL_MIN;
-    }
+    nextbin = ((column + 1) * bins) / TRACE_MAX_WIDTH;
+    maximum = -FFT_DISPLAY_RANGE;
 
-    //And limit slightly after the end of the trace display for better results
-    if(disp_xend > TRACE_HORIZONTAL_MAX)
+    for(;bin<nextbin;bin++)
     {
-      disp_xend = TRACE_HORIZONTAL_MAX;
-    }
+      level = fft_get_bin_db(bin);
 
-    //Determine first sample to use based on a full screen worth of samples and the trigger position in relation to the number of pixels on the screen
-    disp_first_sample = disp_trigger_index - ((((double)TRACE_MAX_WIDTH / disp_xpos_per_sample) * ((double)scopesettings.triggerhorizontalposition - TRACE_CENTER_DELTA)) / (double)TRACE_MAX_WIDTH);
-    
-    //If below the first sample limit it on the first sample
-    if(disp_first_sample < 0)
-    {
-      disp_first_sample = 0;
+      if(level > maximum)
+      {
+        maximum = level;
+      }
     }
 
-    //This makes sure no reading outside the buffer can occur
-    if(disp_sample_step > SAMPLES_PER_ADC)
-    {
-      disp_sample_step = SAMPLES_PER_ADC;
-    }
+    //0dB of full scale is on the top of the trace window
+    ypos = (-maximum * TRACE_MAX_HEIGHT) / FFT_DISPLAY_RANGE;
 
-    //Check if channel1 is enabled
-    if(scopesettings.channel1.enable)
+    //Limit it on the trace window
+    if(ypos < 0)
     {
-      //Go and do the actual trace drawing
-      scope_display_channel_trace(&scopesettings.channel1);
+      ypos = 0;
     }
-
-    //Check if channel2 is enabled
-    if(scopesettings.channel2.enable)
+    else if(ypos >= TRACE_MAX_HEIGHT)
     {
-      //Go and do the actual trace drawing
-      scope_display_channel_trace(&scopesettings.channel2);
+      ypos = TRACE_MAX_HEIGHT - 1;
     }
 
-    //Displaying of FFT needs to be added here.
-
+    spectrum[column] = TRACE_VERTICAL_START + ypos;
   }
-  else
-  {
-    //Scope set to x y display mode
-    //Set x-y mode display trace color
-    display_set_fg_color(XYMODE_COLOR);
 
-    uint32 index = disp_trigger_index - 365;
-    uint32 last = index + 730;
+  timing_end(TIMING_STAGE_FFT);
+}
 
-    //Need two samples per channel
-    uint32 x1,x2;
-    uint32 y1,y2;
+//----------------------------------------------------------------------------------------------------------------------------------
 
-    //Get the samples for the first point
-    x1 = scope_get_x_sample(&scopesettings.channel1, index);
-    y1 = scope_get_y_sample(&scopesettings.channel2, index);
-    
-    //Handle all the needed samples
-    for(;index<last;index++)
-    {
-      //Get the samples for the next point
-      x2 = scope_get_x_sample(&scopesettings.channel1, index);
-      y2 = scope_get_y_sample(&scopesettings.channel2, index);
+void scope_display_channel_spectrum(PCHANNELSETTINGS settings)
+{
+  uint16 *spectrum = settings->spectrum;
+  uint32  column;
 
-      //Draw the line between these two points
-      display_draw_line(x1, y1, x2, y2);
+  //Draw the spectrum in the channel color
+  display_set_fg_color(settings->color);
 
-      //Swap the points for drawing the next part
-      x1 = x2;
-      y1 = y2;
-    }
+  //Connect the levels of the columns
+  for(column=1;column<TRACE_MAX_WIDTH;column++)
+  {
+    display_draw_trace_line(TRACE_HORIZONTAL_START + column - 1, spectrum[column - 1], TRACE_HORIZONTAL_START + column, spectrum[column]);
   }
+}
 
-  //Draw the cursors with their text and measurement display
-  ui_display_cursors();
+//----------------------------------------------------------------------------------------------------------------------------------
 
-  //Draw the signal center, trigger level and trigger position pointers
-  ui_draw_pointers();
+void scope_build_phosphor_palette(PCHANNELSETTINGS settings)
+{
+  uint32  red   = (settings->color >> 16) & 0xFF;
+  uint32  green = (settings->color >> 8) & 0xFF;
+  uint32  blue  = settings->color & 0xFF;
+  uint32  index;
+  uint32  level;
+  uint32  r, g, b;
+  uint16 *palette = settings->phosphorpalette;
 
-  //Update the measurements in the six slots on the screen
-  ui_update_measurements();
-  
-  //To allow for grid brightness to be changed in the background of the slider menu draw it in when needed
-  ui_show_open_slider();
-  
-  //Copy it to the actual screen buffer
-  display_set_screen_buffer((uint16 *)maindisplaybuffer);
-  display_copy_rect_to_screen(TRACE_HORIZONTAL_START, TRACE_VERTICAL_START, TRACE_MAX_WIDTH, TRACE_MAX_HEIGHT);
+  //No hits means nothing to draw
+  palette[0] = 0;
 
-  //Check if in waveform view
-  if(scopesettings.waveviewmode)
+  for(index=1;index<256;index++)
   {
-    //Display the file name directly on the actual display because it is outside the trace window
-    display_set_fg_color(FILE_NAME_HIGHLIGHT_COLOR);
-    display_set_font(&font_0);
-    display_text(VIEW_FILENAME_XPOS, VIEW_FILENAME_YPOS, viewfilename);
+    //For the lower part of the range the channel color goes from dim to full brightness
+    if(index < PHOSPHOR_WHITE_START)
+    {
+      level = PHOSPHOR_MIN_LEVEL + (((255 - PHOSPHOR_MIN_LEVEL) * index) / PHOSPHOR_WHITE_START);
+
+      r = (red * level) / 255;
+      g = (green * level) / 255;
+      b = (blue * level) / 255;
+    }
+    else
+    {
+      //For the most hit pixels the channel color blends towards white
+      level = ((index - PHOSPHOR_WHITE_START) * 255) / (255 - PHOSPHOR_WHITE_START);
+
+      r = red + (((255 - red) * level) / 255);
+      g = green + (((255 - green) * level) / 255);
+      b = blue + (((255 - blue) * level) / 255);
+    }
+
+    //Convert to the RGB565 format of the display buffers
+    palette[index] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
   }
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
-int32 scope_get_x_sample(PCHANNELSETTINGS settings, int32 index)
+void scope_clear_phosphor(void)
 {
-  register int32 sample;
+  //Remove all the hits for both channels
+  memset(channel1phosphor, 0, sizeof(channel1phosphor));
+  memset(channel2phosphor, 0, sizeof(channel2phosphor));
+  memset(mathphosphor, 0, sizeof(mathphosphor));
 
-  //Center adjust the sample
-  sample = (int32)settings->tracebuffer[index] - 128;
+  //Make sure the current capture is added on the next display
+  phosphorupdate = 1;
+}
 
-  //Get the sample and adjust the data for the correct voltage per div setting
-  sample = (sample * signal_adjusters[settings->samplevoltperdiv]) >> VOLTAGE_SHIFTER;
+//----------------------------------------------------------------------------------------------------------------------------------
 
-  //Scale the sample based on the two volt per div settings when they differ
-  if(settings->displayvoltperdiv != settings->samplevoltperdiv)
+void scope_display_phosphor(void)
+{
+  //Only add to the hit counts when there is a new capture, otherwise the display would fill up while stopped
+  if(phosphorupdate)
   {
-    //Scaling factor is based on the two volts per division settings
-    sample = (sample * vertical_scaling_factors[settings->displayvoltperdiv][settings->samplevoltperdiv]) / SAMPLE_DIVIDER;
+    phosphorupdate = 0;
+
+    //Check if channel1 is enabled
+    if(scopesettings.channel1.enable)
+    {
+      //Let the older captures fade out when not in infinite persistence
+      if(scopesettings.persistencemode == PERSISTENCE_MODE_PHOSPHOR)
+      {
+        scope_decay_phosphor(&scopesettings.channel1);
+      }
+
+      //Add the current trace to it
+      scope_accumulate_phosphor(&scopesettings.channel1);
+    }
+
+    //Check if channel2 is enabled
+    if(scopesettings.channel2.enable)
+    {
+      //Let the older captures fade out when not in infinite persistence
+      if(scopesettings.persistencemode == PERSISTENCE_MODE_PHOSPHOR)
+      {
+        scope_decay_phosphor(&scopesettings.channel2);
+      }
+
+      //Add the current trace to it
+      scope_accumulate_phosphor(&scopesettings.channel2);
+    }
+
+    //Check if the math trace is enabled
+    if(mathchannel.enable)
+    {
+      //Let the older captures fade out when not in infinite persistence
+      if(scopesettings.persistencemode == PERSISTENCE_MODE_PHOSPHOR)
+      {
+        scope_decay_phosphor(&mathchannel);
+      }
+
+      //Add the current trace to it
+      scope_accumulate_phosphor(&mathchannel);
+    }
   }
-  
-  //Offset the sample on the screen
-  sample = settings->traceposition + sample;
 
-  //Limit sample on min displayable
-  if(sample < 0)
+  //Draw the hit counts of the enabled channels on top of the grid
+  if(scopesettings.channel1.enable)
   {
-    sample = 0;
+    scope_draw_phosphor(&scopesettings.channel1);
   }
 
-  //Limit the sample on max displayable
-  if(sample > TRACE_WINDOW_BORDER_HEIGHT)
+  if(scopesettings.channel2.enable)
   {
-    sample = TRACE_WINDOW_BORDER_HEIGHT;
+    scope_draw_phosphor(&scopesettings.channel2);
   }
 
-  //The x center position has an extra offset compared to the y trace position
-  return(sample + TRACE_CHANNEL_XY_OFFSET);
+  if(mathchannel.enable)
+  {
+    scope_draw_phosphor(&mathchannel);
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
-int32 scope_get_y_sample(PCHANNELSETTINGS settings, int32 index)
+void scope_decay_phosphor(PCHANNELSETTINGS settings)
 {
-  register int32 sample;
+  register uint32 *ptr = (uint32 *)settings->phosphor;
+  register uint32 *end = ptr + UINT32_PHOSPHOR_BUFFER_SIZE;
+  register uint32  data;
 
-  //Center adjust the sample
-  sample = (int32)settings->tracebuffer[index] - 128;
-
-  //Get the sample and adjust the data for the correct voltage per div setting
-  sample = (sample * signal_adjusters[settings->samplevoltperdiv]) >> VOLTAGE_SHIFTER;
-
-  //Scale the sample based on the two volt per div settings when they differ
-  if(settings->displayvoltperdiv != settings->samplevoltperdiv)
+  //Handle four pixels per word. Every pixel looses 1/8 of its intensity rounded up so it always reaches zero in the end
+  //The rounding up is done by adding one when any of the lower three bits are set. This can't carry over into the next pixel
+  for(;ptr<end;ptr++)
   {
-    //Scaling factor is based on the two volts per division settings
-    sample = (sample * vertical_scaling_factors[settings->displayvoltperdiv][settings->samplevoltperdiv]) / SAMPLE_DIVIDER;
+    data = *ptr;
+
+    //Skip the empty parts of the trace window
+    if(data)
+    {
+      *ptr = data - (((data >> PHOSPHOR_DECAY_SHIFT) & 0x1F1F1F1F) + ((((data & 0x07070707) + 0x07070707) >> PHOSPHOR_DECAY_SHIFT) & 0x01010101));
+    }
   }
-  
-  //Offset the sample on the screen
-  sample = settings->traceposition + sample;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
 
-  //Limit sample on min displayable
-  if(sample < 0)
+void scope_accumulate_phosphor(PCHANNELSETTINGS settings)
+{
+  PDISPLAYPOINTS tracepoints = settings->tracepoints;
+  uint32 count = settings->noftracepoints;
+  int32  x1, y1, x2, y2;
+  int32  dx, dy;
+  int32  x, delta;
+  int32  ystart, yend;
+
+  //When the trace is decimated the spans already hold the range per column
+  if(settings->noftracespans)
   {
-    sample = 0;
+    PDISPLAYSPAN tracespans = settings->tracespans + disp_xstart;
+
+    for(x=disp_xstart,count=settings->noftracespans;count;x++,count--,tracespans++)
+    {
+      scope_accumulate_phosphor_span(settings->phosphor, x, tracespans->ymin, tracespans->ymax);
+    }
+
+    return;
   }
-  //Limit the sample on max displayable
-  else if(sample > TRACE_WINDOW_BORDER_HEIGHT)
+
+  //Need at least one point to draw
+  if(count == 0)
   {
-    sample = TRACE_WINDOW_BORDER_HEIGHT;
+    return;
   }
 
-  //Display y coordinates are inverted to signal orientation
-  return(TRACE_VERTICAL_END - sample);
-}
+  //Get the first point
+  x1 = tracepoints->x;
+  y1 = tracepoints->y;
+  tracepoints++;
 
-//----------------------------------------------------------------------------------------------------------------------------------
+  //Go through the lines between the trace points
+  while(--count)
+  {
+    x2 = tracepoints->x;
+    y2 = tracepoints->y;
+    tracepoints++;
 
-void scope_display_channel_trace(PCHANNELSETTINGS settings)
-{
-  double inputindex;
+    dx = x2 - x1;
+    dy = y2 - y1;
 
-  register int32 previousindex;
-  register int32 currentindex;
-  register int32 sample1 = 0;
-  register int32 sample2 = 0;
-  register uint32 lastx = disp_xstart;
-  register uint32 xpos = disp_xstart + 1;
+    //The points are always in increasing x order, so the line is drawn as one vertical span per column
+    //For the lines that cover multiple columns the vertical distance is spread over them
+    yend = y1;
 
-  register PDISPLAYPOINTS tracepoints = settings->tracepoints;
+    for(x=x1,delta=dy;x<x2;x++,delta+=dy)
+    {
+      ystart = yend;
+      yend = y1 + (delta / dx);
 
-  //Set the trace color for the current channel
-  display_set_fg_color(settings->color);
+      scope_accumulate_phosphor_span(settings->phosphor, x, ystart, yend);
+    }
 
-  //Get the processed sample
-  sample1 = scope_get_y_sample(settings, disp_first_sample);
+    x1 = x2;
+    y1 = y2;
+  }
 
-  //Store the first sample in the trace points buffer
-  tracepoints->x = lastx;
-  tracepoints->y = sample1;
-  tracepoints++;
+  //The column of the last point is not covered by a line yet
+  scope_accumulate_phosphor_span(settings->phosphor, x1, y1, y1);
+}
 
-  //Start with one tracepoint
-  settings->noftracepoints = 1;
+//----------------------------------------------------------------------------------------------------------------------------------
 
-  //Step to the next input index
-  inputindex = disp_first_sample + disp_sample_step;
+void scope_accumulate_phosphor_span(uint8 *buffer, int32 xpos, int32 ystart, int32 yend)
+{
+  register uint8  *ptr;
+  register uint32  data;
+  register int32   count;
 
-  //The previous index is the index of the first sample
-  previousindex = disp_first_sample;
+  //Skip the columns outside the trace window
+  if((xpos < TRACE_HORIZONTAL_START) || (xpos >= (TRACE_HORIZONTAL_START + TRACE_MAX_WIDTH)))
+  {
+    return;
+  }
 
-  //Process the sample data to screen data
-  for(; xpos < disp_xend; inputindex += disp_sample_step, xpos++)
+  //Make sure the span runs downwards
+  if(ystart > yend)
   {
-    //Get the current integer index into the sample buffer
-    currentindex = inputindex;
+    count = ystart;
+    ystart = yend;
+    yend = count;
+  }
 
-    //Check if linear approximation needs to be done. (Only when step < 1) pixels are skipped if so.
-    if(currentindex != previousindex)
-    {
-      //Set new previous index
-      previousindex = currentindex;
+  //Limit the span on the trace window
+  if(ystart < TRACE_VERTICAL_START)
+  {
+    ystart = TRACE_VERTICAL_START;
+  }
 
-      //Get the processed sample
-      sample2 = scope_get_y_sample(settings, currentindex);
+  if(yend >= (TRACE_VERTICAL_START + TRACE_MAX_HEIGHT))
+  {
+    yend = TRACE_VERTICAL_START + TRACE_MAX_HEIGHT - 1;
+  }
 
-      //Store the second sample in the screen buffer
-      tracepoints->x = xpos;
-      tracepoints->y = sample2;
-      tracepoints++;
+  //Point to the first pixel of the span
+  ptr = buffer + ((ystart - TRACE_VERTICAL_START) * PHOSPHOR_PITCH) + (xpos - TRACE_HORIZONTAL_START);
 
-      //One more tracepoint
-      settings->noftracepoints++;
+  //Add a hit to every pixel of the span and saturate on the maximum intensity
+  for(count=yend-ystart;count>=0;count--)
+  {
+    data = *ptr + PHOSPHOR_HIT_INCREMENT;
 
-      //Need to draw a line here
-      display_draw_line(lastx, sample1, xpos, sample2);
+    if(data > 255)
+    {
+      data = 255;
+    }
 
-      sample1 = sample2;
+    *ptr = data;
 
-      lastx = xpos;
-    }
+    ptr += PHOSPHOR_PITCH;
   }
+}
 
-  //When step less then 1 the last pixel needs to be interpolated between current sample and next sample.
-  if(disp_sample_step < 1.0)
-  {
-    //Calculate the scaler for the last y value based on the x distance from the last drawn position to the end of the screen
-    //divided by the x distance it takes to where the next position should be drawn (Number of x steps per sample)
-    double scaler =  ((double)TRACE_HORIZONTAL_MAX - lastx) / disp_xpos_per_sample;
+//----------------------------------------------------------------------------------------------------------------------------------
 
-    //Get the processed sample
-    sample2 = scope_get_y_sample(settings, inputindex);
+void scope_draw_phosphor(PCHANNELSETTINGS settings)
+{
+  register uint8  *src = settings->phosphor;
+  register uint16 *dst = tracebackbuffer + (TRACE_VERTICAL_START * SCREEN_WIDTH) + TRACE_HORIZONTAL_START;
+  register uint16 *palette = settings->phosphorpalette;
+  register uint32  x;
+  register uint32  y;
+  register uint32  data;
+
+  //Go through the hit counts row by row
+  for(y=0;y<TRACE_MAX_HEIGHT;y++)
+  {
+    //Check four pixels at once so the empty parts of the row are skipped quickly
+    for(x=0;x<PHOSPHOR_PITCH;x+=4)
+    {
+      if(*(uint32 *)&src[x])
+      {
+        //Only the pixels that have been hit are drawn so the grid stays visible in between
+        if((data = src[x]))
+        {
+          dst[x] = palette[data];
+        }
 
-    sample2 = sample1 + ((double)((double)sample2 - (double)sample1) / scaler);
+        if((data = src[x + 1]))
+        {
+          dst[x + 1] = palette[data];
+        }
 
-    //Store the last sample in the screen buffer
-    tracepoints->x = xpos;
-    tracepoints->y = sample2;
-    tracepoints++;
+        if((data = src[x + 2]))
+        {
+          dst[x + 2] = palette[data];
+        }
 
-    //One more tracepoint
-    settings->noftracepoints++;
+        if((data = src[x + 3]))
+        {
+          dst[x + 3] = palette[data];
+        }
+      }
+    }
 
-    //Draw the last line
-    display_draw_line(lastx, sample1, xpos, sample2);
+    //Point to the next row of both the hit counts and the screen
+    src += PHOSPHOR_PITCH;
+    dst += SCREEN_WIDTH;
   }
 }
 
@@ -1249,8 +3563,19 @@ void scope_load_configuration_data(void)
   scopesettings.channel1.infoypos         = 6;
   
   //Set the trace and display buffer pointers for channel 1
-  scopesettings.channel1.tracebuffer  = (uint8 *)channel1tracebuffer;
+  scopesettings.channel1.tracebuffer = (uint8 *)channel1tracebuffer;
+  scopesettings.channel1.longrecord  = (uint8 *)channel1longrecord;
   scopesettings.channel1.tracepoints = channel1pointsbuffer;
+  scopesettings.channel1.tracespans  = channel1spansbuffer;
+  scopesettings.channel1.spectrum    = channel1spectrumbuffer;
+
+  //Set the screen coordinate lookup tables for channel 1. Built on first use
+  scopesettings.channel1.xlookup        = channel1xlookup;
+  scopesettings.channel1.ylookup        = channel1ylookup;
+  scopesettings.channel1.lookupsettings = SCREEN_LOOKUP_INVALID;
+
+  //Set the ADC compensation lookup tables for channel 1. Built on first use
+  scopesettings.channel1.compensationtables = &channel1compensationtables;
 
   //Set the FPGA commands for channel 2
   scopesettings.channel2.enablecommand     = 0x03;
@@ -1270,7 +3595,54 @@ void scope_load_configuration_data(void)
 
   //Set the trace and display buffer pointers for channel 2
   scopesettings.channel2.tracebuffer = (uint8 *)channel2tracebuffer;
+  scopesettings.channel2.longrecord  = (uint8 *)channel2longrecord;
   scopesettings.channel2.tracepoints = channel2pointsbuffer;
+  scopesettings.channel2.tracespans  = channel2spansbuffer;
+  scopesettings.channel2.spectrum    = channel2spectrumbuffer;
+
+  //Set the screen coordinate lookup tables for channel 2. Built on first use
+  scopesettings.channel2.xlookup        = channel2xlookup;
+  scopesettings.channel2.ylookup        = channel2ylookup;
+  scopesettings.channel2.lookupsettings = SCREEN_LOOKUP_INVALID;
+
+  //Set the ADC compensation lookup tables for channel 2. Built on first use
+  scopesettings.channel2.compensationtables = &channel2compensationtables;
+
+  //Set the persistence display buffers and build the palettes for the channel colors
+  scopesettings.channel1.phosphor        = (uint8 *)channel1phosphor;
+  scopesettings.channel1.phosphorpalette = channel1phosphorpalette;
+  scopesettings.channel2.phosphor        = (uint8 *)channel2phosphor;
+  scopesettings.channel2.phosphorpalette = channel2phosphorpalette;
+
+  //Set the buffers for the averaging and high resolution acquisition modes
+  scopesettings.channel1.averagebuffer   = channel1averagebuffer;
+  scopesettings.channel1.processedbuffer = (uint8 *)channel1processedbuffer;
+  scopesettings.channel2.averagebuffer   = channel2averagebuffer;
+  scopesettings.channel2.processedbuffer = (uint8 *)channel2processedbuffer;
+
+  //Set the display data for the math trace. The rest of its settings follow channel 1 when it is computed
+  mathchannel.color           = MATH_COLOR;
+  mathchannel.boxdata         = &math_box;
+  mathchannel.boxtext         = &math_box_text;
+  mathchannel.tracebuffer     = (uint8 *)mathtracebuffer;
+  mathchannel.longrecord      = (uint8 *)mathlongrecord;
+  mathchannel.tracepoints     = mathpointsbuffer;
+  mathchannel.tracespans      = mathspansbuffer;
+  mathchannel.xlookup         = mathxlookup;
+  mathchannel.ylookup         = mathylookup;
+  mathchannel.lookupsettings  = SCREEN_LOOKUP_INVALID;
+  mathchannel.phosphor        = (uint8 *)mathphosphor;
+  mathchannel.phosphorpalette = mathphosphorpalette;
+
+  //All the measurements of the math trace come from combining the channels, so there is nothing to compute on request
+  mathchannel.measurementinputs = MEASUREMENT_INPUTS_ALL;
+
+  scope_build_phosphor_palette(&scopesettings.channel1);
+  scope_build_phosphor_palette(&scopesettings.channel2);
+  scope_build_phosphor_palette(&mathchannel);
+
+  //Start with an empty persistence display
+  scope_clear_phosphor();
   
   //Set the trigger on the channel flag in the active channel for locking it on position movement
   scopesettings.channel1.triggeronchannel = 1 ^ scopesettings.triggerchannel;
@@ -1384,6 +3756,24 @@ void scope_reset_config_data(void)
   scopesettings.alwaystrigger50  = 0;
   scopesettings.tracedisplaymode = DISPLAY_MODE_NORMAL;
   scopesettings.confirmationmode = 1;
+
+  //Long record mode is off by default
+  scopesettings.longrecordenable = 0;
+
+  //Normal vector trace displaying
+  scopesettings.persistencemode = PERSISTENCE_MODE_OFF;
+
+  //No timing overlay or logging
+  scopesettings.timingmode = TIMING_MODE_OFF;
+
+  //Raw samples without averaging
+  scopesettings.acquisitionmode = ACQUISITION_MODE_NORMAL;
+
+  //No math trace
+  scopesettings.mathmode = MATH_MODE_OFF;
+
+  //Plain edge triggering
+  scopesettings.triggerqualifier = TRIGGER_QUALIFIER_OFF;
   
   //Set default channel calibration values
   for(index=0;index<7;index++)
@@ -1455,6 +3845,12 @@ void scope_save_config_data(void)
   *ptr++ = scopesettings.gridbrightness;
   *ptr++ = scopesettings.alwaystrigger50;
   *ptr++ = scopesettings.tracedisplaymode;
+  *ptr++ = scopesettings.longrecordenable;
+  *ptr++ = scopesettings.persistencemode;
+  *ptr++ = scopesettings.timingmode;
+  *ptr++ = scopesettings.acquisitionmode;
+  *ptr++ = scopesettings.mathmode;
+  *ptr++ = scopesettings.triggerqualifier;
 
   //Point to the cursor settings
   ptr = &settingsworkbuffer[CURSOR_SETTING_OFFSET];
@@ -1587,6 +3983,44 @@ void scope_restore_config_data(void)
     scopesettings.gridbrightness   = *ptr++;
     scopesettings.alwaystrigger50  = *ptr++;
     scopesettings.tracedisplaymode = *ptr++;
+    scopesettings.longrecordenable = *ptr++;
+    scopesettings.persistencemode  = *ptr++;
+    scopesettings.timingmode       = *ptr++;
+    scopesettings.acquisitionmode  = *ptr++;
+    scopesettings.mathmode         = *ptr++;
+    scopesettings.triggerqualifier = *ptr++;
+
+    //Settings written by a firmware without these modes have other data in their place, and they are used as table indexes, so
+    //fall back on the defaults when they are out of range
+    if(scopesettings.longrecordenable > 1)
+    {
+      scopesettings.longrecordenable = 0;
+    }
+
+    if(scopesettings.persistencemode >= PERSISTENCE_MODES)
+    {
+      scopesettings.persistencemode = PERSISTENCE_MODE_OFF;
+    }
+
+    if(scopesettings.timingmode >= TIMING_MODES)
+    {
+      scopesettings.timingmode = TIMING_MODE_OFF;
+    }
+
+    if(scopesettings.acquisitionmode >= ACQUISITION_MODES)
+    {
+      scopesettings.acquisitionmode = ACQUISITION_MODE_NORMAL;
+    }
+
+    if(scopesettings.mathmode >= MATH_MODES)
+    {
+      scopesettings.mathmode = MATH_MODE_OFF;
+    }
+
+    if(scopesettings.triggerqualifier >= TRIGGER_QUALIFIERS)
+    {
+      scopesettings.triggerqualifier = TRIGGER_QUALIFIER_OFF;
+    }
     
     //Point to the cursor settings
     ptr = &settingsworkbuffer[CURSOR_SETTING_OFFSET];
@@ -1619,14 +4053,7 @@ void scope_restore_config_data(void)
       scopesettings.measurementitems[index].index   = *ptr++;
       
       //Set the pointer to the actual channel data based on the selected channel
-      if(scopesettings.measurementitems[index].channel == 0)
-      {
-        scopesettings.measurementitems[index].channelsettings = &scopesettings.channel1;
-      }
-      else
-      {
-        scopesettings.measurementitems[index].channelsettings = &scopesettings.channel2;
-      }
+      scopesettings.measurementitems[index].channelsettings = scope_get_measurement_channel(scopesettings.measurementitems[index].channel);
     }
     
     //Point to the calibration settings
@@ -14,7 +14,42 @@
 
 void scope_acquire_trace_data(void);
 
+void scope_arm_acquisition(void);
+void scope_abort_acquisition(void);
+
+void scope_next_history_segment(void);
+void scope_previous_history_segment(void);
+void scope_show_history_segment(int32 offset);
+
 void scope_process_trigger(uint32 count);
+int32 scope_find_trigger_edge(uint8 *buffer, int32 center);
+uint32 scope_flag_samples_at_or_above(uint32 word, uint32 level);
+void scope_set_trigger_point(int32 index, int32 sample1, int32 sample2, int32 level);
+
+uint32 scope_qualify_trigger(int32 center);
+void scope_build_search_index(void);
+void scope_select_search_event(int32 index);
+uint32 scope_scan_trigger_events(int32 center, uint32 collect);
+int32 scope_get_trigger_qualifier_limit(void);
+uint32 scope_trigger_qualifier_usable(void);
+int32 scope_get_screen_sample(PCHANNELSETTINGS settings, int32 ypos);
+
+void scope_high_res_filter(PCHANNELSETTINGS settings);
+void scope_average_captures(void);
+void scope_average_channel(PCHANNELSETTINGS settings, int32 offset, uint32 rescale, uint32 reset);
+void scope_restore_segment_samples(PCHANNELSETTINGS settings, uint8 *samples, uint32 segmentvalid, uint8 *previousbuffer, uint32 previousbits);
+void scope_select_segment_samples(PCHANNELSETTINGS settings, uint8 *samples, uint32 latest);
+
+void scope_compute_math_channel(void);
+void scope_combine_math_samples(uint8 *output, uint8 *input1, uint8 *input2, uint32 count, int32 ratio, int32 product);
+
+PCHANNELSETTINGS scope_get_measurement_channel(uint32 channel);
+
+void scope_update_measurement_statistics(void);
+void scope_reset_measurement_statistics(void);
+uint32 scope_get_measurement_value(uint32 index, PCHANNELSETTINGS settings, int32 *value);
+void scope_add_statistics_value(PMEASUREMENTSTATISTICS statistics, int32 value);
+uint32 scope_get_statistics_deviation(PMEASUREMENTSTATISTICS statistics);
 
 uint32 scope_do_baseline_calibration(void);
 uint32 scope_do_channel_calibration(void);
@@ -33,12 +68,42 @@ void scope_calculate_sample_range_properties(void);
 // Signal data display functions
 //----------------------------------------------------------------------------------------------------------------------------------
 
+uint32 scope_long_record_in_view(void);
+uint32 scope_get_display_sample_count(void);
+uint32 scope_get_trigger_span_start(uint32 span);
+
 void scope_display_trace_data(void);
 
+void scope_hide_trace_layers(void);
+void scope_merge_layer(uint16 *layer);
+
+void scope_display_history_info(void);
+void scope_display_acquisition_info(void);
+void scope_display_long_record_info(void);
+void scope_display_math_info(void);
+void scope_display_trigger_qualifier_info(void);
+void scope_display_search_info(void);
+
+void scope_check_screen_lookup(PCHANNELSETTINGS settings);
+void scope_invalidate_screen_lookup(PCHANNELSETTINGS settings);
+
 int32 scope_get_x_sample(PCHANNELSETTINGS settings, int32 index);
 int32 scope_get_y_sample(PCHANNELSETTINGS settings, int32 index);
 
 void scope_display_channel_trace(PCHANNELSETTINGS settings);
+void scope_display_channel_envelope(PCHANNELSETTINGS settings, uint8 *buffer);
+
+void scope_compute_channel_spectrum(PCHANNELSETTINGS settings);
+void scope_display_channel_spectrum(PCHANNELSETTINGS settings);
+
+void scope_build_phosphor_palette(PCHANNELSETTINGS settings);
+void scope_clear_phosphor(void);
+
+void scope_display_phosphor(void);
+void scope_decay_phosphor(PCHANNELSETTINGS settings);
+void scope_accumulate_phosphor(PCHANNELSETTINGS settings);
+void scope_accumulate_phosphor_span(uint8 *buffer, int32 xpos, int32 ystart, int32 yend);
+void scope_draw_phosphor(PCHANNELSETTINGS settings);
 
 //----------------------------------------------------------------------------------------------------------------------------------
 // Configuration data functions
@@ -67,6 +67,15 @@ void sm_handle_user_input(void)
     return;
   }
 
+  //Handling the input can move the cursors and pointers, so both overlay pages need to be redrawn
+  displayoverlayredraw = DISPLAY_PAGES;
+
+  //The change can also affect the traces
+  displaytraceupdate = 1;
+
+  //Captures taken with other settings can't be averaged with the next ones
+  averagereset = 1;
+
   //Check if the power off command is given
   if(toprocesscommand == UIC_BUTTON_OFF)
   {
@@ -121,6 +130,18 @@ void sm_handle_user_input(void)
   {
     switch(navigationstate)
     {
+      case NAV_NO_ACTION:
+        //Without cursors the navigation is used for the timing overlay and acquisition mode when running and for browsing the history and events when stopped
+        if(scopesettings.runstate == RUN_STATE_RUNNING)
+        {
+          sm_handle_timing_actions();
+        }
+        else
+        {
+          sm_handle_history_browsing();
+        }
+        break;
+
       case NAV_TIME_VOLT_CURSOR_HANDLING:
         sm_handle_time_volt_cursor();
         break;
@@ -180,6 +201,14 @@ void sm_handle_user_input(void)
         //When in a menu state only the navigation keys and rotary dial have dedicated actions. All the others close the menu and return to normal operation
         sm_close_menu();
         break;
+
+      case FILE_VIEW_NO_ACTION:
+        //In normal scope operation the select button switches the long record mode
+        if((toprocesscommand == UIC_BUTTON_SELECT) && (buttondialstate == BUTTON_DIAL_NORMAL_HANDLING))
+        {
+          sm_toggle_long_record();
+        }
+        break;
     }
   }
   //Else it is a basic button or dial so handle the button and dial state
@@ -218,6 +247,9 @@ void sm_handle_user_input(void)
     }
   }
   
+  //Settings might have changed so the FPGA needs to be armed again for the next capture
+  scope_abort_acquisition();
+  
   //Signal the active command has been processed
   toprocesscommand = 0;
 }
@@ -341,6 +373,98 @@ void sm_handle_time_volt_cursor(void)
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
+void sm_handle_history_browsing(void)
+{
+  //The select knob steps through the events in the displayed capture, also for a loaded waveform
+  if(toprocesscommand == UIC_ROTARY_SEL_ADD)
+  {
+    scope_select_search_event(searchcurrent + 1);
+    return;
+  }
+  else if(toprocesscommand == UIC_ROTARY_SEL_SUB)
+  {
+    scope_select_search_event(searchcurrent - 1);
+    return;
+  }
+
+  //The history can only be browsed when showing the live traces
+  if(scopesettings.waveviewmode)
+  {
+    return;
+  }
+
+  switch(toprocesscommand)
+  {
+    case UIC_BUTTON_NAV_OK:
+    case UIC_BUTTON_NAV_DOWN:
+      //Go back to the latest capture
+      scope_show_history_segment(0);
+      break;
+
+    case UIC_BUTTON_NAV_UP:
+      //Go to the oldest capture
+      scope_show_history_segment(HISTORY_SEGMENTS);
+      break;
+
+    default:
+      //Left and right step through the segments. Pressing right goes to newer captures
+      scope_show_history_segment((int32)historyviewoffset - speedvalue);
+      break;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void sm_handle_timing_actions(void)
+{
+  switch(toprocesscommand)
+  {
+    case UIC_BUTTON_NAV_OK:
+      //The ok button steps through the timing overlay and logging modes
+      scopesettings.timingmode++;
+      scopesettings.timingmode %= TIMING_MODES;
+      break;
+
+    case UIC_BUTTON_NAV_UP:
+      //Up and down step through the acquisition modes
+      scopesettings.acquisitionmode++;
+      scopesettings.acquisitionmode %= ACQUISITION_MODES;
+      break;
+
+    case UIC_BUTTON_NAV_DOWN:
+      scopesettings.acquisitionmode += ACQUISITION_MODES - 1;
+      scopesettings.acquisitionmode %= ACQUISITION_MODES;
+      break;
+
+    case UIC_BUTTON_NAV_RIGHT:
+      //Right and left step through the math trace modes
+      scopesettings.mathmode++;
+      scopesettings.mathmode %= MATH_MODES;
+      break;
+
+    case UIC_BUTTON_NAV_LEFT:
+      scopesettings.mathmode += MATH_MODES - 1;
+      scopesettings.mathmode %= MATH_MODES;
+      break;
+
+    case UIC_ROTARY_SEL_ADD:
+      //The select knob steps through the trigger qualifiers
+      scopesettings.triggerqualifier++;
+      scopesettings.triggerqualifier %= TRIGGER_QUALIFIERS;
+      break;
+
+    case UIC_ROTARY_SEL_SUB:
+      scopesettings.triggerqualifier += TRIGGER_QUALIFIERS - 1;
+      scopesettings.triggerqualifier %= TRIGGER_QUALIFIERS;
+      break;
+  }
+
+  //The events listed for the capture depend on the qualifier
+  scope_build_search_index();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
 void sm_handle_main_menu_actions(void)
 {
   //With the navigation actions the menu list can be traversed and the active option can be started
@@ -510,8 +634,13 @@ void sm_handle_measurements_menu_actions(void)
 
     case UIC_BUTTON_NAV_LEFT:
     case UIC_BUTTON_NAV_RIGHT:
-      //On left or right button the channel needs to be changed, so a toggle works for two channels
-      scopesettings.measurementitems[measurementslot].channel ^= 1;
+      //On left or right button the channel needs to be changed. With the math trace on it is included after the two channels
+      scopesettings.measurementitems[measurementslot].channel++;
+
+      if(scopesettings.measurementitems[measurementslot].channel > ((scopesettings.mathmode != MATH_MODE_OFF) ? MATH_MEASUREMENT_CHANNEL : 1))
+      {
+        scopesettings.measurementitems[measurementslot].channel = 0;
+      }
       
       //Signal settings changed
       changed = 1;
@@ -530,16 +659,22 @@ void sm_handle_measurements_menu_actions(void)
         //Flip through to the end of the list based on the number of items there are
         index = (sizeof(measurement_names) / sizeof(uint8 *)) - 1;
         
-        //Need to select the other channel for this
-        scopesettings.measurementitems[measurementslot].channel ^= 1;
+        //Need to select the other channel for this. The math trace has no other channel
+        if(scopesettings.measurementitems[measurementslot].channel != MATH_MEASUREMENT_CHANNEL)
+        {
+          scopesettings.measurementitems[measurementslot].channel ^= 1;
+        }
       }
       else if(index >= (sizeof(measurement_names) / sizeof(uint8 *)))
       {
         //When beyond the end of the list flip back to the first one
         index = 0;
         
-        //Need to select the other channel for this
-        scopesettings.measurementitems[measurementslot].channel ^= 1;
+        //Need to select the other channel for this. The math trace has no other channel
+        if(scopesettings.measurementitems[measurementslot].channel != MATH_MEASUREMENT_CHANNEL)
+        {
+          scopesettings.measurementitems[measurementslot].channel ^= 1;
+        }
       }
       
       //Write the new index back to the selected slot
@@ -554,14 +689,7 @@ void sm_handle_measurements_menu_actions(void)
   if(changed)
   {
     //Set the channel settings to match the possible changed channel
-    if(scopesettings.measurementitems[measurementslot].channel == 0)
-    {
-      scopesettings.measurementitems[measurementslot].channelsettings = &scopesettings.channel1;
-    }
-    else
-    {
-      scopesettings.measurementitems[measurementslot].channelsettings = &scopesettings.channel2;
-    }
+    scopesettings.measurementitems[measurementslot].channelsettings = scope_get_measurement_channel(scopesettings.measurementitems[measurementslot].channel);
       
     //Show the change in setting
     ui_display_measurements_menu();
@@ -758,6 +886,9 @@ void sm_button_dial_normal_handling(void)
       enablesampling = SAMPLING_NOT_ENABLED;
       enabletracedisplay = TRACE_DISPLAY_NOT_ENABLED;
 
+      //Merge the trace and overlay layers into the main display buffer so the user interface can be drawn on top of them
+      scope_hide_trace_layers();
+
       //Display the main menu on the screen
       ui_display_main_menu();
       break;
@@ -870,6 +1001,12 @@ void sm_button_dial_normal_handling(void)
       break;
 
     case UIC_BUTTON_GEN:
+      //Step through the persistence display modes
+      scopesettings.persistencemode++;
+      scopesettings.persistencemode %= PERSISTENCE_MODES;
+
+      //Start the new mode with an empty persistence display
+      scope_clear_phosphor();
       break;
       
     case UIC_ROTARY_CH1_POS_ADD:
@@ -907,6 +1044,13 @@ void sm_button_dial_normal_handling(void)
       sm_set_time_base();
       break;
   }
+
+  //The persistence display no longer matches when the channels, scales or positions have changed
+  if((toprocesscommand >= UIC_ROTARY_CH1_POS_SUB) || (toprocesscommand == UIC_BUTTON_AUTO) || (toprocesscommand == UIC_BUTTON_TRIG_ORIG) ||
+     (toprocesscommand == UIC_BUTTON_CH1_ENABLE) || (toprocesscommand == UIC_BUTTON_CH2_ENABLE) || (toprocesscommand == UIC_BUTTON_TRIG_CHX))
+  {
+    scope_clear_phosphor();
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -953,6 +1097,9 @@ void sm_button_dial_wave_view_handling(void)
       //Disable the trace displaying
       enabletracedisplay = TRACE_DISPLAY_NOT_ENABLED;
 
+      //Merge the trace and overlay layers into the main display buffer so the user interface can be drawn on top of them
+      scope_hide_trace_layers();
+
       //Display the thumbnail page with the current view item selected
       ui_display_thumbnails();
       break;
@@ -1049,6 +1196,24 @@ void sm_button_dial_measurements_menu_handling(void)
     case UIC_BUTTON_F6:
       sm_open_measurements_menu(5);
       break;
+
+    case UIC_BUTTON_SAVE_PICTURE:
+      //Show or hide the statistics of the measurement slots and return to the traces to see them
+      statisticsdisplay ^= 1;
+      sm_close_menu();
+      break;
+
+    case UIC_BUTTON_SAVE_WAVE:
+      //Add the statistics table to the file on the SD card
+      ui_save_measurement_statistics();
+      sm_close_menu();
+      break;
+
+    case UIC_BUTTON_AUTO:
+      //Start gathering the statistics over
+      scope_reset_measurement_statistics();
+      sm_close_menu();
+      break;
       
     default:
       //All other buttons close the menu
@@ -1153,6 +1318,10 @@ void sm_check_display_mode_change(void)
       scopesettings.channel1.traceposition = VERTICAL_POINTER_CENTER;
       scopesettings.channel2.traceposition = VERTICAL_POINTER_CENTER;
     }
+
+    //The trace positions changed so the screen coordinate lookup tables need to be rebuild
+    scope_invalidate_screen_lookup(&scopesettings.channel1);
+    scope_invalidate_screen_lookup(&scopesettings.channel2);
     
     //Update channel position information
     ui_display_channel_position(&scopesettings.channel1);
@@ -1268,6 +1437,23 @@ void sm_switch_move_speed(void)
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
+void sm_toggle_long_record(void)
+{
+  scopesettings.longrecordenable ^= 1;
+
+  //The record is only displayed after it has been read for a new capture
+  longrecordvalid = 0;
+
+  //The number of displayable samples changes, so the range and the trigger position limits do too
+  scope_calculate_sample_range_properties();
+  ui_display_trigger_horizontal_position();
+
+  //The persistence display does not match the other range
+  scope_clear_phosphor();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
 void sm_set_trigger_position(void)
 {
   //Adjust the setting based on the given value
@@ -2290,6 +2476,9 @@ void sm_open_measurements_menu(uint32 slot)
     enablesampling = SAMPLING_NOT_ENABLED;
     enabletracedisplay = TRACE_DISPLAY_NOT_ENABLED;
 
+    //Merge the trace and overlay layers into the main display buffer so the user interface can be drawn on top of them
+    scope_hide_trace_layers();
+
     //Open the actual menu
     ui_display_measurements_menu();
   }
@@ -2316,6 +2505,9 @@ void sm_open_channel_menu(PCHANNELSETTINGS settings)
     enablesampling = SAMPLING_NOT_ENABLED;
     enabletracedisplay = TRACE_DISPLAY_NOT_ENABLED;
 
+    //Merge the trace and overlay layers into the main display buffer so the user interface can be drawn on top of them
+    scope_hide_trace_layers();
+
     //Start with the top line highlighted
     menuitem = 0;
 
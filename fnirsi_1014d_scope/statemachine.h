@@ -144,6 +144,8 @@ void sm_handle_user_input(void);
 //Act on user input on the navigation buttons (left, right, up, down, ok) and the selection rotary dial
 //----------------------------------------------------------------------------------------------------------------------------------
 
+void sm_handle_history_browsing(void);
+void sm_handle_timing_actions(void);
 void sm_handle_time_volt_cursor(void);
 void sm_handle_main_menu_actions(void);
 void sm_handle_file_view_actions(void);
@@ -189,6 +191,7 @@ void sm_toggle_time_cursor(void);
 void sm_toggle_volt_cursor(void);
 
 void sm_switch_move_speed(void);
+void sm_toggle_long_record(void);
 
 void sm_set_trigger_position(void);
 void sm_set_trigger_level(void);
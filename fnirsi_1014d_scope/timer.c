@@ -58,3 +58,98 @@ void timer0_delay(uint32 timeout)
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+
+void timer1_setup(void)
+{
+  //Let the timer count down from the maximum so it is free running over the full 32 bit range
+  *TMR1_INTV_VALUE_REG = 0xFFFFFFFF;
+
+  //Load the interval value in the counter and start it without interrupt
+  *TMR1_CTRL_REG = TMR_CLK_SRC_OSC24M | TMR_RELOAD | TMR_ENABLE;
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+uint32 timer1_get_ticks(void)
+{
+  //The timer counts down, so invert it to get an up counting value. Wraps around after almost three minutes
+  return(~*TMR1_CUR_VALUE_REG);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void timing_start(uint32 stage)
+{
+  //Remember when the stage started
+  stagetimings[stage].start = timer1_get_ticks();
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void timing_end(uint32 stage)
+{
+  PSTAGETIMING timing = &stagetimings[stage];
+
+  //The unsigned subtract takes care of the timer wrapping around
+  uint32 ticks = timer1_get_ticks() - timing->start;
+
+  //Start a new window with this measurement or add it to the current one
+  if(timing->count == 0)
+  {
+    timing->min = ticks;
+    timing->max = ticks;
+    timing->sum = ticks;
+  }
+  else
+  {
+    if(ticks < timing->min)
+    {
+      timing->min = ticks;
+    }
+
+    if(ticks > timing->max)
+    {
+      timing->max = ticks;
+    }
+
+    timing->sum += ticks;
+  }
+
+  timing->count++;
+
+  //When the window is complete publish the results in micro seconds. The sum is 64 bits wide, since a window of stages taking more
+  //than about 2.8 seconds each would overflow 32 bits
+  if(timing->count == TIMING_WINDOW)
+  {
+    timing->minimum = timing->min / TIMER1_TICKS_PER_US;
+    timing->average = (uint32)(timing->sum / (TIMING_WINDOW * TIMER1_TICKS_PER_US));
+    timing->maximum = timing->max / TIMER1_TICKS_PER_US;
+
+    timing->count = 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void timing_count_waveform(void)
+{
+  uint32 elapsed = timer0ticks - waveformtimestamp;
+
+  //One more capture done
+  waveformcount++;
+
+  //Determine the update rate once every second
+  if(elapsed >= 1000)
+  {
+    waveformspersecond = (waveformcount * 1000) / elapsed;
+
+    //Start a new second
+    waveformcount = 0;
+    waveformtimestamp = timer0ticks;
+
+    //New data for the log file
+    timinglogupdate = 1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
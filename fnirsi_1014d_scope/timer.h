@@ -54,6 +54,15 @@ uint32 timer0_get_ticks(void);
 
 void timer0_delay(uint32 timeout);
 
+void timer1_setup(void);
+
+uint32 timer1_get_ticks(void);
+
+void timing_start(uint32 stage);
+void timing_end(uint32 stage);
+
+void timing_count_waveform(void);
+
 //----------------------------------------------------------------------------------------------------------------------------------
 
 #endif /* TIMER_H */
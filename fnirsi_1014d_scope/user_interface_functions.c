@@ -51,7 +51,7 @@ void ui_setup_main_screen(void)
 
   //Fill in all the items on the screen
   ui_draw_outline();
-  ui_draw_grid();
+  ui_restore_grid();
   ui_display_logo();
   ui_display_run_stop_text();
   ui_display_trigger_settings();
@@ -149,6 +149,7 @@ void ui_close_view_screen(void)
 
   //Reset the screen to the normal scope screen
   ui_setup_main_screen();
+  displaytraceupdate = 1;
   scope_display_trace_data();
 
   //Back to normal mode so allow saving of settings on power down
@@ -404,7 +405,7 @@ void ui_display_run_stop_text(void)
   }
 
   //Display the text icon with infill of the background since the other text icon needs to be overwritten
-  display_copy_icon_use_colors(icon, 6, 33, 35, 13);
+  display_copy_icon_use_colors(icon, RUN_STOP_TEXT_XPOS, RUN_STOP_TEXT_YPOS, RUN_STOP_TEXT_WIDTH, RUN_STOP_TEXT_HEIGHT);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -430,7 +431,7 @@ void ui_display_waiting_triggered_text(uint32 state)
   }
 
   //Display the text icon with infill of the background since the other text icon needs to be overwritten
-  display_copy_icon_use_colors(icon, 652, 464, 54, 14);
+  display_copy_icon_use_colors(icon, TRIGGER_STATE_TEXT_XPOS, TRIGGER_STATE_TEXT_YPOS, TRIGGER_STATE_TEXT_WIDTH, TRIGGER_STATE_TEXT_HEIGHT);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -482,6 +483,31 @@ void ui_draw_grid(void)
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
+void ui_restore_grid(void)
+{
+  //The grid only depends on the brightness, so it is only rendered again when that changed
+  if(gridtemplatebrightness != scopesettings.gridbrightness)
+  {
+    //Draw the black background with the grid in the template instead of on the screen
+    display_save_screen_buffer();
+    display_set_screen_buffer(gridtemplate);
+
+    display_set_fg_color(COLOR_BLACK);
+    display_fill_rect(TRACE_HORIZONTAL_START, TRACE_VERTICAL_START, TRACE_MAX_WIDTH - 1, TRACE_MAX_HEIGHT - 1);
+    ui_draw_grid();
+
+    display_restore_screen_buffer();
+
+    gridtemplatebrightness = scopesettings.gridbrightness;
+  }
+
+  //Clear the trace window and draw the grid in it with a single copy of the template
+  display_set_source_buffer(gridtemplate);
+  display_copy_rect_to_screen(TRACE_HORIZONTAL_START, TRACE_VERTICAL_START, TRACE_MAX_WIDTH, TRACE_MAX_HEIGHT);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
 void ui_draw_pointers(void)
 {
   int32 position;
@@ -1221,6 +1247,25 @@ TEXTDATA channel_2_box_text =
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
+SHADEDRECTDATA math_box =
+{
+  20,
+  14,
+  { COLOR_MAGENTA, 0x00880088, 0x00440044 },
+  0x00220022
+};
+
+TEXTDATA math_box_text =
+{
+  6,
+  0,
+  COLOR_WHITE,
+  &font_1,
+  "M"
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
 void ui_display_channel_settings(PCHANNELSETTINGS settings)
 {
   PSHADEDRECTDATA boxdata;
@@ -1472,6 +1517,9 @@ void ui_display_measurements(void)
     //Set the y position for the measurement
     y += 21;
 
+    //Only the inputs of the shown measurement are computed, once per capture
+    fpga_compute_measurement_inputs(settings, measurement_inputs[scopesettings.measurementitems[i].index]);
+
     //Call the set function for displaying the actual value and
     //pass the information for this measurement to the function for displaying it
     measurement_functions[scopesettings.measurementitems[i].index](y, settings);
@@ -1497,6 +1545,9 @@ void ui_update_measurements(void)
     //Setup the base position
     y = MEASUREMENT_INFO_Y + (i * MEASUREMENT_Y_DISPLACEMENT) + 21;
 
+    //Only the inputs of the shown measurement are computed, once per capture
+    fpga_compute_measurement_inputs(settings, measurement_inputs[scopesettings.measurementitems[i].index]);
+
     //Clear the display field first
     display_set_fg_color(COLOR_BLACK);
     display_fill_rect(MEASUREMENT_VALUE_X - 2, y - 2, 83, 20);
@@ -1506,76 +1557,79 @@ void ui_update_measurements(void)
     measurement_functions[scopesettings.measurementitems[i].index](y, settings);
 
     //Copy this item to the main screen
+    display_set_source_buffer(displaybuffer1);
     display_set_screen_buffer((uint16 *)maindisplaybuffer);
     display_copy_rect_to_screen(MEASUREMENT_VALUE_X - 2, y - 2, 83, 20);
   }
-
-  //Switch back to the separate display buffer to allow further actions on the trace display
-  display_set_screen_buffer(displaybuffer1);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_display_vmax(uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //show sign either positive or negative on x location 719 followed by the value, but only when the value
   //is above 99. If less the value starts 13 pixels to the right
 
   //For the maximum take of the center ADC value
-  ui_display_voltage(ypos, settings, settings->max - 128, 1);
+  scope_get_measurement_value(0, settings, &value);
+  ui_display_voltage(ypos, settings, value, 1);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_display_vmin(uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //For the minimum take of the center ADC value
-  ui_display_voltage(ypos, settings, settings->min - 128, 1);
+  scope_get_measurement_value(1, settings, &value);
+  ui_display_voltage(ypos, settings, value, 1);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_display_vavg(uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //For the average take of the center ADC value
-  ui_display_voltage(ypos, settings, settings->average - 128, 1);
+  scope_get_measurement_value(2, settings, &value);
+  ui_display_voltage(ypos, settings, value, 1);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_display_vrms(uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //The rms has already been centered during the summation so use it as is
-  ui_display_voltage(ypos, settings, settings->rms, 0);
+  scope_get_measurement_value(3, settings, &value);
+  ui_display_voltage(ypos, settings, value, 0);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_display_vpp(uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //For the peak peak just use the value as is
-  ui_display_voltage(ypos, settings, settings->peakpeak, 0);
+  scope_get_measurement_value(4, settings, &value);
+  ui_display_voltage(ypos, settings, value, 0);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_display_vp(uint32 ypos, PCHANNELSETTINGS settings)
 {
-  //Determine the two absolute extremes
-  int32 min = 128 - settings->min;
-  int32 max = settings->max - 128;
+  int32 value;
 
-  //Display the biggest of the two
-  if(min > max)
-  {
-    //Use the below the center value when it is the biggest
-    ui_display_voltage(ypos, settings, min, 0);
-  }
-  else
-  {
-    //Use the above the center value when it is the biggest
-    ui_display_voltage(ypos, settings, max, 0);
-  }
+  //The biggest of the two absolute extremes
+  scope_get_measurement_value(5, settings, &value);
+  ui_display_voltage(ypos, settings, value, 0);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -1685,6 +1739,7 @@ void ui_display_duty_cycle(uint32 ypos, PCHANNELSETTINGS settings, uint32 value)
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+//The value is in ADC steps with STATISTICS_FRACTION_BITS fraction bits, as given by scope_get_measurement_value
 
 void ui_display_voltage(uint32 ypos, PCHANNELSETTINGS settings, int32 value, uint32 signedvalue)
 {
@@ -1694,8 +1749,8 @@ void ui_display_voltage(uint32 ypos, PCHANNELSETTINGS settings, int32 value, uin
   //Calculate the voltage based on the channel settings
   vcd = (PVOLTCALCDATA)&volt_calc_data[settings->magnification][settings->displayvoltperdiv];
 
-  //Adjust the data for the correct voltage per div setting
-  volts = (value * signal_adjusters[settings->samplevoltperdiv]) >> VOLTAGE_SHIFTER;
+  //Adjust the data for the correct voltage per div setting, with the fraction bits of the measurement value taken off
+  volts = ((int64)value * signal_adjusters[settings->samplevoltperdiv]) >> (VOLTAGE_SHIFTER + STATISTICS_FRACTION_BITS);
 
   //Scale the data based on the two volt per div settings when they differ
   //This is needed when the screen is frozen and zooming is applied
@@ -2592,7 +2647,11 @@ void ui_display_measurements_menu(void)
   y = 142 + (scopesettings.measurementitems[measurementslot].index * 25);
 
   //Draw the menu high lighter box for the selected item (Original code used three rectangles)
-  display_draw_highlight_rect(x, y, &measurement_menu_highlight_box);
+  //The math trace has no column in the menu, so it is only shown in the measurement slot itself
+  if(scopesettings.measurementitems[measurementslot].channel != MATH_MEASUREMENT_CHANNEL)
+  {
+    display_draw_highlight_rect(x, y, &measurement_menu_highlight_box);
+  }
 
   //Text is displayed in white
   display_set_fg_color(COLOR_WHITE);
@@ -2630,6 +2689,9 @@ void ui_display_measurements_menu_items(uint32 xpos, PCHANNELSETTINGS settings)
 {
   int i,x,y;
 
+  //The menu shows all the measurements of the channel
+  fpga_compute_measurement_inputs(settings, MEASUREMENT_INPUTS_ALL);
+
   //Text is displayed in white and labels are using a bigger font
   display_set_fg_color(COLOR_WHITE);
   display_set_font(&font_3);
@@ -2683,61 +2745,66 @@ void ui_display_measurements_menu_items(uint32 xpos, PCHANNELSETTINGS settings)
 
 void ui_msm_display_vmax(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //For the maximum take of the center ADC value
-  ui_msm_display_voltage(settings, settings->max - 128);
+  scope_get_measurement_value(0, settings, &value);
+  ui_msm_display_voltage(settings, value);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_msm_display_vmin(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //For the minimum take of the center ADC value
-  ui_msm_display_voltage(settings, settings->min - 128);
+  scope_get_measurement_value(1, settings, &value);
+  ui_msm_display_voltage(settings, value);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_msm_display_vavg(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //For the average take of the center ADC value
-  ui_msm_display_voltage(settings, settings->average - 128);
+  scope_get_measurement_value(2, settings, &value);
+  ui_msm_display_voltage(settings, value);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_msm_display_vrms(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings)
 {
- //The rms has already been centered during the summation so use it as is
-  ui_msm_display_voltage(settings, settings->rms);
+  int32 value;
+
+  //The rms has already been centered during the summation so use it as is
+  scope_get_measurement_value(3, settings, &value);
+  ui_msm_display_voltage(settings, value);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_msm_display_vpp(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings)
 {
+  int32 value;
+
   //For the peak peak just use the value as is
-  ui_msm_display_voltage(settings, settings->peakpeak);
+  scope_get_measurement_value(4, settings, &value);
+  ui_msm_display_voltage(settings, value);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_msm_display_vp(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings)
 {
-  //Determine the two absolute extremes
-  int32 min = 128 - settings->min;
-  int32 max = settings->max - 128;
+  int32 value;
 
-  //Display the biggest of the two
-  if(min > max)
-  {
-    //Use the below the center value when it is the biggest
-    ui_msm_display_voltage(settings, min);
-  }
-  else
-  {
-    //Use the above the center value when it is the biggest
-    ui_msm_display_voltage(settings, max);
-  }
+  //The biggest of the two absolute extremes
+  scope_get_measurement_value(5, settings, &value);
+  ui_msm_display_voltage(settings, value);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -2848,6 +2915,7 @@ void ui_msm_display_duty_min(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
+//The value is in ADC steps with STATISTICS_FRACTION_BITS fraction bits, as given by scope_get_measurement_value
 
 void ui_msm_display_voltage(PCHANNELSETTINGS settings, int32 value)
 {
@@ -2857,8 +2925,8 @@ void ui_msm_display_voltage(PCHANNELSETTINGS settings, int32 value)
   //Calculate the voltage based on the channel settings
   vcd = (PVOLTCALCDATA)&volt_calc_data[settings->magnification][settings->displayvoltperdiv];
 
-  //Adjust the data for the correct voltage per div setting
-  volts = (value * signal_adjusters[settings->samplevoltperdiv]) >> VOLTAGE_SHIFTER;
+  //Adjust the data for the correct voltage per div setting, with the fraction bits of the measurement value taken off
+  volts = ((int64)value * signal_adjusters[settings->samplevoltperdiv]) >> (VOLTAGE_SHIFTER + STATISTICS_FRACTION_BITS);
 
   //Scale the data based on the two volt per div settings when they differ
   //This is needed when the screen is frozen and zooming is applied
@@ -2877,7 +2945,7 @@ void ui_msm_display_voltage(PCHANNELSETTINGS settings, int32 value)
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
-void ui_msm_print_value(char *buffer, int32 value, uint32 scale, char *designator)
+char *ui_msm_print_value(char *buffer, int32 value, uint32 scale, char *designator)
 {
   uint32 negative = 0;
 
@@ -2928,8 +2996,8 @@ void ui_msm_print_value(char *buffer, int32 value, uint32 scale, char *designato
   //Add the magnitude scaler
   buffer = strcpy(buffer, magnitude_scaler[scale]);
 
-  //Add the type of measurement sign
-  strcpy(buffer, designator);
+  //Add the type of measurement sign and return the position of the terminator to allow appending
+  return(strcpy(buffer, designator));
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -2989,6 +3057,323 @@ char *ui_msm_print_decimal(char *buffer, int32 value, uint32 decimals, uint32 ne
   return(&buffer[s]);
 }
 
+//----------------------------------------------------------------------------------------------------------------------------------
+// Timing instrumentation display and logging functions
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_display_timing_overlay(void)
+{
+  char   buffer[12];
+  uint32 ypos = TIMING_TEXT_YPOS;
+  uint32 stage;
+
+  display_set_fg_color(COLOR_WHITE);
+  display_set_font(&font_2);
+
+  //Show the number of captures per second
+  display_text(TIMING_TEXT_XPOS, ypos, "wfm/s");
+  ui_msm_print_decimal(buffer, waveformspersecond, 0, 0);
+  display_text(TIMING_TEXT_XPOS + 100, ypos, buffer);
+
+  ypos += TIMING_TEXT_LINE_HEIGHT;
+
+  //Show the number of pixels written for the previous frame
+  display_text(TIMING_TEXT_XPOS, ypos, "pixels");
+  ui_msm_print_decimal(buffer, framepixelspushed, 0, 0);
+  display_text(TIMING_TEXT_XPOS + 100, ypos, buffer);
+
+  ypos += TIMING_TEXT_LINE_HEIGHT;
+
+  //Header for the stage timing columns
+  display_text(TIMING_TEXT_XPOS, ypos, "stage (us)");
+  display_text(TIMING_TEXT_XPOS + 100, ypos, "min");
+  display_text(TIMING_TEXT_XPOS + 150, ypos, "avg");
+  display_text(TIMING_TEXT_XPOS + 200, ypos, "max");
+
+  //Show the results of the last complete window for every stage
+  for(stage=0;stage<TIMING_STAGES;stage++)
+  {
+    ypos += TIMING_TEXT_LINE_HEIGHT;
+
+    display_text(TIMING_TEXT_XPOS, ypos, timing_stage_names[stage]);
+
+    ui_msm_print_decimal(buffer, stagetimings[stage].minimum, 0, 0);
+    display_text(TIMING_TEXT_XPOS + 100, ypos, buffer);
+
+    ui_msm_print_decimal(buffer, stagetimings[stage].average, 0, 0);
+    display_text(TIMING_TEXT_XPOS + 150, ypos, buffer);
+
+    ui_msm_print_decimal(buffer, stagetimings[stage].maximum, 0, 0);
+    display_text(TIMING_TEXT_XPOS + 200, ypos, buffer);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_log_timing_data(void)
+{
+  char   buffer[TIMING_LOG_LINE_SIZE];
+  char  *ptr;
+  uint32 stage;
+  int32  result;
+
+  //Data is handled, so wait for the next second
+  timinglogupdate = 0;
+
+  //Open the log file for adding a line to the end of it. Created when it does not exist yet
+  result = f_open(&viewfp, timing_log_file_name, FA_OPEN_APPEND | FA_WRITE);
+
+  //Nothing to do when the file can't be opened
+  if(result != FR_OK)
+  {
+    return;
+  }
+
+  //A new file needs the column names first
+  if(f_size(&viewfp) == 0)
+  {
+    ptr = strcpy(buffer, "time_ms,waveforms_per_second,pixels_per_frame");
+
+    for(stage=0;stage<TIMING_STAGES;stage++)
+    {
+      *ptr++ = ',';
+      ptr = strcpy(ptr, timing_stage_names[stage]);
+      ptr = strcpy(ptr, "_min_us,");
+      ptr = strcpy(ptr, timing_stage_names[stage]);
+      ptr = strcpy(ptr, "_avg_us,");
+      ptr = strcpy(ptr, timing_stage_names[stage]);
+      ptr = strcpy(ptr, "_max_us");
+
+      //Write the names per stage to keep the buffer small
+      result |= f_write(&viewfp, buffer, ptr - buffer, 0);
+
+      ptr = buffer;
+    }
+
+    ptr = strcpy(ptr, "\r\n");
+
+    result |= f_write(&viewfp, buffer, ptr - buffer, 0);
+  }
+
+  //Start the line with the time and the update rate
+  ptr = ui_msm_print_decimal(buffer, timer0ticks, 0, 0);
+  *ptr++ = ',';
+  ptr = ui_msm_print_decimal(ptr, waveformspersecond, 0, 0);
+  *ptr++ = ',';
+  ptr = ui_msm_print_decimal(ptr, framepixelspushed, 0, 0);
+
+  //Add the results of all the stages
+  for(stage=0;stage<TIMING_STAGES;stage++)
+  {
+    *ptr++ = ',';
+    ptr = ui_msm_print_decimal(ptr, stagetimings[stage].minimum, 0, 0);
+    *ptr++ = ',';
+    ptr = ui_msm_print_decimal(ptr, stagetimings[stage].average, 0, 0);
+    *ptr++ = ',';
+    ptr = ui_msm_print_decimal(ptr, stagetimings[stage].maximum, 0, 0);
+  }
+
+  ptr = strcpy(ptr, "\r\n");
+
+  result |= f_write(&viewfp, buffer, ptr - buffer, 0);
+
+  //Stop logging when the card can't be written so the display is not slowed down by retries
+  if(result != FR_OK)
+  {
+    scopesettings.timingmode = TIMING_MODE_OVERLAY;
+  }
+
+  f_close(&viewfp);
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+// Measurement statistics display and export functions
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_display_measurement_statistics(void)
+{
+  char   buffer[16];
+  uint32 ypos = STATISTICS_TEXT_YPOS;
+  uint32 slot;
+  uint32 item;
+
+  display_set_font(&font_2);
+
+  //Header for the statistics columns
+  display_set_fg_color(COLOR_WHITE);
+  display_text(STATISTICS_TEXT_XPOS, ypos, "measurement");
+  display_text(STATISTICS_TEXT_XPOS + 90, ypos, "mean");
+  display_text(STATISTICS_TEXT_XPOS + 160, ypos, "min");
+  display_text(STATISTICS_TEXT_XPOS + 230, ypos, "max");
+  display_text(STATISTICS_TEXT_XPOS + 300, ypos, "sdev");
+  display_text(STATISTICS_TEXT_XPOS + 370, ypos, "count");
+
+  for(slot=0;slot<(sizeof(scopesettings.measurementitems)/sizeof(MEASUREMENTINFO));slot++)
+  {
+    ypos += STATISTICS_TEXT_LINE_HEIGHT;
+
+    //The measurement name is shown in the color of its channel
+    display_set_fg_color(scopesettings.measurementitems[slot].channelsettings->color);
+    display_text(STATISTICS_TEXT_XPOS, ypos, (char *)measurement_names[scopesettings.measurementitems[slot].index]);
+
+    display_set_fg_color(COLOR_WHITE);
+
+    for(item=0;item<STATISTICS_ITEMS;item++)
+    {
+      ui_print_statistics_value(buffer, slot, item);
+      display_text(STATISTICS_TEXT_XPOS + 90 + (item * 70), ypos, buffer);
+    }
+
+    ui_msm_print_decimal(buffer, measurementstatistics[slot].count, 0, 0);
+    display_text(STATISTICS_TEXT_XPOS + 370, ypos, buffer);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_save_measurement_statistics(void)
+{
+  char   buffer[STATISTICS_LOG_LINE_SIZE];
+  char  *ptr;
+  uint32 slot;
+  uint32 item;
+  int32  result;
+
+  //Open the file for adding the table to the end of it. Created when it does not exist yet
+  result = f_open(&viewfp, statistics_file_name, FA_OPEN_APPEND | FA_WRITE);
+
+  //Nothing to do when the file can't be opened
+  if(result != FR_OK)
+  {
+    return;
+  }
+
+  //A new file needs the column names first
+  if(f_size(&viewfp) == 0)
+  {
+    ptr = strcpy(buffer, "time_ms,slot,channel,measurement,mean,min,max,sdev,count\r\n");
+
+    result |= f_write(&viewfp, buffer, ptr - buffer, 0);
+  }
+
+  //A line per slot with the time of the export to keep the tables apart
+  for(slot=0;slot<(sizeof(scopesettings.measurementitems)/sizeof(MEASUREMENTINFO));slot++)
+  {
+    ptr = ui_msm_print_decimal(buffer, timer0ticks, 0, 0);
+    *ptr++ = ',';
+    ptr = ui_msm_print_decimal(ptr, slot + 1, 0, 0);
+    *ptr++ = ',';
+    ptr = ui_msm_print_decimal(ptr, scopesettings.measurementitems[slot].channel + 1, 0, 0);
+    *ptr++ = ',';
+    ptr = strcpy(ptr, measurement_names[scopesettings.measurementitems[slot].index]);
+
+    for(item=0;item<STATISTICS_ITEMS;item++)
+    {
+      *ptr++ = ',';
+      ptr = ui_print_statistics_value(ptr, slot, item);
+    }
+
+    *ptr++ = ',';
+    ptr = ui_msm_print_decimal(ptr, measurementstatistics[slot].count, 0, 0);
+    ptr = strcpy(ptr, "\r\n");
+
+    result |= f_write(&viewfp, buffer, ptr - buffer, 0);
+  }
+
+  f_close(&viewfp);
+
+  //Let the user know the card could not be written
+  if(result != FR_OK)
+  {
+    ui_display_file_status_message(MESSAGE_FILE_CREATE_FAILED, 0);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Formats a statistics item of a slot with its unit in the same way as the measurements menu does. The frequency statistics are
+//gathered on the period time, so the minimum and maximum swap and the deviation is scaled with the frequency over the period
+
+char *ui_print_statistics_value(char *buffer, uint32 slot, uint32 item)
+{
+  PCHANNELSETTINGS       settings = scopesettings.measurementitems[slot].channelsettings;
+  PMEASUREMENTSTATISTICS statistics = &measurementstatistics[slot];
+  uint32        index = scopesettings.measurementitems[slot].index;
+  PVOLTCALCDATA vcd;
+  int64         value;
+  uint64        frequency;
+
+  //Nothing to show before the first valid value
+  if(statistics->count == 0)
+  {
+    return(strcpy(buffer, "-"));
+  }
+
+  switch(item)
+  {
+    case STATISTICS_MEAN:
+      value = statistics->mean;
+      break;
+
+    case STATISTICS_MINIMUM:
+      value = (index == 6) ? statistics->maximum : statistics->minimum;
+      break;
+
+    case STATISTICS_MAXIMUM:
+      value = (index == 6) ? statistics->minimum : statistics->maximum;
+      break;
+
+    default:
+      value = scope_get_statistics_deviation(statistics);
+      break;
+  }
+
+  if(index < 6)
+  {
+    //Calculate the voltage based on the channel settings, with the extra fraction bits taken off in the adjustment
+    vcd = (PVOLTCALCDATA)&volt_calc_data[settings->magnification][settings->displayvoltperdiv];
+
+    value = (value * signal_adjusters[settings->samplevoltperdiv]) >> (VOLTAGE_SHIFTER + STATISTICS_FRACTION_BITS);
+
+    //Scale the data based on the two volt per div settings when they differ
+    if(settings->displayvoltperdiv != settings->samplevoltperdiv)
+    {
+      value = (value * vertical_scaling_factors[settings->displayvoltperdiv][settings->samplevoltperdiv]) / 10000;
+    }
+
+    return(ui_msm_print_value(buffer, value * vcd->mul_factor, vcd->volt_scale, "V"));
+  }
+  else if(index == 6)
+  {
+    //The frequency of the mean period time is used as mean frequency
+    if((value <= 0) || (statistics->mean <= 0))
+    {
+      return(strcpy(buffer, "-"));
+    }
+
+    if(item == STATISTICS_DEVIATION)
+    {
+      frequency = ((uint64)freq_calc_data[scopesettings.samplerate].sample_rate << (20 - STATISTICS_TIME_SHIFT)) / statistics->mean;
+      frequency = (frequency * value) / statistics->mean;
+    }
+    else
+    {
+      frequency = ((uint64)freq_calc_data[scopesettings.samplerate].sample_rate << (20 - STATISTICS_TIME_SHIFT)) / value;
+    }
+
+    return(ui_msm_print_value(buffer, frequency, freq_calc_data[scopesettings.samplerate].freq_scale, "Hz"));
+  }
+  else if(index < 10)
+  {
+    //Times are in samples, which need the fraction of the time measurements for the conversion
+    return(ui_msm_print_value(buffer, (((uint64)value << STATISTICS_TIME_SHIFT) * time_calc_data[scopesettings.samplerate].mul_factor) >> 20, time_calc_data[scopesettings.samplerate].time_scale, "s"));
+  }
+
+  //Duty cycles are in 0.1%
+  buffer = ui_msm_print_decimal(buffer, value >> STATISTICS_FRACTION_BITS, 1, 0);
+
+  return(strcpy(buffer, "%"));
+}
+
 //----------------------------------------------------------------------------------------------------------------------------------
 // Picture and wave file handling and display functions
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -3031,6 +3416,10 @@ void ui_prepare_setup_for_file(void)
   //Leave space for file version and checksum data
   index = CHANNEL1_SETTING_OFFSET;
 
+  //The file holds all the measurements, so make sure they are computed for the samples
+  fpga_compute_measurement_inputs(&scopesettings.channel1, MEASUREMENT_INPUTS_ALL);
+  fpga_compute_measurement_inputs(&scopesettings.channel2, MEASUREMENT_INPUTS_ALL);
+
   //Copy the needed channel 1 settings and measurements
   ptr[index++] = scopesettings.channel1.enable;
   ptr[index++] = scopesettings.channel1.displayvoltperdiv;
@@ -3130,8 +3519,8 @@ void ui_prepare_setup_for_file(void)
   for(index=0;index<750;index++)
   {
     //Add both the channels
-    checksum += channel1tracebuffer[index];
-    checksum += channel2tracebuffer[index];
+    checksum += ((uint32 *)scopesettings.channel1.tracebuffer)[index];
+    checksum += ((uint32 *)scopesettings.channel2.tracebuffer)[index];
   }
 
   //Store the checksum at the beginning of the file
@@ -3190,6 +3579,14 @@ void ui_restore_setup_from_file(void)
   scopesettings.channel2.hightime          = ptr[index++];
   scopesettings.channel2.periodtime        = ptr[index++];
 
+  //The measurements come with the file, so none are computed for the loaded samples
+  scopesettings.channel1.measurementinputs = MEASUREMENT_INPUTS_ALL;
+  scopesettings.channel2.measurementinputs = MEASUREMENT_INPUTS_ALL;
+
+  //The loaded samples have no extra resolution
+  scopesettings.channel1.precisionbits = 0;
+  scopesettings.channel2.precisionbits = 0;
+
   //Leave some space for channel 2 settings changes
   index = TRIGGER_SETTING_OFFSET;
 
@@ -3204,6 +3601,12 @@ void ui_restore_setup_from_file(void)
   scopesettings.triggerverticalposition   = ptr[index++];
   disp_trigger_index                      = ptr[index++];
 
+  //Only the whole trigger index is stored with the waveform
+  disp_trigger_fraction = 0;
+
+  //Start on the trigger point of the loaded waveform
+  searchcurrent = -1;
+
   //Leave some space for trigger information changes
   index = OTHER_SETTING_OFFSET;
 
@@ -3269,8 +3672,8 @@ int32 ui_check_waveform_file(void)
   for(index=0;index<750;index++)
   {
     //Add both the channels
-    checksum += channel1tracebuffer[index];
-    checksum += channel2tracebuffer[index];
+    checksum += ((uint32 *)scopesettings.channel1.tracebuffer)[index];
+    checksum += ((uint32 *)scopesettings.channel2.tracebuffer)[index];
   }
 
   //Check if it matches the checksum in the file
@@ -3758,6 +4161,9 @@ void ui_save_view_item_file(int32 type)
       //Check if still ok to proceed
       if(result == FR_OK)
       {
+        //Merge the trace and overlay layers into the main display buffer so the picture shows what is on the screen
+        scope_hide_trace_layers();
+
         //Write the pixel data
         result = f_write(&viewfp, (uint8 *)maindisplaybuffer, PICTURE_DATA_SIZE, 0);
       }
@@ -3773,10 +4179,10 @@ void ui_save_view_item_file(int32 type)
       {
         //Write the trace data to the file
         //Save the channel 1 raw sample data
-        if((result = f_write(&viewfp, (uint8 *)channel1tracebuffer, 3000, 0)) == FR_OK)
+        if((result = f_write(&viewfp, scopesettings.channel1.tracebuffer, 3000, 0)) == FR_OK)
         {
           //Save the channel 2 raw sample data
-          result = f_write(&viewfp, (uint8 *)channel2tracebuffer, 3000, 0);
+          result = f_write(&viewfp, scopesettings.channel2.tracebuffer, 3000, 0);
         }
       }
     }
@@ -3887,10 +4293,10 @@ int32 ui_load_trace_data(void)
       else
       {
         //Load the channel 1 sample data
-        if((result = f_read(&viewfp, (uint8 *)channel1tracebuffer, 3000, 0)) == FR_OK)
+        if((result = f_read(&viewfp, scopesettings.channel1.tracebuffer, 3000, 0)) == FR_OK)
         {
           //Load the channel 2 sample data
-          if((result = f_read(&viewfp, (uint8 *)channel2tracebuffer, 3000, 0)) == FR_OK)
+          if((result = f_read(&viewfp, scopesettings.channel2.tracebuffer, 3000, 0)) == FR_OK)
           {
             //Do a check on file validity
             if((result = ui_check_waveform_file()) == 0)
@@ -3898,6 +4304,9 @@ int32 ui_load_trace_data(void)
               //Copy the loaded data to the settings
               ui_restore_setup_from_file();
 
+              //List the events of the loaded capture
+              scope_build_search_index();
+
               //Switch to stopped and waveform viewing mode
               scopesettings.runstate = RUN_STATE_STOPPED;
               scopesettings.waveviewmode = 1;
@@ -4619,13 +5028,17 @@ void ui_create_thumbnail(PTHUMBNAILDATA thumbnaildata)
   }
   else
   {
-    //Use less samples to not overwrite the second buffer
-    uint32 index = disp_trigger_index - 350;
+    //Use less samples to not overwrite the second buffer. The trigger can be anywhere in the buffer, so keep them within it
+    uint32 index = scope_get_trigger_span_start(700);
     uint32 last = index + 700;
 
     uint8 *buffer1 = thumbnaildata->channel1data;
     uint8 *buffer2 = thumbnaildata->channel2data;
 
+    //Make sure the screen coordinate lookup tables match the current settings
+    scope_check_screen_lookup(&scopesettings.channel1);
+    scope_check_screen_lookup(&scopesettings.channel2);
+
     //Copy and scale every 4th sample for the channels
     for(;index<last;index+=4)
     {
@@ -4647,15 +5060,24 @@ void ui_thumbnail_set_trace_data(PCHANNELSETTINGS settings, uint8 *buffer)
   PDISPLAYPOINTS ptr1 = &settings->tracepoints[0];
   PDISPLAYPOINTS ptr2 = &settings->tracepoints[1];
 
-  //Process the points
-  for(index=1;index<settings->noftracepoints;index++)
+  //Check if the trace is decimated
+  if(settings->noftracespans)
   {
-    //Fill in the blanks between the given points
-    ui_thumbnail_calculate_trace_data(ptr1->x, ptr1->y, ptr2->x, ptr2->y);
+    //Use the column ranges to keep the glitches visible in the thumbnail
+    ui_thumbnail_set_envelope_data(settings);
+  }
+  else
+  {
+    //Process the points
+    for(index=1;index<settings->noftracepoints;index++)
+    {
+      //Fill in the blanks between the given points
+      ui_thumbnail_calculate_trace_data(ptr1->x, ptr1->y, ptr2->x, ptr2->y);
 
-    //Select the next points
-    ptr1++;
-    ptr2++;
+      //Select the next points
+      ptr1++;
+      ptr2++;
+    }
   }
 
   //Down sample the points in to the given buffer
@@ -4686,6 +5108,60 @@ void ui_thumbnail_set_trace_data(PCHANNELSETTINGS settings, uint8 *buffer)
   }
 }
 
+//----------------------------------------------------------------------------------------------------------------------------------
+//The thumbnail only has a single sample per four screen columns. To not lose the glitches the extreme of the columns that is the
+//furthest away from the previous sample is used. For a noisy signal this gives a line going up and down over the range
+
+void ui_thumbnail_set_envelope_data(PCHANNELSETTINGS settings)
+{
+  PDISPLAYSPAN spans = settings->tracespans;
+  int32  last = disp_xstart + settings->noftracespans - 1;
+  int32  index;
+  int32  x;
+  int32  ymin;
+  int32  ymax;
+  int32  previous = -1;
+
+  //Only the columns taken by the down sampling are needed
+  for(index=disp_xstart;index<=disp_xend;index+=4)
+  {
+    ymin = 0xFFFF;
+    ymax = 0;
+
+    //Get the range of the four columns. After the last span that one is used
+    for(x=(index > last) ? last : index;(x < (index + 4)) && (x <= last);x++)
+    {
+      if(spans[x].ymin < ymin)
+      {
+        ymin = spans[x].ymin;
+      }
+
+      if(spans[x].ymax > ymax)
+      {
+        ymax = spans[x].ymax;
+      }
+    }
+
+    //Start in the middle of the first range
+    if(previous < 0)
+    {
+      previous = (ymin + ymax) / 2;
+    }
+
+    //Take the extreme furthest away from the previous sample
+    if((previous - ymin) > (ymax - previous))
+    {
+      previous = ymin;
+    }
+    else
+    {
+      previous = ymax;
+    }
+
+    thumbnailtracedata[index] = previous;
+  }
+}
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //Function to fill in samples based on linear interpolation
 
@@ -4848,6 +5324,9 @@ void ui_display_file_status_message(int32 msgid, int32 alwayswait)
   //When displaying trace data to avoid flickering data is drawn in a different screen buffer
   display_save_screen_buffer();
 
+  //The message is drawn in the main display buffer, so the trace and overlay layers can not be on top of it
+  scope_hide_trace_layers();
+
   //Save the screen rectangle where the message will be displayed
   display_set_screen_buffer((uint16 *)maindisplaybuffer);
   display_set_destination_buffer(displaybuffer2);
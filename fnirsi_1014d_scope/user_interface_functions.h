@@ -122,6 +122,7 @@ void ui_show_open_slider(void);
 //----------------------------------------------------------------------------------------------------------------------------------
 
 void ui_draw_grid(void);
+void ui_restore_grid(void);
 void ui_draw_pointers(void);
 void ui_display_cursors(void);
 
@@ -214,9 +215,24 @@ void ui_msm_display_duty_plus(uint32 xpos, uint32 ypos, PCHANNELSETTINGS setting
 void ui_msm_display_duty_min(uint32 xpos, uint32 ypos, PCHANNELSETTINGS settings);
 
 void ui_msm_display_voltage(PCHANNELSETTINGS settings, int32 value);
-void ui_msm_print_value(char *buffer, int32 value, uint32 scale, char *designator);
+char *ui_msm_print_value(char *buffer, int32 value, uint32 scale, char *designator);
 char *ui_msm_print_decimal(char *buffer, int32 value, uint32 decimals, uint32 negative);
 
+//----------------------------------------------------------------------------------------------------------------------------------
+// Timing instrumentation display and logging functions
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_display_timing_overlay(void);
+void ui_log_timing_data(void);
+
+//----------------------------------------------------------------------------------------------------------------------------------
+// Measurement statistics display and export functions
+//----------------------------------------------------------------------------------------------------------------------------------
+
+void ui_display_measurement_statistics(void);
+void ui_save_measurement_statistics(void);
+char *ui_print_statistics_value(char *buffer, uint32 slot, uint32 item);
+
 //----------------------------------------------------------------------------------------------------------------------------------
 // File display functions
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -255,6 +271,7 @@ void ui_display_thumbnail_data(uint32 xstart, uint32 xend, uint32 ypos, uint32 c
 void ui_create_thumbnail(PTHUMBNAILDATA thumbnaildata);
 
 void ui_thumbnail_set_trace_data(PCHANNELSETTINGS settings, uint8 *buffer);
+void ui_thumbnail_set_envelope_data(PCHANNELSETTINGS settings);
 void ui_thumbnail_calculate_trace_data(int32 xstart, int32 ystart, int32 xend, int32 yend);
 
 void ui_thumbnail_draw_pointer(uint32 xpos, uint32 ypos, uint32 direction, uint32 color);
@@ -8,6 +8,19 @@
 
 volatile uint32 timer0ticks;
 
+STAGETIMING stagetimings[TIMING_STAGES];      //Execution times of the acquisition and display stages
+
+uint32 waveformcount;                         //Number of captures in the current second
+uint32 waveformspersecond;                    //Number of captures in the last second
+uint32 waveformtimestamp;                     //timer0ticks at the start of the current second
+
+uint8 timinglogupdate;                        //Signals new timing data needs to be written to the SD card
+
+MEASUREMENTSTATISTICS measurementstatistics[6];       //Statistics of the values in the measurement slots since the last reset
+
+uint8 statisticsupdate;                       //Signals a new capture needs to be added to the statistics
+uint8 statisticsdisplay;                      //Show the statistics table on the screen
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //State machine data
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -43,7 +56,30 @@ PCHANNELSETTINGS currentsettings = 0;
 //----------------------------------------------------------------------------------------------------------------------------------
 
 //This first buffer is defined as 32 bits to be able to write it to file
-uint32 maindisplaybuffer[SCREEN_SIZE / 2];
+//It is aligned on a MMU section so it can be mapped write through without affecting the other variables
+uint32 maindisplaybuffer[SCREEN_SIZE / 2] __attribute__ ((aligned (0x100000)));
+
+//Pages for the trace and the overlay display layers. Two for each layer to flip between. One is shown while the next frame is drawn in the other
+//Together they fill whole MMU sections, so they can be mapped write through without affecting the other variables
+uint16 displaylayerpages[DISPLAY_LAYER_PAGES][SCREEN_SIZE] __attribute__ ((aligned (0x100000)));
+
+uint16 * volatile tracefrontbuffer   = displaylayerpages[0];   //Pages shown on the display, or shown from the next vertical blanking on
+uint16 * volatile overlayfrontbuffer = displaylayerpages[2];
+uint16 *tracebackbuffer              = displaylayerpages[1];   //Pages the next frame is drawn in
+uint16 *overlaybackbuffer            = displaylayerpages[3];
+
+volatile uint32 displayflippending;          //Set when the front pages still need to be loaded in the display engine
+volatile uint32 displaylayersshown;          //Set when the trace and overlay layers are enabled in the display engine
+uint32 displayoverlayredraw = DISPLAY_PAGES; //Number of overlay pages that still need the cursors and pointers redrawn
+uint32 displaytraceupdate = 1;               //Set when there is new data or input, so the traces need to be redrawn
+
+DIRTYREGION tracedirtyregions[DISPLAY_PAGES];     //Parts of the trace and overlay pages that have been drawn on and need clearing for the next frame
+DIRTYREGION overlaydirtyregions[DISPLAY_PAGES];
+
+uint32 framepixelspushed;                    //Pixels written for the last frame
+
+uint16 gridtemplate[SCREEN_SIZE];            //Trace window with only the grid in it, to restore the background with a single copy
+int32  gridtemplatebrightness = -1;          //Grid brightness the template is rendered for. Invalid to have it rendered on first use
 
 uint16 displaybuffer1[SCREEN_SIZE];
 uint16 displaybuffer2[SCREEN_SIZE];
@@ -63,16 +99,87 @@ SCOPESETTINGS scopesettings;
 
 CHANNELSETTINGS calibrationsettings;
 
+ADCCOMPENSATION channel1compensationtables;          //ADC compensation lookup tables. Rebuild when the compensation values change
+ADCCOMPENSATION channel2compensationtables;
+ADCCOMPENSATION calibrationcompensationtables;
+
 SCOPESETTINGS savedscopesettings1;
 SCOPESETTINGS savedscopesettings2;
 
 uint32 channel1tracebuffer[UINT32_SAMPLE_BUFFER_SIZE];
 
 DISPLAYPOINTS channel1pointsbuffer[730];      //Buffer to store the x,y positions of the trace on the display
+DISPLAYSPAN   channel1spansbuffer[730];       //Buffer to store the minimum and maximum y per column when the trace is decimated
+uint16        channel1spectrumbuffer[TRACE_MAX_WIDTH];   //Buffer to store the y positions of the spectrum on the display
 
 uint32 channel2tracebuffer[UINT32_SAMPLE_BUFFER_SIZE];
 
 DISPLAYPOINTS channel2pointsbuffer[730];      //Buffer to store the x,y positions of the trace on the display
+DISPLAYSPAN   channel2spansbuffer[730];       //Buffer to store the minimum and maximum y per column when the trace is decimated
+uint16        channel2spectrumbuffer[TRACE_MAX_WIDTH];   //Buffer to store the y positions of the spectrum on the display
+
+uint32 channel1history[HISTORY_SEGMENTS][UINT32_SAMPLE_BUFFER_SIZE];     //Ring of the last captures. Every new capture is read into the next segment
+uint32 channel2history[HISTORY_SEGMENTS][UINT32_SAMPLE_BUFFER_SIZE];
+
+HISTORYSEGMENT historysegments[HISTORY_SEGMENTS];      //Timestamp and trigger index per history segment
+
+uint32 historyindex;                          //Segment holding the latest capture
+uint32 historycount;                          //Number of segments holding a capture
+uint32 historyviewoffset;                     //Number of segments back from the latest capture that is displayed. 0 is the latest
+
+uint8  *channel1previousbuffer;               //Trace buffer and precision of the channels before a capture is read, for when it is dropped
+uint32  channel1previousbits;
+uint8  *channel2previousbuffer;
+uint32  channel2previousbits;
+
+uint16 searchevents[SEARCH_MAX_EVENTS];       //Sample offsets in the trace buffer of the events matching the trigger condition
+uint32 searchcount;                           //Number of events in the index
+int32  searchcurrent = -1;                    //Event the display is centered on. -1 is centered on the trigger point
+
+uint8 acquisitionstate = ACQUISITION_STATE_IDLE;                //State of the FPGA sampling process
+
+uint32 channel1longrecord[LONG_RECORD_SAMPLE_COUNT / 4];           //Samples of the full FPGA sample memory when long record mode is enabled
+uint32 channel2longrecord[LONG_RECORD_SAMPLE_COUNT / 4];
+
+uint32 longrecordvalid;                       //Signals the records hold the latest capture, so they can be displayed
+
+uint16 channel1xlookup[256];                  //Screen coordinates for every possible sample value, used for x-y display mode
+uint16 channel1ylookup[256];                  //Screen coordinates for every possible sample value, used for normal display mode
+uint16 channel2xlookup[256];
+uint16 channel2ylookup[256];
+
+uint32 channel1phosphor[UINT32_PHOSPHOR_BUFFER_SIZE];        //Per pixel hit counts of the trace window for the persistence display
+uint32 channel2phosphor[UINT32_PHOSPHOR_BUFFER_SIZE];
+
+uint16 channel1phosphorpalette[256];         //Display color for every possible hit count
+uint16 channel2phosphorpalette[256];
+
+uint8 phosphorupdate;                         //Signals a new capture needs to be added to the persistence display
+
+uint16 channel1averagebuffer[SAMPLE_COUNT];   //Averaged or filtered samples scaled up with the number of samples, to keep the extra resolution
+uint16 channel2averagebuffer[SAMPLE_COUNT];
+
+uint32 channel1processedbuffer[UINT32_SAMPLE_BUFFER_SIZE];     //The averaged or filtered samples rounded to 8 bits, outside the history ring
+uint32 channel2processedbuffer[UINT32_SAMPLE_BUFFER_SIZE];
+
+uint32 averagecount;                          //Number of captures taken into the average since the last reset
+uint32 averageshift;                          //Number of averaged captures as a power of 2. Grows up to the selected mode
+uint32 averagetriggerindex;                   //Trigger index of the first capture, on which the next ones are aligned
+uint32 averagereset = 1;                      //Signals the average needs to start over because the settings changed
+
+CHANNELSETTINGS mathchannel;                  //Virtual channel holding the combination of the two input channels
+
+uint32 mathtracebuffer[UINT32_SAMPLE_BUFFER_SIZE];
+uint32 mathlongrecord[LONG_RECORD_SAMPLE_COUNT / 4];
+
+DISPLAYPOINTS mathpointsbuffer[730];
+DISPLAYSPAN   mathspansbuffer[730];
+
+uint16 mathxlookup[256];
+uint16 mathylookup[256];
+
+uint32 mathphosphor[UINT32_PHOSPHOR_BUFFER_SIZE];
+uint16 mathphosphorpalette[256];
 
 uint16 thumbnailtracedata[730];
 
@@ -80,13 +187,14 @@ uint16 settingsworkbuffer[256];               //Used for loading from and writin
 
 //New variables for trace displaying
 
-double disp_xpos_per_sample;
-double disp_sample_step;
-double disp_xrange;
+uint64 disp_sample_step;             //Number of samples per pixel in 32.32 fixed point
+int32  disp_xrange;                  //Half the number of pixels covered by the samples in 16.16 fixed point
 
-int32 disp_first_sample;
+int32  disp_first_sample;
+uint32 disp_first_fraction;          //Position of the first pixel between the first sample and the next one in 0.32 fixed point
 
-int32 disp_trigger_index;            //Trigger point in the sample buffers
+int32  disp_trigger_index;           //Trigger point in the sample buffers
+uint32 disp_trigger_fraction;        //Interpolated position of the trigger level crossing after the trigger index in 0.32 fixed point
 
 int32 disp_xstart;
 int32 disp_xend;
@@ -307,6 +415,10 @@ const char *volt_div_texts[3][7] =
   { "500V", "250V", "100V", "50V", "20V", "10V", "5V" }
 };
 
+const char *math_mode_texts[MATH_MODES] = { "", "CH1+CH2", "CH1-CH2", "CH1*CH2" };
+
+const char *trigger_qualifier_texts[TRIGGER_QUALIFIERS] = { "", "Width <", "Width >", "Width =", "Runt", "Slope <", "Slope >", "Timeout" };
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //HW means done in hardware
 //SW means done in software
@@ -557,6 +669,23 @@ const char *measurement_names[12] =
   "Duty-"
 };
 
+//Inputs each of the measurements is calculated from, in the same order as the names
+const uint8 measurement_inputs[12] =
+{
+  MEASUREMENT_INPUT_STATISTICS,
+  MEASUREMENT_INPUT_STATISTICS,
+  MEASUREMENT_INPUT_STATISTICS,
+  MEASUREMENT_INPUT_STATISTICS,
+  MEASUREMENT_INPUT_STATISTICS,
+  MEASUREMENT_INPUT_STATISTICS,
+  MEASUREMENT_INPUT_CROSSINGS,
+  MEASUREMENT_INPUT_CROSSINGS,
+  MEASUREMENT_INPUT_CROSSINGS,
+  MEASUREMENT_INPUT_CROSSINGS,
+  MEASUREMENT_INPUT_CROSSINGS,
+  MEASUREMENT_INPUT_CROSSINGS
+};
+
 //----------------------------------------------------------------------------------------------------------------------------------
 
 const PATHINFO view_file_path[2] = 
@@ -577,6 +706,22 @@ const char *thumbnail_file_names[2] =
   "\\waveforms\\wav_thumbnails.sys"
 };
 
+const char *timing_stage_names[TIMING_STAGES] =
+{
+  "arm",
+  "trigger_wait",
+  "read",
+  "process_trigger",
+  "overlay_draw",
+  "trace_draw",
+  "measurements",
+  "page_flip",
+  "fft"
+};
+
+const char *timing_log_file_name = "\\timing.csv";
+const char *statistics_file_name = "\\statistics.csv";
+
 //----------------------------------------------------------------------------------------------------------------------------------
 
 //Setup the bitmap header
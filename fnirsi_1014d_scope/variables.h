@@ -148,6 +148,17 @@
 #define RUN_STATE_STOPPED                 0
 #define RUN_STATE_RUNNING                 1
 
+#define ADC_MERGE_USE_ADC1                1     //Compensated ADC1 sample needs to be used for the ADC2 sample
+#define ADC_MERGE_USE_ADC2                2     //Compensated ADC2 sample needs to be used for the ADC1 sample
+
+#define SCREEN_LOOKUP_INVALID    0xFFFFFFFF     //Forces a rebuild of the sample to screen lookup tables
+
+#define ACQUISITION_STATE_IDLE            0     //No conversion in progress, FPGA needs to be armed
+#define ACQUISITION_STATE_WAITING         1     //FPGA armed and busy filling its sample memory
+#define ACQUISITION_STATE_READY           2     //FPGA signaled triggered or buffer full, samples can be read
+
+#define HISTORY_SEGMENTS               1000     //Number of captures kept in the history ring for browsing when stopped
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //Trace window properties
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -173,7 +184,7 @@
 #define TRACE_HORIZONTAL_MIN            (TRACE_HORIZONTAL_START - 2)
 #define TRACE_HORIZONTAL_MAX            (TRACE_HORIZONTAL_END + 2)
 
-#define TRACE_CENTER_DELTA              ((double)(TRACE_HORIZONTAL_CENTER - ((double)TRACE_MAX_WIDTH / 2.0)))
+#define TRACE_CENTER_DELTA_X2           ((TRACE_HORIZONTAL_CENTER * 2) - TRACE_MAX_WIDTH)      //Twice the center offset to keep it integer
 
 #define TRACE_CHANNEL_XY_OFFSET         (TRACE_HORIZONTAL_CENTER - (TRACE_WINDOW_BORDER_HEIGHT / 2))
 
@@ -256,6 +267,13 @@
 #define VOLTAGE_SHIFTER                21
 #define SAMPLE_DIVIDER              10000
 
+//Fractional bits of the sample step (32.32) and the x range (16.16) used for resampling the traces to the screen
+#define SAMPLE_STEP_SHIFTER            32
+#define XRANGE_SHIFTER                 16
+
+//Limit the x range to keep the fixed point screen position calculations within 32 bits
+#define XRANGE_MAX             0x40000000
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //Base position of the measurement channel box and measurement label
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -277,6 +295,49 @@
 #define VIEW_FILENAME_XPOS             330
 #define VIEW_FILENAME_YPOS             458
 
+//----------------------------------------------------------------------------------------------------------------------------------
+//History segment display position
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define HISTORY_TEXT_XPOS              290
+#define HISTORY_TEXT_YPOS               64
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Run state and trigger state text positions
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define RUN_STOP_TEXT_XPOS               6
+#define RUN_STOP_TEXT_YPOS              33
+#define RUN_STOP_TEXT_WIDTH             35
+#define RUN_STOP_TEXT_HEIGHT            13
+
+#define TRIGGER_STATE_TEXT_XPOS        652
+#define TRIGGER_STATE_TEXT_YPOS        464
+#define TRIGGER_STATE_TEXT_WIDTH        54
+#define TRIGGER_STATE_TEXT_HEIGHT       14
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Spectrum display
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define FFT_DISPLAY_BITS                11     //2048 points
+#define FFT_DISPLAY_RANGE              800     //0.1dB steps over the height of the trace window, so 10dB per division
+
+#define FFT_TEXT_XPOS                   (TRACE_HORIZONTAL_START + 5)
+#define FFT_TEXT_YPOS                   (TRACE_VERTICAL_START + 5)
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Display layers and page flipping
+//----------------------------------------------------------------------------------------------------------------------------------
+
+//Layer 0 holds the user interface and the grid, layer 1 the traces and layer 2 the cursors and pointers
+#define DISPLAY_PAGES                    2     //Pages per flipped layer
+#define DISPLAY_LAYER_PAGES              (DISPLAY_PAGES * 2)
+
+#define DISPLAY_FLIP_TIMEOUT            50     //Milli seconds to wait on the vertical blanking before the flip is forced
+
+#define DISPLAY_DIRTY_RECTS             16     //Rectangles kept per dirty region. When full the ones closest together are merged
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //Sampling system
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -287,6 +348,164 @@
 #define SAMPLE_COUNT                      MAX_SAMPLE_BUFFER_SIZE
 #define SAMPLES_PER_ADC                   (SAMPLE_COUNT / 2)
 
+#define FPGA_SAMPLE_MEMORY_MASK           0x0FFF     //The FPGA sample memory is 4096 samples per ADC deep and addressed circular
+
+//The long record is read from the FPGA in multiple windows and covers almost the full sample memory
+#define LONG_RECORD_WINDOW_SIZE           1000
+#define LONG_RECORD_WINDOWS                  4
+#define LONG_RECORD_SAMPLES_PER_ADC       (LONG_RECORD_WINDOW_SIZE * LONG_RECORD_WINDOWS)
+#define LONG_RECORD_SAMPLE_COUNT          (LONG_RECORD_SAMPLES_PER_ADC * 2)
+
+//Index in the long record of the first sample in the normal trace buffer. The trace buffer sits in the center of the record
+#define LONG_RECORD_TRACE_OFFSET          ((LONG_RECORD_SAMPLE_COUNT - SAMPLE_COUNT) / 2)
+
+#define LONG_RECORD_TEXT_XPOS           600
+#define LONG_RECORD_TEXT_YPOS           128
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Acquisition modes
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define ACQUISITION_MODE_NORMAL           0     //Raw samples
+#define ACQUISITION_MODE_AVERAGE_2        1     //Average of 2 to the power of the mode captures, aligned on the trigger point
+#define ACQUISITION_MODE_AVERAGE_256      8
+#define ACQUISITION_MODE_HIGH_RES         9     //Boxcar average of neighbouring samples within a single capture
+#define ACQUISITION_MODES                10
+
+#define HIGH_RES_SHIFT                    2     //Average of 4 samples for 2 extra bits of resolution
+#define HIGH_RES_SAMPLES                  (1 << HIGH_RES_SHIFT)
+
+#define ACQUISITION_TEXT_XPOS           600
+#define ACQUISITION_TEXT_YPOS            64
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Math channel
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define MATH_MODE_OFF                     0     //No math trace
+#define MATH_MODE_ADD                     1     //Channel 1 plus channel 2
+#define MATH_MODE_SUBTRACT                2     //Channel 1 minus channel 2
+#define MATH_MODE_MULTIPLY                3     //Channel 1 times channel 2, where one division times one division gives one division
+#define MATH_MODES                        4
+
+#define MATH_RATIO_SHIFT                 16     //Fractional bits of the channel 2 to channel 1 scaling
+#define MATH_RATIO_MAX                  (255 << MATH_RATIO_SHIFT)     //Beyond this channel 2 saturates the result anyway
+
+#define MATH_TRACE_POSITION             (TRACE_WINDOW_BORDER_HEIGHT / 2)
+
+#define MATH_MEASUREMENT_CHANNEL          2     //Channel number used for the math trace in the measurement slots
+
+#define MATH_TEXT_XPOS                  600
+#define MATH_TEXT_YPOS                   80
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Software trigger
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define TRIGGER_HYSTERESIS                3     //Distance below the level a rising signal needs to come from. Above for falling
+
+#define TRIGGER_BYTE_HIGH_BITS   0x80808080     //Top bit of every sample in a word, used as flag per sample
+#define TRIGGER_BYTE_ONES        0x01010101     //Multiplier to repeat a byte over all the samples in a word
+
+#define TRIGGER_QUALIFIER_OFF             0     //Plain edge trigger
+#define TRIGGER_QUALIFIER_WIDTH_LESS      1     //Pulse shorter than the time between the time cursors
+#define TRIGGER_QUALIFIER_WIDTH_MORE      2     //Pulse longer than the time between the time cursors
+#define TRIGGER_QUALIFIER_WIDTH_RANGE     3     //Pulse within 1/8 of the time between the time cursors
+#define TRIGGER_QUALIFIER_RUNT            4     //Pulse that does not reach the volt cursor level
+#define TRIGGER_QUALIFIER_SLOPE_LESS      5     //Edge from the trigger level to the volt cursor level faster than the time cursors
+#define TRIGGER_QUALIFIER_SLOPE_MORE      6     //Same edge slower than the time between the time cursors
+#define TRIGGER_QUALIFIER_TIMEOUT         7     //No new edge for longer than the time between the time cursors
+#define TRIGGER_QUALIFIERS                8
+
+#define TRIGGER_WIDTH_TOLERANCE_SHIFT     3
+
+#define TRIGGER_QUALIFIER_TEXT_XPOS     600
+#define TRIGGER_QUALIFIER_TEXT_YPOS      96
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Event search
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define SEARCH_MAX_EVENTS       (SAMPLE_COUNT / 2)     //An event needs at least a sample on both sides of the hysteresis band
+
+#define SEARCH_TEXT_XPOS                600
+#define SEARCH_TEXT_YPOS                112
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Measurement inputs
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define MEASUREMENT_INPUT_STATISTICS   0x01     //Minimum, maximum, average and rms from a single pass over the samples
+#define MEASUREMENT_INPUT_CROSSINGS    0x02     //High and low times from the zero crossings. Needs the statistics for the center
+#define MEASUREMENT_INPUTS_ALL         0x03
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Measurement statistics
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define STATISTICS_FRACTION_BITS          8     //Fraction of the values in ADC steps, samples or 0.1% the statistics are gathered on
+#define STATISTICS_TIME_SHIFT            12     //The time measurements have 20 fraction bits
+
+#define STATISTICS_MEAN                   0
+#define STATISTICS_MINIMUM                1
+#define STATISTICS_MAXIMUM                2
+#define STATISTICS_DEVIATION              3
+#define STATISTICS_ITEMS                  4
+
+#define STATISTICS_TEXT_XPOS             16
+#define STATISTICS_TEXT_YPOS            330
+#define STATISTICS_TEXT_LINE_HEIGHT      15
+
+#define STATISTICS_LOG_LINE_SIZE        128     //Enough for a slot with its five values and the time
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Persistence display
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define PERSISTENCE_MODE_OFF              0     //Normal vector trace displaying
+#define PERSISTENCE_MODE_PHOSPHOR         1     //Intensity graded display with the older captures fading away
+#define PERSISTENCE_MODE_INFINITE         2     //Intensity graded display without fading
+#define PERSISTENCE_MODES                 3
+
+//The hit counts are stored row major with the rows padded to a multiple of 4 bytes to allow for word wise processing
+#define PHOSPHOR_PITCH                    ((TRACE_MAX_WIDTH + 3) & ~3)
+#define PHOSPHOR_BUFFER_SIZE              (PHOSPHOR_PITCH * TRACE_MAX_HEIGHT)
+#define UINT32_PHOSPHOR_BUFFER_SIZE       (PHOSPHOR_BUFFER_SIZE / 4)
+
+#define PHOSPHOR_HIT_INCREMENT           48     //Added to a pixel every time a capture passes through it. Saturates on 255
+#define PHOSPHOR_DECAY_SHIFT              3     //Every new capture takes 1/8 of the intensity of the older ones away
+#define PHOSPHOR_MIN_LEVEL               40     //Brightness used for a single hit so it is still visible
+#define PHOSPHOR_WHITE_START            192     //Intensity from where on the color goes towards white
+
+//----------------------------------------------------------------------------------------------------------------------------------
+//Timing instrumentation
+//----------------------------------------------------------------------------------------------------------------------------------
+
+#define TIMING_STAGE_ARM                  0     //Setting up the FPGA for a new capture
+#define TIMING_STAGE_TRIGGER_WAIT         1     //From arming until the FPGA signals triggered or buffer full
+#define TIMING_STAGE_READ                 2     //Reading and processing the samples of the enabled channels
+#define TIMING_STAGE_PROCESS_TRIGGER      3     //Searching the trigger point in the samples
+#define TIMING_STAGE_OVERLAY_DRAW         4     //Redrawing the cursors and pointers when changed
+#define TIMING_STAGE_TRACE_DRAW           5
+#define TIMING_STAGE_MEASUREMENTS         6
+#define TIMING_STAGE_PAGE_FLIP            7     //Waiting on the previous page flip
+#define TIMING_STAGE_FFT                  8     //Transforming the samples of the channels with the FFT enabled
+#define TIMING_STAGES                     9
+
+#define TIMING_WINDOW                    64     //Number of measurements per stage the minimum, average and maximum are taken over
+#define TIMER1_TICKS_PER_US              24     //Timer 1 runs on the 24MHz oscillator
+
+#define TIMING_MODE_OFF                   0
+#define TIMING_MODE_OVERLAY               1     //Show the stage timing on the screen
+#define TIMING_MODE_OVERLAY_LOG           2     //Also write it to the SD card once every second
+#define TIMING_MODES                      3
+
+#define TIMING_TEXT_XPOS                 16
+#define TIMING_TEXT_YPOS                 90
+#define TIMING_TEXT_LINE_HEIGHT          15
+
+#define TIMING_LOG_LINE_SIZE            368     //Enough for the time, the update rate, the pixel count and the three values of all the stages
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //Cursor types
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -303,6 +522,7 @@
 //----------------------------------------------------------------------------------------------------------------------------------
 
 typedef struct tagDisplayPoints         DISPLAYPOINTS,        *PDISPLAYPOINTS;
+typedef struct tagDisplaySpan           DISPLAYSPAN,          *PDISPLAYSPAN;
 
 typedef struct tagChannelSettings       CHANNELSETTINGS,      *PCHANNELSETTINGS;
 typedef struct tagScopeSettings         SCOPESETTINGS,        *PSCOPESETTINGS;
@@ -325,6 +545,17 @@ typedef struct tagShadedRoundedRectData SHADEDROUNDEDRECTDATA,   *PSHADEDROUNDED
 
 typedef struct tagMeasurementInfo       MEASUREMENTINFO,      *PMEASUREMENTINFO;
 
+typedef struct tagADCCompensation       ADCCOMPENSATION,      *PADCCOMPENSATION;
+
+typedef struct tagHistorySegment        HISTORYSEGMENT,       *PHISTORYSEGMENT;
+
+typedef struct tagStageTiming           STAGETIMING,          *PSTAGETIMING;
+
+typedef struct tagMeasurementStatistics MEASUREMENTSTATISTICS, *PMEASUREMENTSTATISTICS;
+
+typedef struct tagDisplayRect           DISPLAYRECT,          *PDISPLAYRECT;
+typedef struct tagDirtyRegion           DIRTYREGION,          *PDIRTYREGION;
+
 //----------------------------------------------------------------------------------------------------------------------------------
 
 typedef void (*NAVIGATIONFUNCTION)(void);
@@ -344,6 +575,98 @@ struct tagDisplayPoints
 
 //----------------------------------------------------------------------------------------------------------------------------------
 
+struct tagDisplaySpan
+{
+  uint16 ymin;
+  uint16 ymax;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+struct tagADCCompensation
+{
+  //Compensation values the tables are build for
+  int16  adc1compensation;
+  int16  adc2compensation;
+  uint8  valid;
+
+  //Compensated sample for every possible raw ADC reading
+  uint8  adc1[256];
+  uint8  adc2[256];
+
+  //Flags per compensated sample value for matching the two ADC readings when one of them bottoms or tops out
+  uint8  merge[256];
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+struct tagHistorySegment
+{
+  uint32 timestamp;          //timer0ticks at the moment the capture was read from the FPGA
+  int32  triggerindex;       //Trigger index found for the capture
+  uint32 triggerfraction;    //Position of the trigger between the index and the next sample in 0.32 fixed point
+  uint8  channel1enable;     //Only the channels that were enabled during the capture hold valid samples
+  uint8  channel2enable;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+struct tagStageTiming
+{
+  //Timer 1 ticks at the start of the stage
+  uint32 start;
+
+  //Data of the window being gathered in timer 1 ticks
+  uint32 min;
+  uint32 max;
+  uint64 sum;
+  uint32 count;
+
+  //Results of the last complete window in micro seconds
+  uint32 minimum;
+  uint32 average;
+  uint32 maximum;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+struct tagMeasurementStatistics
+{
+  uint32 settings;     //Measurement and sample settings the values are gathered for. A change starts over
+  uint32 count;        //Number of acquisitions with a valid value
+
+  //Values with STATISTICS_FRACTION_BITS fraction bits
+  int32  minimum;
+  int32  maximum;
+  int32  mean;
+
+  //Sum of the values for the mean, so the truncation of the division does not build up over the acquisitions
+  int64  sum;
+
+  //Sum of the squared differences with the mean for the standard deviation, with twice the fraction bits
+  int64  m2;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+struct tagDisplayRect
+{
+  int32 xstart;              //First column and line of the rectangle
+  int32 ystart;
+  int32 xend;                //Column and line just after the rectangle
+  int32 yend;
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
+struct tagDirtyRegion
+{
+  uint32      count;                         //Number of rectangles in use
+  DISPLAYRECT rects[DISPLAY_DIRTY_RECTS];    //Changed parts of a screen buffer. They do not touch or overlap each other
+};
+
+//----------------------------------------------------------------------------------------------------------------------------------
+
 struct tagChannelSettings
 {
   //Settings
@@ -361,9 +684,9 @@ struct tagChannelSettings
   uint16 dcoffset;
 
   //Inter ADC difference compensation
-  int16  compensation;
   int16  adc1compensation;
   int16  adc2compensation;
+  PADCCOMPENSATION compensationtables;
 
   //DC offset calibration for center level of the ADC's
   uint16 dc_calibration_offset[7];
@@ -375,22 +698,22 @@ struct tagChannelSettings
   int32  center;
   int32  peakpeak;
   uint32 rms;
+
+  //Voltage measurements with STATISTICS_FRACTION_BITS fraction bits, taken from the samples with extra resolution when there are any
+  int32  precisemin;
+  int32  precisemax;
+  int32  preciseaverage;
+  uint32 preciserms;
+
   uint32 frequencyvalid;
   uint32 frequency;
   uint32 lowtime;
   uint32 hightime;
   uint32 periodtime;
-
-  //Frequency determination work variables
-  uint32 highlevel;
-  uint32 lowlevel;
-  uint32 state;
   uint32 zerocrossings;
-  uint32 lowsamplecount;
-  uint32 lowdivider;
-  uint32 highsamplecount;
-  uint32 highdivider;
-  uint32 previousindex;
+
+  //Measurement inputs that are computed for the samples in the trace buffer
+  uint8  measurementinputs;
 
   //Auto ranging space
   uint32 maxscreenspace;
@@ -403,11 +726,36 @@ struct tagChannelSettings
   //Sample data
   uint8 *tracebuffer;
   uint8 *buffer;
+  uint8 *longrecord;
+
+  //Persistence display hit counts and the intensity to color palette for them
+  uint8  *phosphor;
+  uint16 *phosphorpalette;
+
+  //Samples with extra resolution for the averaging and high resolution modes and the number of fraction bits in them. The number
+  //of bits is 0 when the trace buffer holds the samples as captured
+  uint16 *averagebuffer;
+  uint32  precisionbits;
+
+  //The samples of these modes rounded to 8 bits for the display and the trigger, so the history keeps the samples as captured
+  uint8  *processedbuffer;
 
   //Screen data
   PDISPLAYPOINTS tracepoints;
   uint32         noftracepoints;
 
+  //Minimum to maximum screen range per column, from disp_xstart on. Only filled when there is more than one sample per pixel
+  PDISPLAYSPAN   tracespans;
+  uint32         noftracespans;
+
+  //Screen y of the spectrum for every column of the trace window when the FFT is enabled
+  uint16        *spectrum;
+
+  //Sample to screen coordinate lookup tables and the settings they are build for
+  uint16 *xlookup;
+  uint16 *ylookup;
+  uint32  lookupsettings;
+
   //Sample gathering options
   uint8 checkfirstadc;
   uint8 triggeronchannel;
@@ -472,6 +820,12 @@ struct tagScopeSettings
   uint8 alwaystrigger50;
   uint8 tracedisplaymode;
   uint8 confirmationmode;
+  uint8 longrecordenable;
+  uint8 persistencemode;
+  uint8 timingmode;
+  uint8 acquisitionmode;
+  uint8 mathmode;
+  uint8 triggerqualifier;
 
   uint8 selectedcursor;
 
@@ -608,6 +962,19 @@ extern uint8 BSS_END;
 
 extern volatile uint32 timer0ticks;
 
+extern STAGETIMING stagetimings[TIMING_STAGES];
+
+extern uint32 waveformcount;
+extern uint32 waveformspersecond;
+extern uint32 waveformtimestamp;
+
+extern uint8 timinglogupdate;
+
+extern MEASUREMENTSTATISTICS measurementstatistics[6];
+
+extern uint8 statisticsupdate;
+extern uint8 statisticsdisplay;
+
 //----------------------------------------------------------------------------------------------------------------------------------
 //Channel information display data
 //----------------------------------------------------------------------------------------------------------------------------------
@@ -618,6 +985,8 @@ extern TEXTDATA          channel_1_box_text;
 extern HIGHLIGHTRECTDATA channel_2_highlight_box;
 extern SHADEDRECTDATA    channel_2_box;
 extern TEXTDATA          channel_2_box_text;
+extern SHADEDRECTDATA    math_box;
+extern TEXTDATA          math_box_text;
 
 //----------------------------------------------------------------------------------------------------------------------------------
 //State machine data
@@ -659,29 +1028,101 @@ extern SCOPESETTINGS scopesettings;
 
 CHANNELSETTINGS calibrationsettings;
 
+extern ADCCOMPENSATION channel1compensationtables;
+extern ADCCOMPENSATION channel2compensationtables;
+extern ADCCOMPENSATION calibrationcompensationtables;
+
 extern SCOPESETTINGS savedscopesettings1;
 extern SCOPESETTINGS savedscopesettings2;
 
 extern uint32 channel1tracebuffer[UINT32_SAMPLE_BUFFER_SIZE];
 
 extern DISPLAYPOINTS channel1pointsbuffer[730];
+extern DISPLAYSPAN   channel1spansbuffer[730];
+extern uint16        channel1spectrumbuffer[TRACE_MAX_WIDTH];
 
 extern uint32 channel2tracebuffer[UINT32_SAMPLE_BUFFER_SIZE];
 
 extern DISPLAYPOINTS channel2pointsbuffer[730];
+extern DISPLAYSPAN   channel2spansbuffer[730];
+extern uint16        channel2spectrumbuffer[TRACE_MAX_WIDTH];
+
+extern uint32 channel1history[HISTORY_SEGMENTS][UINT32_SAMPLE_BUFFER_SIZE];
+extern uint32 channel2history[HISTORY_SEGMENTS][UINT32_SAMPLE_BUFFER_SIZE];
+
+extern HISTORYSEGMENT historysegments[HISTORY_SEGMENTS];
+
+extern uint32 historyindex;
+extern uint32 historycount;
+extern uint32 historyviewoffset;
+
+extern uint8  *channel1previousbuffer;
+extern uint32  channel1previousbits;
+extern uint8  *channel2previousbuffer;
+extern uint32  channel2previousbits;
+
+extern uint16 searchevents[SEARCH_MAX_EVENTS];
+extern uint32 searchcount;
+extern int32  searchcurrent;
+
+extern uint8 acquisitionstate;
+
+extern uint32 channel1longrecord[LONG_RECORD_SAMPLE_COUNT / 4];
+extern uint32 channel2longrecord[LONG_RECORD_SAMPLE_COUNT / 4];
+
+extern uint32 longrecordvalid;
+
+extern uint16 channel1xlookup[256];
+extern uint16 channel1ylookup[256];
+extern uint16 channel2xlookup[256];
+extern uint16 channel2ylookup[256];
+
+extern uint32 channel1phosphor[UINT32_PHOSPHOR_BUFFER_SIZE];
+extern uint32 channel2phosphor[UINT32_PHOSPHOR_BUFFER_SIZE];
+
+extern uint16 channel1phosphorpalette[256];
+extern uint16 channel2phosphorpalette[256];
+
+extern uint8 phosphorupdate;
+
+extern uint16 channel1averagebuffer[SAMPLE_COUNT];
+extern uint16 channel2averagebuffer[SAMPLE_COUNT];
+
+extern uint32 channel1processedbuffer[UINT32_SAMPLE_BUFFER_SIZE];
+extern uint32 channel2processedbuffer[UINT32_SAMPLE_BUFFER_SIZE];
+
+extern uint32 averagecount;
+extern uint32 averageshift;
+extern uint32 averagetriggerindex;
+extern uint32 averagereset;
+
+extern CHANNELSETTINGS mathchannel;
+
+extern uint32 mathtracebuffer[UINT32_SAMPLE_BUFFER_SIZE];
+extern uint32 mathlongrecord[LONG_RECORD_SAMPLE_COUNT / 4];
+
+extern DISPLAYPOINTS mathpointsbuffer[730];
+extern DISPLAYSPAN   mathspansbuffer[730];
+
+extern uint16 mathxlookup[256];
+extern uint16 mathylookup[256];
+
+extern uint32 mathphosphor[UINT32_PHOSPHOR_BUFFER_SIZE];
+extern uint16 mathphosphorpalette[256];
 
 extern uint16 thumbnailtracedata[730];
 
 extern uint16 settingsworkbuffer[256];
 
 //New variables for trace displaying
-extern double disp_xpos_per_sample;
-extern double disp_sample_step;
-extern double disp_xrange;
+extern uint64 disp_sample_step;
+extern int32  disp_xrange;
 
-extern int32 disp_first_sample;
+extern int32  disp_first_sample;
+extern uint32 disp_first_fraction;
 
-extern int32 disp_trigger_index;
+extern int32  disp_trigger_index;
+extern uint32 disp_trigger_fraction;
 
 extern int32 disp_xstart;
 extern int32 disp_xend;
@@ -707,6 +1148,10 @@ extern uint32 sampleratedcoffsetstep[2][6];
 
 extern const char *volt_div_texts[3][7];
 
+extern const char *math_mode_texts[MATH_MODES];
+
+extern const char *trigger_qualifier_texts[TRIGGER_QUALIFIERS];
+
 extern const int32 signal_adjusters[7];
 
 extern const uint32 timebase_settings[24];
@@ -735,6 +1180,10 @@ extern const PATHINFO view_file_path[2];
 extern const char     view_file_extension[2][5];
 extern const char    *thumbnail_file_names[2];
 
+extern const char *timing_stage_names[TIMING_STAGES];
+extern const char *timing_log_file_name;
+extern const char *statistics_file_name;
+
 extern const uint8 bmpheader[PICTURE_HEADER_SIZE];
 
 extern const uint32 frequency_per_div[24];
@@ -752,6 +1201,7 @@ extern const int8 acquisition_speed_text_x_offsets[18];
 
 extern const MEASUREMENTFUNCTION measurement_functions[];
 extern const char *measurement_names[12];
+extern const uint8 measurement_inputs[12];
 
 //----------------------------------------------------------------------------------------------------------------------------------
 //Data for picture and waveform view mode
@@ -794,6 +1244,25 @@ extern uint32 viewfilesetupdata[VIEW_NUMBER_OF_SETTINGS];
 
 //This first buffer is defined as 32 bits to be able to write it to file
 extern uint32 maindisplaybuffer[SCREEN_SIZE / 2];
+extern uint16 displaylayerpages[DISPLAY_LAYER_PAGES][SCREEN_SIZE];
+
+extern uint16 * volatile tracefrontbuffer;
+extern uint16 * volatile overlayfrontbuffer;
+extern uint16 *tracebackbuffer;
+extern uint16 *overlaybackbuffer;
+
+extern volatile uint32 displayflippending;
+extern volatile uint32 displaylayersshown;
+extern uint32 displayoverlayredraw;
+extern uint32 displaytraceupdate;
+
+extern DIRTYREGION tracedirtyregions[DISPLAY_PAGES];
+extern DIRTYREGION overlaydirtyregions[DISPLAY_PAGES];
+
+extern uint32 framepixelspushed;
+
+extern uint16 gridtemplate[SCREEN_SIZE];
+extern int32  gridtemplatebrightness;
 
 extern uint16 displaybuffer1[SCREEN_SIZE];
 extern uint16 displaybuffer2[SCREEN_SIZE];